@@ -170,7 +170,7 @@ endif
 ifneq ($(STATIC_LIB),)
 	TARGETDIR := $(OCLLIBDIR)
 	TARGET   := $(subst .a,$(LIBSUFFIX).a,$(OCLLIBDIR)/$(STATIC_LIB))
-	LINKLINE  = ar qv $(TARGET) $(OBJS) 
+	LINKLINE  = ar rv $(TARGET) $(OBJS) 
 else
     ifeq ($(dbg),1)
 	    LIB += -loclUtilD -lshrutilD  -lcv -lhighgui -lstdc++
@@ -180,6 +180,7 @@ else
 	TARGETDIR := $(BINDIR)/$(BINSUBDIR)
 	TARGET    := $(TARGETDIR)/$(EXECUTABLE)
 	LINKLINE  = $(LINK) -o $(TARGET) $(OBJS) $(LIB)
+	OCLUTIL   := $(OCLLIBDIR)/liboclUtil$(LIBSUFFIX).a
 endif
 # check if verbose 
 ifeq ($(verbose), 1)
@@ -209,9 +210,13 @@ $(OBJDIR)/%.c.o : $(SRCDIR)%.c $(C_DEPS)
 $(OBJDIR)/%.cpp.o : $(SRCDIR)%.cpp $(C_DEPS)
 	$(VERBOSE)$(CXX) $(CXXFLAGS) -o $@ -c $<
 
-$(TARGET): makedirectories $(OBJS) Makefile
+$(TARGET): makedirectories $(OBJS) $(OCLUTIL) Makefile
 	$(VERBOSE)$(LINKLINE)
 
+# oclUtil is built from source, so changes of oclUtils.cpp reach the executables
+$(OCLUTIL): $(OCLCOMMONDIR)/src/oclUtils.cpp $(OCLCOMMONDIR)/inc/oclUtils.h
+	$(VERBOSE)$(MAKE) -C $(OCLCOMMONDIR) dbg=$(dbg)
+
 makedirectories:
 	$(VERBOSE)mkdir -p $(LIBDIR)
 	$(VERBOSE)mkdir -p $(OBJDIR)
@@ -499,7 +499,7 @@ void oclGetProgBinary( cl_program cpProgram, cl_device_id cdDevice, char** binar
     for( unsigned int i=0; i<num_devices; ++i) {
         ptx_code[i]= (char*)malloc(binary_sizes[i]);
     }
-    clGetProgramInfo(cpProgram, CL_PROGRAM_BINARIES, 0, ptx_code, NULL);
+    clGetProgramInfo(cpProgram, CL_PROGRAM_BINARIES, num_devices * sizeof(char*), ptx_code, NULL);
 
     // Find the index of the device of interest
     unsigned int idx = 0;
@@ -548,7 +548,7 @@ void oclLogPtx(cl_program cpProgram, cl_device_id cdDevice, const char* cPtxFile
     {
         ptx_code[i] = (char*)malloc(binary_sizes[i]);
     }
-    clGetProgramInfo(cpProgram, CL_PROGRAM_BINARIES, 0, ptx_code, NULL);
+    clGetProgramInfo(cpProgram, CL_PROGRAM_BINARIES, num_devices * sizeof(char*), ptx_code, NULL);
 
     // Find the index of the device of interest
     unsigned int idx = 0;
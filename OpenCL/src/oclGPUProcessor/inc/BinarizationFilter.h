@@ -17,12 +17,14 @@
 class BinarizationFilter :
 	public ContextFreeFilter
 {
-public:
+private:
 
 	/*!
-	* Constructor.
+	* Threshold of gray level.
 	*/
-	BinarizationFilter(void);
+	int threshold;
+
+public:
 
 	/*!
 	* Destructor.
@@ -30,16 +32,17 @@ public:
 	~BinarizationFilter(void);
 
 	/*!
-	* Constructor.
+	* Constructor, creates a program object for a context, loads the source code (.cl files) and build the program.
 	*/
-	BinarizationFilter(cl_context GPUContext ,GPUTransferManager* transfer, int bin): ContextFreeFilter("./OpenCL/LUTFilter.cl",GPUContext,transfer,"ckLUT")
-	{
-
-	}
+	BinarizationFilter(cl_context GPUContext ,GPUTransferManager* transfer, int bin);
 
 	/*!
 	* Start filtering.
 	*/
 	bool filter(cl_command_queue GPUCommandQueue);
-};
 
+	/*!
+	* Start filtering on the host.
+	*/
+	bool filterHost();
+};
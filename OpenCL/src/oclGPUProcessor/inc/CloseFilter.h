@@ -46,6 +46,36 @@ public:
 	* Start dilate filtering, and erode filtering. Launching GPU processing.
 	*/
 	bool filter(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Start filtering on the host.
+	*/
+	bool filterHost();
+
+	/*!
+	* Erode and dilate, radius is 2.
+	*/
+	int Radius();
+
+	/*!
+	* Set transfer manager of erode and dilate filters.
+	*/
+	void SetTransfer(GPUTransferManager* transfer);
+
+	/*!
+	* Tune erode and dilate filters.
+	*/
+	bool Autotune(cl_command_queue GPUCommandQueue, cl_device_id GPUDevice);
+
+	/*!
+	* Select source of neighbourhoods of erode and dilate filters.
+	*/
+	bool SetFetch(FetchMode mode);
+
+	/*!
+	* Select radius of window of erode and dilate filters.
+	*/
+	bool SetRadius(int radius);
 };
 
 
@@ -8,6 +8,15 @@
 #pragma once
 #include "Filter.h"
 
+/*!
+ * Source of neighbourhoods read by context filters.
+ */
+enum FetchMode
+{
+	FETCH_LOCAL,	/*!< Work-group tile with apron is staged in local memory, pixels outside of the image are zero. */
+	FETCH_IMAGE		/*!< Image2d is read through sampler with CLK_ADDRESS_CLAMP_TO_EDGE, edge pixels are repeated. */
+};
+
 /*!
  * \class ContextFilter
  * \brief Contex filter. Context transformation compute the value of given output image pixel on the base a of its neighbors and a mask.
@@ -17,8 +26,85 @@
 class ContextFilter :
 	public Filter
 {
+protected:
+
+	/*!
+	* Name of kernel in ImageFilters.cl used with FETCH_IMAGE, NULL if filter has only the LMEM kernel.
+	*/
+	char* ImageKernelName;
+
+	/*!
+	* Program built from ImageFilters.cl, NULL until FETCH_IMAGE is selected.
+	*/
+	cl_program GPUImageProgram;
+
+	/*!
+	* Kernel reading the image through sampler.
+	*/
+	cl_kernel GPUImageFilter;
+
+	/*!
+	* Kernel copying input buffer to the image.
+	*/
+	cl_kernel GPUBufferToImage;
+
+	/*!
+	* FETCH_IMAGE is selected and can be used for current images, batches use the LMEM kernel.
+	*/
+	bool UseImage();
+
+	/*!
+	* Copy input buffer to image of transfer manager and launch image kernel.
+	*/
+	bool filterImage(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Set arguments of image kernel after the common ones (image, output, width, height, channels, pitch).
+	*/
+	virtual bool SetImageArgs(cl_uint first);
+
+	/*!
+	* Name of kernel in StencilFilters.cl used for radius larger than 1, NULL if filter is 3x3 only.
+	*/
+	char* StencilKernelName;
+
+	/*!
+	* Program built from StencilFilters.cl, NULL until radius larger than 1 is selected.
+	*/
+	cl_program GPUStencilProgram;
+
+	/*!
+	* Kernel with window of (2 * iRadius + 1) x (2 * iRadius + 1) pixels.
+	*/
+	cl_kernel GPUStencilFilter;
+
+	/*!
+	* Radius of window, 1 for 3x3.
+	*/
+	int iRadius;
+
+	/*!
+	* Radius larger than 1 is selected, stencil kernel is used instead of the 3x3 and image kernels.
+	*/
+	bool UseStencil();
+
+	/*!
+	* Launch stencil kernel. Tile of work-group with apron of iRadius pixels is loaded into local memory.
+	*/
+	bool filterStencil(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Set arguments of stencil kernel after the common ones (input, output, tile, radius, width, height, channels, pitch).
+	*/
+	virtual bool SetStencilArgs(cl_uint first);
+
 public:
 
+	/*!
+	* Source of neighbourhoods, FETCH_LOCAL by default. Changed by SetFetch().
+	*/
+	FetchMode Fetch;
+
 	/*!
 	* Default constructor. Nothing doing.
 	*/
@@ -34,5 +120,25 @@ public:
 	*/
 	ContextFilter(char* source, cl_context GPUContext ,GPUTransferManager* transfer,char* KernelName);
 
+	/*!
+	* Select source of neighbourhoods. Return false and keep FETCH_LOCAL if filter has no image kernel or device has no image support.
+	*/
+	virtual bool SetFetch(FetchMode mode);
+
+	/*!
+	* Select radius of window, 1 is the 3x3 filter. Return false and keep the radius if filter has no stencil kernel.
+	*/
+	virtual bool SetRadius(int radius);
+
+	/*!
+	* Radius of window.
+	*/
+	int Radius();
+
+	/*!
+	* Tune the 3x3 kernel, tuning file has one entry per kernel name.
+	*/
+	bool Autotune(cl_command_queue GPUCommandQueue, cl_device_id GPUDevice);
+
 };
 
@@ -29,5 +29,10 @@ public:
 	*/
 	ContextFreeFilter(char* source, cl_context GPUContext ,GPUTransferManager* transfer,char* KernelName);
 
+	/*!
+	* Output pixel depends only on input pixel, radius is 0.
+	*/
+	int Radius();
+
 };
 
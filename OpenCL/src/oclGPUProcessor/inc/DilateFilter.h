@@ -38,5 +38,10 @@ public:
 	* Start filtering. Launching GPU processing.
 	*/
 	bool filter(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Start filtering on the host.
+	*/
+	bool filterHost();
 };
 
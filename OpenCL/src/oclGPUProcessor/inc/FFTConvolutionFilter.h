@@ -0,0 +1,163 @@
+/*!
+ * \file FFTConvolutionFilter.h
+ * \brief File contains class convolution filter with large float mask.
+ */
+
+#pragma once
+#include "LinearFilter.h"
+
+/*!
+ * Taps per pixel of direct convolution costing as much as one log2 step of FFT of padded image, used by CONV_AUTO.
+ */
+#define FFT_TAPS_PER_STEP 16
+
+/*!
+ * Method of convolution.
+ */
+enum ConvolutionMethod
+{
+	CONV_AUTO,		/*!< Direct for small masks, FFT when mask is larger than FFT_TAPS_PER_STEP * log2(padded size) taps or tile doesn't fit in local memory. */
+	CONV_DIRECT,	/*!< Tile with apron of mask radius is staged in local memory, cost grows with mask area. */
+	CONV_FFT		/*!< Product of spectra of zero-padded image and mask, cost doesn't depend on mask size. */
+};
+
+/*!
+ * \class FFTConvolutionFilter
+ * \brief Convolution with float mask of any odd size, for deblurring and matched filters with 64x64 and larger non-separable masks.
+ * Large masks are applied in frequency domain with radix-2 FFT, spectrum of the mask is kept on the device and reused
+ * until padded size changes. Two channels are transformed at once as real and imaginary part.
+ */
+class FFTConvolutionFilter :
+	public LinearFilter
+{
+private:
+
+	/*!
+	* Mask coefficients in row-major order, normalised to sum 1 unless they sum to 0.
+	*/
+	float* mask;
+
+	/*!
+	* Horizontal radius of mask.
+	*/
+	int iMaskRadiusX;
+
+	/*!
+	* Vertical radius of mask.
+	*/
+	int iMaskRadiusY;
+
+	/*!
+	* OpenCL device memory buffer for mask.
+	*/
+	cl_mem cmDevBufMask;
+
+	/*!
+	* Kernel loading two channels to complex buffer.
+	*/
+	cl_kernel ckLoad;
+
+	/*!
+	* Kernel loading mirrored mask to complex buffer.
+	*/
+	cl_kernel ckLoadMask;
+
+	/*!
+	* Kernel of one radix-2 pass.
+	*/
+	cl_kernel ckRadix2;
+
+	/*!
+	* Kernel multiplying spectra.
+	*/
+	cl_kernel ckMul;
+
+	/*!
+	* Kernel storing two channels from complex buffer.
+	*/
+	cl_kernel ckStore;
+
+	/*!
+	* Padded size for current image, linear convolution doesn't wrap around.
+	*/
+	void PaddedSize(int* width, int* height);
+
+	/*!
+	* Get complex buffers of padded size from scratch buffers of the transfer manager: spectrum of the mask and two
+	* ping-pong buffers of padded image. Spectrum is computed if padded size of this transfer manager changed.
+	*/
+	bool PrepareSpectrum(cl_command_queue GPUCommandQueue, int width, int height, cl_mem* buffers);
+
+	/*!
+	* 2D transform of complex buffer of padded size, rows and then columns. Return index of ping-pong buffer holding the result.
+	*/
+	int Transform(cl_command_queue GPUCommandQueue, cl_mem* buffers, int buffer, float fSign, int width, int height);
+
+	/*!
+	* Enqueue FFT path kernel over given NDRange, work-group size is chosen by the driver.
+	*/
+	bool EnqueueFFT(cl_command_queue GPUCommandQueue, cl_kernel kernel, const char* name, size_t width, size_t height);
+
+	/*!
+	* Convolution in frequency domain.
+	*/
+	bool filterFFT(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Direct convolution, tile with apron of the mask is staged in local memory.
+	*/
+	bool filterDirect(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Size of tile of direct path in bytes.
+	*/
+	size_t DirectTileBytes();
+
+public:
+
+	/*!
+	* Method of convolution, CONV_AUTO by default.
+	*/
+	ConvolutionMethod Method;
+
+	/*!
+	* Destructor.
+	*/
+	~FFTConvolutionFilter(void);
+
+	/*!
+	* Constructor. Mask has width x height coefficients in row-major order, width and height are odd.
+	* Send mask to GPU memory. Creates a program object for a context, loads the source code (.cl files) and build the program.
+	*/
+	FFTConvolutionFilter(cl_context GPUContext ,GPUTransferManager* transfer, const float* coeffs, int width, int height);
+
+	/*!
+	* Start filtering with method selected for current image. Launching GPU processing.
+	*/
+	bool filter(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Start filtering on the host, direct convolution.
+	*/
+	bool filterHost();
+
+	/*!
+	* Method used for current image, CONV_DIRECT or CONV_FFT.
+	*/
+	ConvolutionMethod SelectedMethod();
+
+	/*!
+	* Larger of mask radii.
+	*/
+	int Radius();
+
+	/*!
+	* Tune direct kernel, FFT kernels use work-group size chosen by the driver.
+	*/
+	bool Autotune(cl_command_queue GPUCommandQueue, cl_device_id GPUDevice);
+
+	/*!
+	* Channels are filtered independently.
+	*/
+	bool PerChannel();
+};
@@ -20,6 +20,8 @@
 #include <ctype.h>
 #include <time.h>
 #include "GPUTransferManager.h"
+#include "ProgramRegistry.h"
+#include "WorkGroupTuner.h"
 
 using namespace std;
 
@@ -54,29 +56,45 @@ class Filter
         GPUTransferManager* GPUTransfer;
 
 		/*!
-		 * Loaded .cl file, which contain code responsible for image processing.
+		 * Program is formed by a set of kernels, functions and declarations, and it's represented by an cl_program object. Shared by filters, owned by ProgramRegistry.
 		 */
-        char* SourceOpenCLFilter;                 
+        cl_program GPUProgram;              
 
 		/*!
-		 * Loaded .cl file, which contain support function.
+		 * Kernels are essentially functions that we can call from the host and that will run on the device
 		 */
-		char* SourceOpenCL;              
+        cl_kernel GPUFilter;               
 
 		/*!
-		 * Program is formed by a set of kernels, functions and declarations, and it's represented by an cl_program object.
+		 * Global size of NDRange, third dimension is number of images in batch.
 		 */
-        cl_program GPUProgram;              
+        size_t GPUGlobalWorkSize[3];        
 
 		/*!
-		 * Kernels are essentially functions that we can call from the host and that will run on the device
+		 * Name of kernel, used in profiling records.
 		 */
-        cl_kernel GPUFilter;               
+        string KernelName;
+
+		/*!
+		 * Owner key of scratch buffers of the filter, see GPUTransferManager::Scratch().
+		 */
+        int iScratchOwner;
+
+		/*!
+		 * Compute NDRange covering the image with work-groups iBlockDimX x iBlockDimY and enqueue the kernel.
+		 * Event of the kernel is recorded if profiling is on.
+		 */
+        bool EnqueueKernel(cl_command_queue GPUCommandQueue);
+
+		/*!
+		 * Enqueue other kernel of the filter over the same NDRange, profiling record is named by name.
+		 */
+        bool EnqueueKernel(cl_command_queue GPUCommandQueue, cl_kernel kernel, const char* name);
 
 		/*!
-		 * Global size of NDRange.
+		 * Size of local memory of the device of transfer manager in bytes.
 		 */
-        size_t GPUGlobalWorkSize[2];        
+        cl_ulong LocalMemSize();
 
     public:
 
@@ -87,6 +105,7 @@ class Filter
 
 		/*!
 		 * Constructor, creates a program object for a context, loads the source code (.cl files) and build the program.
+		 * If context is NULL filter works in host mode and nothing is built.
 		 */
         Filter(char* , cl_context GPUContext  ,GPUTransferManager*  ,char* );
 
@@ -99,6 +118,33 @@ class Filter
 		 * Virtual methods, processing image. Launching the Kernel.
 		 */
 		virtual bool filter(cl_command_queue GPUCommandQueue) = 0;
+
+		/*!
+		 * Process image in host buffers of transfer manager, used when no OpenCL device is available.
+		 * Result is the same as result of filter(). Return false if filter has no host implementation.
+		 */
+		virtual bool filterHost();
+        
+		/*!
+		 * Number of neighbour rows and columns read on each side of output pixel, 1 for 3x3 filters.
+		 */
+		virtual int Radius();
+
+		/*!
+		 * Channels are filtered independently, filter can process planes of LAYOUT_PLANAR. False by default.
+		 */
+		virtual bool PerChannel();
+
+		/*!
+		 * Set transfer manager whose buffers are processed by the filter.
+		 */
+		virtual void SetTransfer(GPUTransferManager* transfer);
+
+		/*!
+		 * Benchmark valid work-group sizes on current input image and store the fastest one in tuning file.
+		 * Queue must be created with CL_QUEUE_PROFILING_ENABLE.
+		 */
+		virtual bool Autotune(cl_command_queue GPUCommandQueue, cl_device_id GPUDevice);
         
 		/*!
 		 * Check error code.
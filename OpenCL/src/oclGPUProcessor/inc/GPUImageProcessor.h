@@ -21,6 +21,11 @@
 #include "GPUTransferManager.h"
 #include "Filter.h"
 
+/*!
+ * Device type of host backend, filters are run by filterHost() on all processors of the host.
+ */
+#define DEVICE_TYPE_HOST ((cl_device_type)0)
+
 using namespace std;
 
 /*!
@@ -67,6 +72,116 @@ class GPUImageProcessor
 		 * List of pointer to processing objects.
 		 */
         vector<Filter*> filters;        
+
+		/*!
+		 * Command-queue for uploads of streamed frames, overlap with kernels of previous frame.
+		 */
+        cl_command_queue GPUUploadQueue;
+
+		/*!
+		 * Command-queue for downloads of streamed frames, overlap with kernels of next frame.
+		 */
+        cl_command_queue GPUDownloadQueue;
+
+		/*!
+		 * Number of in-flight frames in streaming mode, 0 if streaming is off.
+		 */
+        int nStreamFrames;
+
+		/*!
+		 * Number of frames submitted to the stream.
+		 */
+        int iStreamSubmitted;
+
+		/*!
+		 * Number of frames returned from the stream.
+		 */
+        int iStreamReturned;
+
+		/*!
+		 * Download events of frame slots.
+		 */
+        vector<cl_event> StreamEvents;
+
+		/*!
+		 * Properties of created command-queues, CL_QUEUE_PROFILING_ENABLE in profiling mode.
+		 */
+        cl_command_queue_properties QueueProperties;
+
+		/*!
+		 * Command-queues of all devices, used in strip mode.
+		 */
+        vector<cl_command_queue> DeviceQueues;
+
+		/*!
+		 * Transfer managers of all devices, each one holds one strip with halo.
+		 */
+        vector<GPUTransferManager*> DeviceTransfers;
+
+		/*!
+		 * Number of rows allocated in strip buffers.
+		 */
+        int iStripCapacity;
+
+		/*!
+		 * Width of images allocated in strip buffers.
+		 */
+        int iStripWidth;
+
+		/*!
+		 * Command-queues of two tile slots in tiled mode, upload of one tile overlaps processing of the other.
+		 */
+        cl_command_queue TileQueues[2];
+
+		/*!
+		 * Transfer managers of two tile slots in tiled mode.
+		 */
+        GPUTransferManager* TileTransfers[2];
+
+		/*!
+		 * Number of rows allocated in tile buffers.
+		 */
+        int iTileCapacity;
+
+		/*!
+		 * Width of images allocated in tile buffers.
+		 */
+        int iTileWidth;
+
+		/*!
+		 * Sum of radii of all filters, number of halo rows needed on each side of a strip.
+		 */
+        int ChainRadius();
+
+		/*!
+		 * Run all filters on given queue and transfer manager, after each filter input and output buffers are swapped.
+		 */
+        void RunChain(cl_command_queue queue, GPUTransferManager* transfer);
+
+		/*!
+		 * Enqueue upload of rows [first, last) with halo, all filters and download of rows [first, last) to output.
+		 */
+        void ProcessBand(cl_command_queue queue, GPUTransferManager* transfer, IplImage* input, IplImage* output, int first, int last, int radius);
+
+		/*!
+		 * Release queues and buffers of strip mode.
+		 */
+        void ReleaseDevices();
+
+		/*!
+		 * Release queues and buffers of tiled mode.
+		 */
+        void ReleaseTiles();
+
+		/*!
+		 * Switch to host backend, OpenCL isn't used.
+		 */
+        void UseHost(int width, int height, int nChannels, bool profiling);
+
+		/*!
+		 * Process whole image on the host and copy result to output image.
+		 */
+        void ProcessHost(IplImage* input, IplImage* output);
     
     public:
  
@@ -87,16 +202,99 @@ class GPUImageProcessor
 		GPUTransferManager* Transfer;
 
 		/*!
-		 * Constructor , Get the number of GPU devices available to the platform, and create the device list.
-		 * Create the OpenCL context on a GPU device and create command-queue.
+		 * Timings of kernels and transfers, NULL if profiling is off. Use Profiler->Print() or Profiler->GetRecords() to read them.
+		 */
+		GPUProfiler* Profiler;
+
+		/*!
+		 * Constructor , Get devices of given type (CL_DEVICE_TYPE_GPU, CL_DEVICE_TYPE_CPU, CL_DEVICE_TYPE_ACCELERATOR, CL_DEVICE_TYPE_ALL) available to the platform,
+		 * and create the device list. platformIndex -1 selects platform by oclGetPlatformID, deviceIndex -1 selects device with the highest
+		 * compute units * clock product. Create the OpenCL context on all devices of given type and command-queue on selected device.
+		 * In profiling mode queues are created with CL_QUEUE_PROFILING_ENABLE and every kernel and transfer is recorded in Profiler.
+		 * DEVICE_TYPE_HOST selects host backend, it's also used when no platform or device is found. In host mode GPUContext is NULL,
+		 * filters created with it run on the host with the same results.
 		 */
-        GPUImageProcessor(int width,int height,int nChannels);
+        GPUImageProcessor(int width,int height,int nChannels,cl_device_type deviceType = CL_DEVICE_TYPE_GPU,int deviceIndex = 0,int platformIndex = -1,bool profiling = false);
 
 		/*!
-		 * Start image processing. For each element of the image processing list called method filter().
+		 * Start image processing. For each element of the image processing list called method filter(), after each filter input and output buffers are swapped.
 		 */
         void Process();
 
+		/*!
+		 * Non-blocking processing. Enqueue upload, all filters and download and return handle of the download.
+		 * Use Wait() or OnComplete() of the handle to get the result, handle must be deleted by caller. Result stays valid until
+		 * the handle is released or deleted, next calls block while all staging buffers are held by unreleased results.
+		 */
+        TransferHandle* ProcessAsync(IplImage* input);
+
+		/*!
+		 * Zero-copy processing. Input is wrapped with CL_MEM_USE_HOST_PTR when it is dense and aligned (it is overwritten by filters),
+		 * otherwise it is uploaded. Result is mapped, not read. Returned image is valid until ReleaseZeroCopy().
+		 */
+        IplImage* ProcessZeroCopy(IplImage* input);
+
+		/*!
+		 * Pinned input buffer, caller decodes next frame into it and calls ProcessAcquired().
+		 */
+        IplImage* AcquireFrame();
+
+		/*!
+		 * Process frame written to buffer returned by AcquireFrame(). Result is mapped and valid until ReleaseZeroCopy().
+		 */
+        IplImage* ProcessAcquired();
+
+		/*!
+		 * Unmap result of zero-copy processing and release wrapped input.
+		 */
+        void ReleaseZeroCopy();
+
+		/*!
+		 * Split image into horizontal strips, one per device, proportional to number of compute units. Each strip is uploaded with
+		 * halo of ChainRadius() rows, processed by all filters on its device in parallel and stitched into output image.
+		 */
+        void ProcessStrips(IplImage* input, IplImage* output);
+
+		/*!
+		 * Process image larger than device memory. Image is cut into full-width tiles, each tile is uploaded with halo of ChainRadius() rows,
+		 * processed and downloaded to output image. Two tiles are in flight, upload of the next tile overlaps processing of the current one.
+		 * maxTileBytes limits size of one device buffer, 0 derive it from CL_DEVICE_MAX_MEM_ALLOC_SIZE and CL_DEVICE_GLOBAL_MEM_SIZE.
+		 */
+        bool ProcessTiled(IplImage* input, IplImage* output, size_t maxTileBytes = 0);
+
+		/*!
+		 * Process images of the same size in one batch. Images are packed into one device buffer and each filter is launched once for all of them.
+		 * Return false if images differ in size or number of channels, output images are left untouched then.
+		 */
+        bool ProcessBatch(IplImage** input, IplImage** output, int count);
+
+		/*!
+		 * Start streaming mode with given number of in-flight frames. Upload of frame k+1 and download of frame k-1 overlap kernels of frame k.
+		 */
+        void StartStreaming(int frames = 3);
+
+		/*!
+		 * Submit frame to the stream. Return processed frame submitted (frames - 1) calls earlier, or NULL while the pipeline is filling.
+		 * Returned image is valid until next call.
+		 */
+        IplImage* ProcessFrame(IplImage* frame);
+
+		/*!
+		 * Return oldest frame still in the stream (blocking), NULL if stream is empty.
+		 */
+        IplImage* FlushFrame();
+
+		/*!
+		 * Wait for in-flight frames and stop streaming mode.
+		 */
+        void StopStreaming();
+
+		/*!
+		 * Find the fastest work-group size of every filter on given sample image and store it in tuning file.
+		 * Filters created later use stored sizes. Returns false if some filter couldn't be tuned.
+		 */
+        bool Autotune(IplImage* sample);
+
 		/*!
 		 * Add filters to image processing list.
 		 */
@@ -0,0 +1,92 @@
+/*!
+ * \file GPUProfiler.h
+ * \brief File contains class responsible for collecting device timings of kernels and transfers.
+ */
+
+#pragma once
+
+#include "oclUtils.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <stdio.h>
+
+using namespace std;
+
+/*!
+ * \struct ProfileRecord
+ * \brief Timestamps of one command in nanoseconds, taken from device counter.
+ */
+struct ProfileRecord
+{
+	/*!
+	 * Name of kernel or transfer.
+	 */
+	string Name;
+
+	/*!
+	 * Command was enqueued by the host.
+	 */
+	cl_ulong Queued;
+
+	/*!
+	 * Command was submitted to the device.
+	 */
+	cl_ulong Submit;
+
+	/*!
+	 * Command started execution.
+	 */
+	cl_ulong Start;
+
+	/*!
+	 * Command finished execution.
+	 */
+	cl_ulong End;
+};
+
+/*!
+ * \class GPUProfiler
+ * \brief Collect events of kernels and transfers enqueued on queues created with CL_QUEUE_PROFILING_ENABLE.
+ */
+class GPUProfiler
+{
+	private:
+
+		/*!
+		 * Names of recorded commands.
+		 */
+		vector<string> Names;
+
+		/*!
+		 * Events of recorded commands, released by Reset().
+		 */
+		vector<cl_event> Events;
+
+	public:
+
+		/*!
+		 * Destructor. Release events.
+		 */
+		~GPUProfiler();
+
+		/*!
+		 * Store event of enqueued command, profiler takes ownership of the event.
+		 */
+		void Record(const char* name, cl_event event);
+
+		/*!
+		 * Wait for recorded commands and return their timestamps, in order of recording.
+		 */
+		vector<ProfileRecord> GetRecords();
+
+		/*!
+		 * Print table of recorded commands. Times in milliseconds, relative to the first queued command.
+		 */
+		void Print();
+
+		/*!
+		 * Release recorded events.
+		 */
+		void Reset();
+};
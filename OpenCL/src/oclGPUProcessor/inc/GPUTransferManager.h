@@ -11,6 +11,7 @@
 #include "oclUtils.h"
 #include <iostream>
 #include <vector>
+#include <map>
 #include <string>
 #include "cv.h"
 #include "cxmisc.h"
@@ -19,9 +20,52 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <time.h>
+#include "GPUProfiler.h"
+#include "TransferHandle.h"
+#include "HostSync.h"
 
 using namespace std;
 
+/*!
+ * Number of pinned staging buffers used in turn by uploads and downloads.
+ */
+#define STAGING_BUFFERS 3
+
+/*!
+ * Alignment in bytes of rows of device images, rows are padded so each one starts a new memory transaction.
+ */
+#define DEVICE_ROW_ALIGN 128
+
+/*!
+ * Path of host memory used by SendImage().
+ */
+enum UploadMode
+{
+	UPLOAD_PAGEABLE,	/*!< Write directly from image data, driver stages pageable memory itself. */
+	UPLOAD_PINNED,		/*!< Copy to pinned staging buffer and write asynchronously from it. */
+	UPLOAD_MAPPED		/*!< Map device buffer for writing and copy image into it. */
+};
+
+/*!
+ * Layout of channels of device image.
+ */
+enum ChannelLayout
+{
+	LAYOUT_INTERLEAVED,	/*!< Device image has channels of host image, BGR pixels are 3 bytes. */
+	LAYOUT_RGBA,		/*!< 3-channel images are expanded to 4 channels on the device, kernels load each pixel with one vload4. */
+	LAYOUT_PLANAR		/*!< One plane per channel, planes are processed like images of a batch. Filters mixing channels get interleaved image. */
+};
+
+/*!
+ * Device buffer used by a filter between its kernels, owned by transfer manager.
+ */
+struct ScratchBuffer
+{
+	cl_mem Buffer;		/*!< Buffer object, NULL until it is created. */
+	size_t Bytes;		/*!< Size of Buffer in bytes. */
+	cl_ulong Stamp;		/*!< Set by the filter to mark what the buffer holds, 0 when the buffer is created. */
+};
+
 /*!
  * \class GPUTransferManager
  * \brief Class responsible for managing transfer between GPU and CPU.
@@ -58,6 +102,300 @@ class GPUTransferManager
 		 * Image return from buffer.
 		 */
         IplImage* image;                   
+
+		/*!
+		 * Number of frame slots allocated for streaming, 0 if streaming is off.
+		 */
+        int nFrames;
+
+		/*!
+		 * Device buffers of frame slots, two (input, output) per slot.
+		 */
+        vector<cl_mem> cmFrameBuf;
+
+		/*!
+		 * Pinned host buffers for uploads, one per slot.
+		 */
+        vector<cl_mem> cmFramePinnedIn;
+
+		/*!
+		 * Pinned host buffers for downloads, one per slot.
+		 */
+        vector<cl_mem> cmFramePinnedOut;
+
+		/*!
+		 * Mapped pointers to pinned upload buffers.
+		 */
+        vector<char*> FrameHostIn;
+
+		/*!
+		 * Mapped pointers to pinned download buffers.
+		 */
+        vector<char*> FrameHostOut;
+
+		/*!
+		 * Image headers returned for each slot, data points to pinned download buffer.
+		 */
+        vector<IplImage*> FrameImage;
+
+		/*!
+		 * Slot bound to cmDevBuf and cmDevBufOut, -1 for default buffers.
+		 */
+        int iBoundFrame;
+
+		/*!
+		 * Default buffers, kept aside while a frame slot is bound.
+		 */
+        cl_mem cmDefaultBuf[2];
+
+		/*!
+		 * Size in bytes of cmDevBuf and cmDevBufOut.
+		 */
+        size_t szDevBuffCapacity;
+
+		/*!
+		 * Pinned staging buffers, first one is cmPinnedBuf.
+		 */
+        cl_mem cmStagingBuf[STAGING_BUFFERS];
+
+		/*!
+		 * Mapped pointers to staging buffers.
+		 */
+        char* StagingHost[STAGING_BUFFERS];
+
+		/*!
+		 * Last transfer using each staging buffer, NULL if buffer is free.
+		 */
+        cl_event StagingEvent[STAGING_BUFFERS];
+
+		/*!
+		 * Image headers of staging buffers, returned by BeginReceiveImage().
+		 */
+        IplImage* StagingImage[STAGING_BUFFERS];
+
+		/*!
+		 * Next staging buffer.
+		 */
+        int iStagingSlot;
+
+		/*!
+		 * Size in bytes of each staging buffer.
+		 */
+        size_t szStagingBytes;
+
+		/*!
+		 * Scratch buffers of filters, key is owner and index of the buffer.
+		 */
+        map< pair<int, int>, ScratchBuffer > ScratchBuffers;
+
+		/*!
+		 * Last key returned by NewScratchOwner().
+		 */
+        static int iScratchOwners;
+
+		/*!
+		 * Pageable buffer of ReceiveImage() for images bigger than staging buffers, NULL until it is needed.
+		 */
+        char* ReadHost;
+
+		/*!
+		 * Size in bytes of ReadHost.
+		 */
+        size_t szReadBytes;
+
+		/*!
+		 * Number of handles and pending callbacks using image of each staging buffer, buffer isn't reused while it is held.
+		 */
+        int StagingHolds[STAGING_BUFFERS];
+
+		/*!
+		 * Lock of StagingHolds, holds are released on consumer threads.
+		 */
+        HostMutex StagingLock;
+
+		/*!
+		 * Signalled when hold of a staging buffer is released.
+		 */
+        HostCond StagingReleased;
+
+		/*!
+		 * Set holds of staging buffers to zero and create their lock.
+		 */
+        void InitStagingHolds();
+
+		/*!
+		 * Take next staging buffer, wait until its previous transfer is done and its image is released. Return -1 if image doesn't fit.
+		 */
+        int AcquireStaging();
+
+		/*!
+		 * Copy image to staging buffer and enqueue non-blocking write from it. Event is stored in StagingEvent.
+		 */
+        bool UploadStaging( IplImage* , int slot , cl_mem buffer );
+
+		/*!
+		 * Buffer created with CL_MEM_USE_HOST_PTR on caller's image, NULL if no image is wrapped.
+		 */
+        cl_mem cmWrapBuf;
+
+		/*!
+		 * Pinned buffer handed out by AcquireHostImage().
+		 */
+        cl_mem cmZeroCopyBuf;
+
+		/*!
+		 * Mapped pointer to cmZeroCopyBuf, NULL while the buffer is unmapped.
+		 */
+        char* ZeroCopyHost;
+
+		/*!
+		 * Image header of pinned buffer handed out by AcquireHostImage().
+		 */
+        IplImage* ZeroCopyImage;
+
+		/*!
+		 * Buffer mapped by MapImage(), NULL if nothing is mapped.
+		 */
+        cl_mem cmMappedBuf;
+
+		/*!
+		 * Image header returned by MapImage(), data points to mapped buffer.
+		 */
+        IplImage* MappedImage;
+
+		/*!
+		 * Default buffers, kept aside while zero-copy buffer is bound.
+		 */
+        cl_mem cmZeroCopySaved[2];
+
+		/*!
+		 * Zero-copy buffer is bound to cmDevBuf.
+		 */
+        bool bZeroCopyBound;
+
+		/*!
+		 * Alignment in bytes of host pointers wrapped with CL_MEM_USE_HOST_PTR, 0 if not queried yet.
+		 */
+        cl_uint uiHostAlign;
+
+		/*!
+		 * Image2d copy of input buffer read by image filters, NULL until it is used.
+		 */
+        cl_mem cmDevImage;
+
+		/*!
+		 * Width of cmDevImage.
+		 */
+        unsigned int uiDevImageWidth;
+
+		/*!
+		 * Height of cmDevImage.
+		 */
+        unsigned int uiDevImageHeight;
+
+		/*!
+		 * Device buffer of packed 3-channel rows, expanded to cmDevBuf after upload and packed from it before download in LAYOUT_RGBA.
+		 */
+        cl_mem cmPackedBuf;
+
+		/*!
+		 * Size in bytes of cmPackedBuf.
+		 */
+        size_t szPackedBytes;
+
+		/*!
+		 * Program of layout conversion kernels, NULL until LAYOUT_RGBA is used.
+		 */
+        cl_program GPULayoutProgram;
+
+		/*!
+		 * Kernel expanding 3-channel rows to 4 channels.
+		 */
+        cl_kernel ckExpand;
+
+		/*!
+		 * Kernel packing 4-channel rows to 3 channels.
+		 */
+        cl_kernel ckPack;
+
+		/*!
+		 * Kernel splitting interleaved rows to planes.
+		 */
+        cl_kernel ckSplit;
+
+		/*!
+		 * Kernel merging planes to interleaved rows.
+		 */
+        cl_kernel ckMerge;
+
+		/*!
+		 * Layout is applied to images of HostChannels channels.
+		 */
+        bool ConvertsLayout();
+
+		/*!
+		 * Build layout kernels and make cmPackedBuf big enough for packed image. Return false if it failed.
+		 */
+        bool PrepareLayout();
+
+		/*!
+		 * Run layout kernel from source buffer with rows of uiSourcePitch bytes to destination buffer with rows of ImagePitch bytes.
+		 * Interleaved side of the conversion has HostChannels channels.
+		 */
+        bool RunLayoutKernel(cl_kernel kernel, cl_mem source, cl_mem dest, unsigned int uiSourcePitch, const char* name, cl_event* event);
+
+		/*!
+		 * Upload image to cmPackedBuf and convert it to Layout in cmDevBuf. Return event of the conversion kernel, NULL if it failed.
+		 */
+        cl_event SendConverted( IplImage* );
+
+		/*!
+		 * Convert cmDevBuf to interleaved rows in given buffer. Set interleaved layout, ImagePitch is the pitch of interleaved rows.
+		 * Return false if it failed.
+		 */
+        bool PackImage(cl_mem dest);
+
+		/*!
+		 * Set DeviceLayout and number of channels of device image, update ImagePitch.
+		 */
+        void SetDeviceLayout(ChannelLayout layout);
+
+		/*!
+		 * Grow device buffers to given size, content is lost. Host buffers grow in host mode.
+		 * Return false if allocation failed, buffers are released then.
+		 */
+        bool ReserveDeviceBuffers(size_t bytes);
+
+		/*!
+		 * Set zero-copy members to initial state.
+		 */
+        void InitZeroCopy();
+
+		/*!
+		 * Bind buffer as cmDevBuf, default buffers are restored by UnmapImage().
+		 */
+        void BindZeroCopy(cl_mem buffer);
+
+		/*!
+		 * Set image size, ImagePitch and szBuffBytes.
+		 */
+        void SetImageSize(unsigned int width, unsigned int height);
+
+		/*!
+		 * Copy rows of the image between host memory with different row lengths.
+		 */
+        void CopyRows(char* dst, int dstStep, const char* src, int srcStep, int rows);
+
+		/*!
+		 * Write image rows [firstRow, firstRow + rows) to device buffer at given offset. Padded host rows
+		 * (widthStep != ImagePitch) are written with clEnqueueWriteBufferRect, or row by row with OpenCL 1.0.
+		 */
+        void WriteRows(cl_mem buffer, size_t offset, IplImage* , int firstRow, int rows, cl_bool blocking, const char* name);
+
+		/*!
+		 * Read device buffer rows starting at given offset to image rows [firstRow, firstRow + rows).
+		 */
+        void ReadRows(cl_mem buffer, size_t offset, IplImage* , int firstRow, int rows, cl_bool blocking, const char* name);
 		
 
     public:
@@ -73,10 +411,25 @@ class GPUTransferManager
         cl_context GPUContext;    
 
 		/*!
-		 * OpenCL device memory input/output buffer object.
+		 * Device of GPUCommandQueue, filters query limits and tuned work-group sizes of this device. NULL in host mode.
+		 */
+        cl_device_id GPUDevice;
+
+		/*!
+		 * OpenCL device memory input buffer object. Filters read the image from this buffer.
 		 */
         cl_mem cmDevBuf;                 
 
+		/*!
+		 * OpenCL device memory output buffer object. Filters write the result to this buffer, after each filter buffers are swapped.
+		 */
+        cl_mem cmDevBufOut;
+
+		/*!
+		 * Profiler of transfers and kernels, NULL if profiling is off.
+		 */
+        GPUProfiler* Profiler;
+
 		/*!
 		 * Image width.
 		 */
@@ -88,17 +441,64 @@ class GPUTransferManager
         unsigned int ImageHeight;  
 
 		/*!
-		 * Number of color channels.
+		 * Number of color channels of device image, kernels address pixels with it. It is 4 for 3-channel images in LAYOUT_RGBA.
 		 */
 		int nChannels;
 
+		/*!
+		 * Number of color channels of host images.
+		 */
+		int HostChannels;
+
+		/*!
+		 * Layout used by SendImage() and ReceiveImage() and their non-blocking variants, LAYOUT_INTERLEAVED by default.
+		 * Batches, rows, frame slots and zero-copy buffers always use interleaved layout. Ignored in host mode.
+		 */
+		ChannelLayout Layout;
+
+		/*!
+		 * Layout of image in device buffers, set by transfers.
+		 */
+		ChannelLayout DeviceLayout;
+
+		/*!
+		 * Length in bytes of row of device image, rows are padded to DEVICE_ROW_ALIGN bytes. Kernels address pixels with it.
+		 */
+		unsigned int ImagePitch;
+
+		/*!
+		 * Number of images stored one after another in device buffers, kernels are launched with third NDRange dimension of this size.
+		 */
+		int BatchSize;
+
+		/*!
+		 * Path used by SendImage(), UPLOAD_PINNED by default.
+		 */
+		UploadMode Upload;
+
+		/*!
+		 * Images are processed on the host, no OpenCL context is used.
+		 */
+		bool HostMode;
+
+		/*!
+		 * Host input buffer, filters read the image from this buffer in host mode.
+		 */
+		unsigned char* HostBuf;
+
+		/*!
+		 * Host output buffer, filters write the result to this buffer in host mode.
+		 */
+		unsigned char* HostBufOut;
+
 		/*!
 		 * Destructor. Release buffers.
 		 */
         ~GPUTransferManager();
 
         /*!
-		 * Constructor. Allocate pinned and mapped memory for input and output host image buffers.
+		 * Constructor. Allocate pinned and mapped memory for input and output host image buffers. If the image doesn't fit
+		 * the device only size is set, device buffers are created by the first transfer and no staging buffers are used.
 		 */
         GPUTransferManager( cl_context , cl_command_queue , unsigned int , unsigned int,  int nChannels );
 
@@ -108,16 +508,161 @@ class GPUTransferManager
         GPUTransferManager();
 
         /*!
-		 * Send image to GPU memory.
+		 * Constructor of host mode. Allocate host buffers, no OpenCL objects are created.
+		 */
+        GPUTransferManager( unsigned int , unsigned int,  int nChannels );
+
+		/*!
+		 * Length in bytes of row of device image of given width. Host buffers are dense in host mode.
+		 */
+        size_t RowPitch(unsigned int width);
+
+        /*!
+		 * Send image to GPU memory. Rows are read with widthStep of the image, padded OpenCV images are sent without repacking. In UPLOAD_PINNED mode image is copied to next staging buffer and the write is not blocking,
+		 * so copy of the next frame overlaps transfer of this one. Return false if buffers for the image couldn't be allocated.
 		 */
-        void SendImage( IplImage*  );
+        bool SendImage( IplImage*  );
 
         /*!
-		 * Get image from GPU memory.
+		 * Get image from GPU memory. Image data points to staging buffer, it stays valid for STAGING_BUFFERS - 1 next transfers.
+		 * Image bigger than staging buffers is read to pageable buffer, valid until next ReceiveImage(). Image widthStep is set to ImagePitch.
 		 */
         IplImage* ReceiveImage();
+
+		/*!
+		 * Enqueue non-blocking upload of image rows [firstRow, firstRow + rows) to the beginning of device buffer.
+		 * ImageHeight is set to rows. Image can't be modified until the queue is finished.
+		 */
+        void SendRows( IplImage* , int firstRow, int rows );
+
+		/*!
+		 * Enqueue non-blocking download of rows device buffer rows [deviceRow, deviceRow + rows) to image rows starting at firstRow.
+		 */
+        void ReceiveRows( IplImage* , int firstRow, int rows, int deviceRow );
+
+		/*!
+		 * Non-blocking SendImage(). Image is copied to staging buffer before return, so caller can reuse it at once.
+		 * Returned handle must be deleted by caller.
+		 */
+        TransferHandle* BeginSendImage( IplImage* );
+
+		/*!
+		 * Non-blocking ReceiveImage(). Image of returned handle points to staging buffer, which isn't reused until the handle
+		 * is released or deleted, so consumer on other thread can read it as long as it needs. Next transfers wait for the buffer,
+		 * at most STAGING_BUFFERS - 2 received images can be held while frames are sent and received. Returned handle must be deleted by caller.
+		 * Transfer manager itself isn't thread-safe, all Send/Receive calls must come from one thread.
+		 */
+        TransferHandle* BeginReceiveImage();
+
+		/*!
+		 * Add hold of staging buffer, called by TransferHandle for image of BeginReceiveImage().
+		 */
+        void HoldStaging(int slot);
+
+		/*!
+		 * Remove hold of staging buffer, transfer waiting for the buffer continues. Can be called from any thread.
+		 */
+        void ReleaseStaging(int slot);
+
+		/*!
+		 * Upload images of the same size to device buffers, one after another. Device buffers grow if needed.
+		 * Return false if images differ in size or number of channels, or buffers couldn't be allocated.
+		 */
+        bool SendBatch( IplImage** images, int count );
+
+		/*!
+		 * Download images of the batch. Output images must have size of uploaded images.
+		 */
+        void ReceiveBatch( IplImage** images, int count );
+
+		/*!
+		 * Scratch buffer of given owner and index, created on first use and grown to given size (content is lost then).
+		 * Every transfer manager has its own buffers, so a filter enqueued for strips or tiles on several queues doesn't
+		 * overwrite buffers of other queues. Return NULL in host mode or if allocation failed.
+		 */
+        ScratchBuffer* Scratch(int owner, int index, size_t bytes);
+
+		/*!
+		 * New key of owner of scratch buffers. Keys aren't reused, buffers of deleted filter are never handed to other one.
+		 */
+        static int NewScratchOwner();
+
+		/*!
+		 * Swap input and output device buffers, result of last filter become input of next filter.
+		 */
+        void SwapBuffers();
+
+		/*!
+		 * Allocate device and pinned host buffers for given number of in-flight frames.
+		 */
+        void AllocateFrames(int frames);
+
+		/*!
+		 * Release buffers of frame slots.
+		 */
+        void ReleaseFrames();
+
+		/*!
+		 * Bind buffers of frame slot to cmDevBuf and cmDevBufOut, -1 restore default buffers.
+		 */
+        void BindFrame(int frame);
+
+		/*!
+		 * Copy image to pinned buffer of bound slot and enqueue non-blocking upload. Event signals end of upload.
+		 */
+        void SendImageAsync( IplImage* , cl_command_queue , cl_event* );
+
+		/*!
+		 * Enqueue non-blocking download of bound slot, after wait list is completed. Returned image is valid after event is completed.
+		 */
+        IplImage* ReceiveImageAsync( cl_command_queue , cl_uint , const cl_event* , cl_event* );
+
+		/*!
+		 * Image header of frame slot, data points to its pinned download buffer.
+		 */
+        IplImage* GetFrameImage(int frame);
+
+		/*!
+		 * Zero-copy upload. Wrap image data with CL_MEM_USE_HOST_PTR and use it as input buffer, nothing is copied.
+		 * Image rows must be padded like device rows (widthStep == RowPitch(width)) and data aligned to CL_DEVICE_MEM_BASE_ADDR_ALIGN, otherwise false is returned.
+		 * Image is one of ping-pong buffers, so filters overwrite it. It can't be freed before UnmapImage().
+		 */
+        bool WrapImage( IplImage* );
+
+		/*!
+		 * Map pinned input buffer and return image header on it, caller decodes next frame directly into it.
+		 * Return NULL if buffers for the image couldn't be allocated.
+		 */
+        IplImage* AcquireHostImage();
+
+		/*!
+		 * Unmap buffer returned by AcquireHostImage() and use it as input buffer.
+		 */
+        void SubmitHostImage();
+
+		/*!
+		 * Map current input buffer (result of last filter) for reading. Returned image is valid until UnmapImage().
+		 */
+        IplImage* MapImage();
+
+		/*!
+		 * Unmap buffer mapped by MapImage(), release wrapped image and restore default buffers.
+		 */
+        void UnmapImage();
         
         
+		/*!
+		 * Image2d (CL_RGBA, CL_UNORM_INT8) of current image size, filled by image filters from cmDevBuf before they read it
+		 * through samplers. Created on first use, NULL in host mode or if the device can't create it.
+		 */
+        cl_mem InputImage();
+
+		/*!
+		 * Merge planes of planar device image to interleaved image in cmDevBuf, BatchSize is set to 1. Called before filters mixing channels.
+		 * Return false if it failed.
+		 */
+        bool Interleave();
+
 		/*!
 		 * Release all buffors.
 		 */
@@ -44,6 +44,11 @@ protected:
 	*/
 	void LoadMask(cl_mem* cmDevBufMask,int* mask,int count,GPUTransferManager* transfer);
 
+	/*!
+	* Set mask arguments of image kernel.
+	*/
+	bool SetImageArgs(cl_uint first);
+
 public:
 	
 
@@ -60,7 +65,12 @@ public:
 	/*!
 	* Start filtering. Launching GPU processing.
 	*/
-	bool filter(cl_command_queue GPUCommandQueue);;
+	bool filter(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Start filtering on the host.
+	*/
+	bool filterHost();
 
 };
 
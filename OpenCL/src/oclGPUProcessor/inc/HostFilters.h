@@ -0,0 +1,161 @@
+/*!
+ * \file HostFilters.h
+ * \brief File contains host implementations of filters, used when no OpenCL device is available.
+ */
+
+#pragma once
+
+/*!
+ * \struct HostJob
+ * \brief One run of host filter. Source and destination are dense images with interleaved channels.
+ * Like the kernels, only channels 0-2 are written and pixels outside of the image are zero.
+ */
+struct HostJob
+{
+	/*!
+	 * Input image.
+	 */
+	const unsigned char* Source;
+
+	/*!
+	 * Output image.
+	 */
+	unsigned char* Dest;
+
+	/*!
+	 * Image width.
+	 */
+	int Width;
+
+	/*!
+	 * Image height.
+	 */
+	int Height;
+
+	/*!
+	 * Number of color channels.
+	 */
+	int nChannels;
+
+	/*!
+	 * Convolution mask, vertical gradient mask or lookup table.
+	 */
+	const int* MaskA;
+
+	/*!
+	 * Horizontal gradient mask.
+	 */
+	const int* MaskB;
+
+	/*!
+	 * Binarization threshold.
+	 */
+	int Param;
+
+	/*!
+	 * Process pixels [x0, x1) x [y0, y1) of the job.
+	 */
+	void (*Kernel)(const HostJob* job, int x0, int y0, int x1, int y1);
+
+	/*!
+	 * Floating point parameter of job.
+	 */
+	float fParam;
+
+	/*!
+	 * Coefficients of separable pass, 2 * Radius + 1 taps.
+	 */
+	const float* Coeffs;
+
+	/*!
+	 * Number of taps on each side of output pixel.
+	 */
+	int Radius;
+
+	/*!
+	 * Float image between separable passes.
+	 */
+	float* Work;
+
+	/*!
+	 * Horizontal radius of float mask, Radius is the vertical one.
+	 */
+	int RadiusX;
+};
+
+/*!
+ * Number of worker threads, equal to number of processors.
+ */
+int HostThreadCount();
+
+/*!
+ * Run job on tiles of the image, tiles are spread over worker threads of TileScheduler.
+ */
+void HostRun(HostJob* job);
+
+/*!
+ * Convolution with 3x3 integer mask normalised by sum of the mask (ckConv).
+ * With radius larger than 1 mask has (2 * radius + 1)^2 coefficients and result is clamped to 0-255 (ckConvR).
+ */
+void HostConv(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, const int* mask, int radius = 1);
+
+/*!
+ * Gradient magnitude from horizontal and vertical 3x3 masks (ckGradient).
+ */
+void HostGradient(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, const int* maskH, const int* maskV);
+
+/*!
+ * Exact median of (2 * radius + 1)^2 window, same as ckMedian, ckMedianR and ckMedianHistogram.
+ */
+void HostMedian(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius = 1);
+
+/*!
+ * Minimum of (2 * radius + 1)^2 window (ckMin, ckMinR).
+ */
+void HostMin(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius = 1);
+
+/*!
+ * Maximum of (2 * radius + 1)^2 window (ckMax, ckMaxR).
+ */
+void HostMax(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius = 1);
+
+/*!
+ * Binary erosion of channel 0 with neighbours in (2 * radius + 1)^2 window (ckErode, ckErodeR).
+ */
+void HostErode(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius = 1);
+
+/*!
+ * Binary dilation of channel 1 with neighbours in (2 * radius + 1)^2 window (ckDilate, ckDilateR).
+ */
+void HostDilate(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius = 1);
+
+/*!
+ * Lookup table (ckLUT).
+ */
+void HostLUT(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, const int* lut);
+
+/*!
+ * Binarization of gray level 0.3 * (R + G + B) (ckBin).
+ */
+void HostBinarization(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int threshold);
+
+/*!
+ * Convolution with row and then column coefficients in float, edge pixels are repeated (ckSeparableRow, ckSeparableColumn).
+ */
+void HostSeparable(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, const float* row, int rowRadius, const float* col, int colRadius);
+
+/*!
+ * Convolution with (2 * radiusX + 1) x (2 * radiusY + 1) float mask in row-major order, rounded once (ckConvFloat).
+ */
+void HostConvFloat(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, const float* mask, int radiusX, int radiusY);
+
+/*!
+ * Mean of (2 * radius + 1)^2 window by running sums, same as HostConv with mask of ones (ckBoxRows, ckBoxColumns).
+ */
+void HostBoxMean(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius);
+
+/*!
+ * Minimum or maximum over line of length pixels starting before pixels ahead of output, along rows or columns.
+ * Pixels outside of the image are neutral (ckRectRows, ckRectColumns).
+ */
+void HostRectMorphology(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int length, int before, bool vertical, bool isMax);
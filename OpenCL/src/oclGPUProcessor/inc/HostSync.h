@@ -0,0 +1,45 @@
+/*!
+ * \file HostSync.h
+ * \brief File contains portable mutex, condition variable and thread entry point used by host threads.
+ */
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef CRITICAL_SECTION HostMutex;
+typedef CONDITION_VARIABLE HostCond;
+
+#define MutexInit(m) InitializeCriticalSection(&(m))
+#define MutexDestroy(m) DeleteCriticalSection(&(m))
+#define MutexLock(m) EnterCriticalSection(&(m))
+#define MutexUnlock(m) LeaveCriticalSection(&(m))
+#define CondInit(c) InitializeConditionVariable(&(c))
+#define CondDestroy(c)
+#define CondWait(c, m) SleepConditionVariableCS(&(c), &(m), INFINITE)
+#define CondSignal(c) WakeConditionVariable(&(c))
+#define CondBroadcast(c) WakeAllConditionVariable(&(c))
+
+// Exact CUT_THREADROUTINE signature, entry points take void* and are passed to cutStartThread() without a cast
+#define HOST_THREADPROC unsigned WINAPI
+#define HOST_THREADEND return 0
+#else
+#include <pthread.h>
+
+typedef pthread_mutex_t HostMutex;
+typedef pthread_cond_t HostCond;
+
+#define MutexInit(m) pthread_mutex_init(&(m), NULL)
+#define MutexDestroy(m) pthread_mutex_destroy(&(m))
+#define MutexLock(m) pthread_mutex_lock(&(m))
+#define MutexUnlock(m) pthread_mutex_unlock(&(m))
+#define CondInit(c) pthread_cond_init(&(c), NULL)
+#define CondDestroy(c) pthread_cond_destroy(&(c))
+#define CondWait(c, m) pthread_cond_wait(&(c), &(m))
+#define CondSignal(c) pthread_cond_signal(&(c))
+#define CondBroadcast(c) pthread_cond_broadcast(&(c))
+
+#define HOST_THREADPROC void*
+#define HOST_THREADEND return NULL
+#endif
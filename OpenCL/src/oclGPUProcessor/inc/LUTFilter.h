@@ -52,5 +52,15 @@ public:
 	*/
 	bool filter(cl_command_queue GPUCommandQueue);
 
+	/*!
+	* Start filtering on the host.
+	*/
+	bool filterHost();
+
+	/*!
+	* Channels are filtered independently.
+	*/
+	bool PerChannel();
+
 };
 
@@ -24,6 +24,11 @@ protected:
 	*/
 	int* mask;
 
+	/*!
+	* Number of mask coefficients, (2 * radius + 1)^2.
+	*/
+	int maskCount;
+
 	/*!
 	* OpenCL device memory input buffer for mask.
 	*/
@@ -34,6 +39,16 @@ protected:
 	*/
 	void LoadMask(int* mask, int count,GPUTransferManager* transfer);
 
+	/*!
+	* Set mask arguments of image kernel.
+	*/
+	bool SetImageArgs(cl_uint first);
+
+	/*!
+	* Set mask arguments of stencil kernel.
+	*/
+	bool SetStencilArgs(cl_uint first);
+
 public:
 
 	/*!
@@ -51,6 +66,21 @@ public:
 	*/
 	bool filter(cl_command_queue GPUCommandQueue);
 
+	/*!
+	* Start filtering on the host.
+	*/
+	bool filterHost();
+
+	/*!
+	* Channels are filtered independently.
+	*/
+	bool PerChannel();
+
+	/*!
+	* Select radius of window, mask must have (2 * radius + 1)^2 coefficients.
+	*/
+	bool SetRadius(int radius);
+
 
 };
 
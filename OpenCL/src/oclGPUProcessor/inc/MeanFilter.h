@@ -8,6 +8,11 @@
 #pragma once
 #include "LowpassFilter.h"
 
+/*!
+ * Shortest segment of running sum of one work item of box mean, first sum of a segment costs 2 * radius + 1 reads.
+ */
+#define BOX_MIN_SEGMENT 32
+
 /*!
  * \class MeanFilter
  * \brief Mean filter. Mean filtering is a simple, intuitive and easy to implement method of smoothing images, i.e. reducing the amount of intensity variation between one pixel and the next. It is often used to reduce noise in images.
@@ -17,6 +22,32 @@
 class MeanFilter :
 	public LowpassFilter
 {
+private:
+
+	/*!
+	* Program built from BoxFilter.cl, NULL until radius larger than 1 is selected.
+	*/
+	cl_program GPUBoxProgram;
+
+	/*!
+	* Kernel of horizontal running sums.
+	*/
+	cl_kernel ckBoxRows;
+
+	/*!
+	* Kernel of vertical running sums and division.
+	*/
+	cl_kernel ckBoxColumns;
+
+	/*!
+	* Build box mean program, nothing to do in host mode.
+	*/
+	bool PrepareBox();
+
+	/*!
+	* Box mean of radius iRadius in two running-sum passes. Horizontal sums in uint go to a scratch buffer of the transfer manager.
+	*/
+	bool filterBox(cl_command_queue GPUCommandQueue);
 
 public:
 
@@ -28,7 +59,22 @@ public:
 	/*!
 	* Constructor. Send mask to GPU memory. Creates a program object for a context, loads the source code (.cl files) and build the program.
 	*/
-	MeanFilter(cl_context GPUContext ,GPUTransferManager* transfer);
+	MeanFilter(cl_context GPUContext ,GPUTransferManager* transfer, int radius = 1);
+
+	/*!
+	* Select radius of window. Radius 1 runs ckConv, larger radius runs box mean with cost per pixel independent of radius.
+	*/
+	bool SetRadius(int radius);
+
+	/*!
+	* Start filtering. Launching GPU processing.
+	*/
+	bool filter(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Start filtering on the host.
+	*/
+	bool filterHost();
 	
 };
 
@@ -8,15 +8,54 @@
 #pragma once
 #include "NonLinearFilter.h"
 
+/*!
+ * Smallest radius filtered with sliding histogram, 3x3 and 5x5 use sorting networks.
+ */
+#define MEDIAN_HISTOGRAM_RADIUS 3
+
+/*!
+ * Shortest segment of sliding histogram of one work item, first window of a segment costs (2 * radius + 1)^2 updates.
+ */
+#define MEDIAN_MIN_SEGMENT 32
+
+/*!
+ * Largest work-group of histogram kernel, every work item needs its own histograms in local memory.
+ */
+#define MEDIAN_MAX_GROUP 64
+
 /*!
  * \class MedianFilter
- * \brief Median filter.
+ * \brief Median filter. 3x3 and 5x5 windows are sorted by min/max networks in registers, windows from 7x7
+ * (despeckling of scanned documents needs up to 15x15) by histogram sliding along rows, cost per pixel grows
+ * linearly with radius.
  * \author Mateusz Pruchniak
  * \date 2010-05-05
  */
 class MedianFilter :
 	public NonLinearFilter
 {
+private:
+
+	/*!
+	* Program built from MedianHistogram.cl, NULL until radius MEDIAN_HISTOGRAM_RADIUS or larger is selected.
+	*/
+	cl_program GPUHistogramProgram;
+
+	/*!
+	* Kernel of sliding histogram median.
+	*/
+	cl_kernel ckHistogram;
+
+	/*!
+	* Build histogram median program, nothing to do in host mode.
+	*/
+	bool PrepareHistogram();
+
+	/*!
+	* Median of radius iRadius from sliding histograms. Falls back to stencil kernel if histograms of one work item don't fit in local memory.
+	*/
+	bool filterHistogram(cl_command_queue GPUCommandQueue);
+
 public:
 
 	/*!
@@ -29,9 +68,24 @@ public:
 	*/
 	MedianFilter(cl_context GPUContext ,GPUTransferManager* transfer);
 
+	/*!
+	* Select radius of window. Radius 1 and 2 run sorting networks, larger radius runs sliding histogram.
+	*/
+	bool SetRadius(int radius);
+
 	/*!
 	* Start filtering. Launching GPU processing.
 	*/
 	bool filter(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Start filtering on the host.
+	*/
+	bool filterHost();
+
+	/*!
+	* Channels are filtered independently.
+	*/
+	bool PerChannel();
 };
 
@@ -0,0 +1,55 @@
+/*!
+ * \file ProgramCache.h
+ * \brief File contains class responsible for caching compiled programs on disk.
+ */
+
+#pragma once
+
+#include "oclUtils.h"
+#include <iostream>
+#include <string>
+#include <stdio.h>
+
+using namespace std;
+
+/*!
+ * \class ProgramCache
+ * \brief Persistent cache of program binaries. Each entry is keyed on program source, device name, driver version and build options.
+ */
+class ProgramCache
+{
+	private:
+
+		/*!
+		 * Directory with cached binaries.
+		 */
+		static string CacheDirectory;
+
+		/*!
+		 * Compute key of cache entry for given device.
+		 */
+		static string GetKey(cl_device_id device, const char* source, size_t length, const char* options);
+
+		/*!
+		 * Load binary from cache file, return NULL if entry doesn't exist.
+		 */
+		static unsigned char* LoadBinary(const string& key, size_t* length);
+
+		/*!
+		 * Save binary to cache file.
+		 */
+		static void SaveBinary(const string& key, const char* binary, size_t length);
+
+	public:
+
+		/*!
+		 * Set directory with cached binaries. Default is ./cache or GPUPROCESSOR_CACHE environment variable.
+		 */
+		static void SetDirectory(const char* directory);
+
+		/*!
+		 * Create and build program for all devices in the context. Binaries are loaded from cache if possible,
+		 * otherwise program is built from source and binaries are stored in cache.
+		 */
+		static cl_program BuildProgram(cl_context GPUContext, const char* source, size_t length, const char* options, cl_int* error);
+};
@@ -0,0 +1,65 @@
+/*!
+ * \file ProgramRegistry.h
+ * \brief File contains process-wide registry of built programs.
+ */
+
+#pragma once
+
+#include "oclUtils.h"
+#include <iostream>
+#include <string>
+#include <map>
+#include "ProgramCache.h"
+
+using namespace std;
+
+/*!
+ * \class ProgramRegistry
+ * \brief Process-wide registry of programs. One program is built per context, source set and build options, filters share it and reference-count it.
+ */
+class ProgramRegistry
+{
+	private:
+
+		/*!
+		 * Shared program and number of filters using it.
+		 */
+		struct Entry
+		{
+			cl_program program;
+			int references;
+		};
+
+		/*!
+		 * Built programs, key is made from context, source files and options.
+		 */
+		static map<string, Entry> Programs;
+
+		/*!
+		 * Loaded .cl files, GPUCode.cl is loaded once for all programs.
+		 */
+		static map<string, string> Sources;
+
+		/*!
+		 * Load .cl file, or return already loaded one.
+		 */
+		static const string& LoadSource(const string& file);
+
+	public:
+
+		/*!
+		 * Path of .cl file with support functions, prepended to every program.
+		 */
+		static string SupportSource;
+
+		/*!
+		 * Return program built from support functions and given .cl file. Program is built only for the first caller,
+		 * next callers with the same context, file and options get the same program.
+		 */
+		static cl_program Acquire(cl_context GPUContext, const char* file, const char* options, cl_int* error);
+
+		/*!
+		 * Release program returned by Acquire, program is destroyed when last filter releases it.
+		 */
+		static void Release(cl_program program);
+};
@@ -0,0 +1,112 @@
+/*!
+ * \file RectMorphologyFilter.h
+ * \brief File contains class morphology with rectangular structuring element.
+ */
+
+#pragma once
+#include "MorphologyFilter.h"
+
+/*!
+ * Operation of RectMorphologyFilter.
+ */
+enum RectOperation
+{
+	RECT_ERODE,		/*!< Minimum over the element. */
+	RECT_DILATE,	/*!< Maximum over the element. */
+	RECT_OPEN,		/*!< Erosion and then dilation, removes bright details smaller than the element. */
+	RECT_CLOSE		/*!< Dilation and then erosion, fills dark details smaller than the element. */
+};
+
+/*!
+ * \class RectMorphologyFilter
+ * \brief Grayscale erosion, dilation, opening and closing with width x height rectangle, lines are 1 pixel wide rectangles.
+ * Rectangle is separable, each axis is one van Herk/Gil-Werman pass of about 3 comparisons per pixel whatever the length,
+ * so 25x1 and 1x25 openings cost as much as 3x1. Channels are processed independently, binary images of 0 and 255 give
+ * binary results. Unlike ErodeFilter and DilateFilter, pixels outside of the image don't change the result.
+ */
+class RectMorphologyFilter :
+	public MorphologyFilter
+{
+private:
+
+	/*!
+	* Operation.
+	*/
+	RectOperation operation;
+
+	/*!
+	* Width of the element, 1 for vertical line.
+	*/
+	int elementWidth;
+
+	/*!
+	* Height of the element, 1 for horizontal line.
+	*/
+	int elementHeight;
+
+	/*!
+	* Kernel of column pass, GPUFilter is the row pass.
+	*/
+	cl_kernel GPUColumnFilter;
+
+	/*!
+	* Number of passes of the operation and their axis (0 rows, 1 columns) and kind (0 minimum, 1 maximum).
+	* Axes of length 1 are skipped.
+	*/
+	int Passes(int* axis, int* isMax);
+
+	/*!
+	* Pixels of window before the output pixel along axis, element of dilation is reflected so opening
+	* and closing keep their meaning for even lengths.
+	*/
+	int Before(int axis, int isMax);
+
+	/*!
+	* Output of passes other than the last one, holds all images of the batch. It is a scratch buffer of the transfer
+	* manager, so strips and tiles on other queues have their own. NULL if it couldn't be created.
+	*/
+	cl_mem TempBuffer();
+
+	/*!
+	* Enqueue one pass over the image, work-group size is chosen by the driver.
+	*/
+	bool EnqueuePass(cl_command_queue GPUCommandQueue, int axis, int isMax, cl_mem source, cl_mem dest);
+
+public:
+
+	/*!
+	* Destructor.
+	*/
+	~RectMorphologyFilter(void);
+
+	/*!
+	* Constructor. Element has width x height pixels, origin is pixel (width / 2, height / 2).
+	* Creates a program object for a context, loads the source code (.cl files) and build the program.
+	*/
+	RectMorphologyFilter(cl_context GPUContext ,GPUTransferManager* transfer, RectOperation op, int width, int height);
+
+	/*!
+	* Start filtering, one pass per axis and operation. Launching GPU processing.
+	*/
+	bool filter(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Start filtering on the host.
+	*/
+	bool filterHost();
+
+	/*!
+	* Distance of furthest pixel read, summed over erosion and dilation of opening and closing.
+	*/
+	int Radius();
+
+	/*!
+	* Channels are filtered independently.
+	*/
+	bool PerChannel();
+
+	/*!
+	* Work-group size is chosen by the driver, nothing to tune.
+	*/
+	bool Autotune(cl_command_queue GPUCommandQueue, cl_device_id GPUDevice);
+};
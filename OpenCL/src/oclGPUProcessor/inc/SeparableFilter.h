@@ -0,0 +1,102 @@
+/*!
+ * \file SeparableFilter.h
+ * \brief File contains class separable convolution filter.
+ */
+
+#pragma once
+#include "LinearFilter.h"
+
+/*!
+ * \class SeparableFilter
+ * \brief Convolution with mask equal to outer product of column and row vectors of any odd length.
+ * Image is convolved with the row vector and then with the column vector, 31x31 Gaussian costs 62 taps per pixel instead of 961.
+ * Intermediate sums are kept in float, pixels outside of the image repeat the edge pixel.
+ */
+class SeparableFilter :
+	public LinearFilter
+{
+private:
+
+	/*!
+	* Row coefficients, normalised to sum 1 unless they sum to 0.
+	*/
+	float* rowCoeffs;
+
+	/*!
+	* Column coefficients, normalised like row coefficients.
+	*/
+	float* colCoeffs;
+
+	/*!
+	* Number of row taps on each side of output pixel, -1 if row vector is invalid.
+	*/
+	int rowRadius;
+
+	/*!
+	* Number of column taps on each side of output pixel, -1 if column vector is invalid.
+	*/
+	int colRadius;
+
+	/*!
+	* OpenCL device memory buffer for row coefficients.
+	*/
+	cl_mem cmDevBufRow;
+
+	/*!
+	* OpenCL device memory buffer for column coefficients.
+	*/
+	cl_mem cmDevBufCol;
+
+	/*!
+	* Kernel of column pass, GPUFilter is the row pass.
+	*/
+	cl_kernel GPUColumnFilter;
+
+	/*!
+	* Copy coefficients, normalise them and return radius, -1 if length isn't odd.
+	*/
+	int LoadCoeffs(const float* coeffs, int length, float** dest, cl_mem* buffer, GPUTransferManager* transfer);
+
+	/*!
+	* Float output of row pass and input of column pass, holds pixels of all images of the batch. It is a scratch buffer
+	* of the transfer manager, so strips and tiles on other queues have their own. NULL if it couldn't be created.
+	*/
+	cl_mem TempBuffer();
+
+public:
+
+	/*!
+	* Destructor.
+	*/
+	~SeparableFilter(void);
+
+	/*!
+	* Constructor. Send coefficients to GPU memory. Creates a program object for a context, loads the source code (.cl files) and build the program.
+	*/
+	SeparableFilter(cl_context GPUContext ,GPUTransferManager* transfer, const float* row, int rowLength, const float* col, int colLength);
+
+	/*!
+	* Start filtering, row pass and column pass. Launching GPU processing.
+	*/
+	bool filter(cl_command_queue GPUCommandQueue);
+
+	/*!
+	* Start filtering on the host.
+	*/
+	bool filterHost();
+
+	/*!
+	* Larger of row and column radius.
+	*/
+	int Radius();
+
+	/*!
+	* Channels are filtered independently.
+	*/
+	bool PerChannel();
+
+	/*!
+	* Fill 2 * radius + 1 samples of Gaussian with given sigma, sum of samples is 1.
+	*/
+	static void Gaussian(float sigma, int radius, float* coeffs);
+};
@@ -0,0 +1,149 @@
+/*!
+ * \file TileScheduler.h
+ * \brief File contains work-stealing thread pool running host filters on tiles of the image.
+ */
+
+#pragma once
+
+#include "HostFilters.h"
+#include "HostSync.h"
+#include "multithreading.h"
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+/*!
+ * Size in bytes of tile, input and output of one tile with apron stay in L2 cache.
+ */
+#define HOST_TILE_BYTES (64 * 1024)
+
+/*!
+ * \class TileScheduler
+ * \brief Pool of worker threads. Image is cut into cache-sized tiles, each worker gets its own queue of neighbouring tiles
+ * and takes them from the back. Worker with empty queue steals tiles from the front of queues of other workers.
+ */
+class TileScheduler
+{
+	private:
+
+		/*!
+		 * Part of the job processed at once.
+		 */
+		struct Tile
+		{
+			HostJob* job;
+			int x0;
+			int y0;
+			int x1;
+			int y1;
+		};
+
+		/*!
+		 * Worker thread and its queue of tiles.
+		 */
+		struct Worker
+		{
+			TileScheduler* owner;
+			int index;
+			deque<Tile> tiles;
+			HostMutex lock;
+		};
+
+		/*!
+		 * Workers, one per thread.
+		 */
+		vector<Worker*> workers;
+
+		/*!
+		 * Handles of worker threads.
+		 */
+		vector<CUTThread> threads;
+
+		/*!
+		 * Only one job is scheduled at once.
+		 */
+		HostMutex runLock;
+
+		/*!
+		 * Protects generation, pending and quit.
+		 */
+		HostMutex stateLock;
+
+		/*!
+		 * Signaled when new job is scheduled or pool is stopped.
+		 */
+		HostCond wake;
+
+		/*!
+		 * Signaled when last tile of the job is done.
+		 */
+		HostCond done;
+
+		/*!
+		 * Number of scheduled jobs, workers wake up when it changes.
+		 */
+		unsigned int generation;
+
+		/*!
+		 * Number of tiles of current job not finished yet.
+		 */
+		int pending;
+
+		/*!
+		 * Workers exit when set.
+		 */
+		bool quit;
+
+		/*!
+		 * Take tile from the back of own queue.
+		 */
+		bool Pop(int index, Tile* tile);
+
+		/*!
+		 * Take tile from the front of queue of other worker.
+		 */
+		bool Steal(int index, Tile* tile);
+
+		/*!
+		 * Loop of worker thread.
+		 */
+		void WorkerLoop(Worker* worker);
+
+		/*!
+		 * Entry point of worker thread, data is the Worker.
+		 */
+		static HOST_THREADPROC WorkerThread(void* data);
+
+	public:
+
+		/*!
+		 * Constructor, start given number of worker threads.
+		 */
+		TileScheduler(int threadCount);
+
+		/*!
+		 * Destructor, stop worker threads.
+		 */
+		~TileScheduler();
+
+		/*!
+		 * Pool shared by all host filters, HostThreadCount() workers.
+		 */
+		static TileScheduler* Instance();
+
+		/*!
+		 * Number of worker threads.
+		 */
+		int ThreadCount();
+
+		/*!
+		 * Tile size for the job, about HOST_TILE_BYTES of image.
+		 */
+		static void TileSize(const HostJob* job, int* tileWidth, int* tileHeight);
+
+		/*!
+		 * Cut job into tiles, run them on worker threads and wait until all are done.
+		 */
+		void Run(HostJob* job);
+};
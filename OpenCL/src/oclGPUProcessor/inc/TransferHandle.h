@@ -0,0 +1,97 @@
+/*!
+ * \file TransferHandle.h
+ * \brief File contains handle of non-blocking transfer.
+ */
+
+#pragma once
+
+#include "oclUtils.h"
+#include "cv.h"
+
+/*!
+ * Function called when transfer is finished. Image is NULL if transfer failed.
+ */
+typedef void (*TransferCallback)(IplImage* image, void* userData);
+
+class GPUTransferManager;
+
+/*!
+ * \class TransferHandle
+ * \brief Handle of non-blocking upload or download, backed by event of the transfer.
+ */
+class TransferHandle
+{
+	private:
+
+		/*!
+		 * Event of the transfer, NULL if transfer was done synchronously (host mode).
+		 */
+		cl_event event;
+
+		/*!
+		 * Image delivered when transfer is finished, NULL for uploads.
+		 */
+		IplImage* image;
+
+		/*!
+		 * Transfer manager owning staging buffer of the image, NULL if image isn't in a staging buffer.
+		 */
+		GPUTransferManager* owner;
+
+		/*!
+		 * Staging buffer of the image, -1 if none.
+		 */
+		int slot;
+
+		/*!
+		 * Handle still holds the staging buffer.
+		 */
+		bool held;
+
+		/*!
+		 * Image is a copy owned by the handle.
+		 */
+		bool owned;
+
+	public:
+
+		/*!
+		 * Constructor, handle takes ownership of the event and of one hold of staging buffer slot of owner,
+		 * or of the image itself if ownsImage is set. Owner must outlive the handle.
+		 */
+		TransferHandle(cl_event event, IplImage* image, GPUTransferManager* owner = NULL, int slot = -1, bool ownsImage = false);
+
+		/*!
+		 * Destructor, release the event and the image. Transfer and registered callbacks are not cancelled.
+		 */
+		~TransferHandle();
+
+		/*!
+		 * Consumer is done with the image, its staging buffer can be reused by next transfers.
+		 * Image must not be used after the call. Called by destructor if not called before.
+		 */
+		void Release();
+
+		/*!
+		 * Check without blocking if transfer is finished.
+		 */
+		bool IsComplete();
+
+		/*!
+		 * Block until transfer is finished. Return image of download, NULL for uploads or if transfer failed.
+		 */
+		IplImage* Wait();
+
+		/*!
+		 * Event of the transfer, can be used in wait lists of other commands.
+		 */
+		cl_event GetEvent();
+
+		/*!
+		 * Call callback when transfer is finished. With OpenCL 1.1 callback is registered by clSetEventCallback,
+		 * with OpenCL 1.0 it is called by a dispatcher thread. In both cases it runs on a thread of its own,
+		 * not the one which started the transfer, also if transfer was done synchronously. Handle can be deleted
+		 * or released before callback is called, image passed to callback stays valid until callback returns.
+		 */
+		void OnComplete(TransferCallback callback, void* userData);
+};
@@ -0,0 +1,70 @@
+/*!
+ * \file WorkGroupTuner.h
+ * \brief File contains class responsible for storing tuned work-group sizes.
+ */
+
+#pragma once
+
+#include "oclUtils.h"
+#include <iostream>
+#include <string>
+#include <map>
+#include <stdio.h>
+
+using namespace std;
+
+/*!
+ * \class WorkGroupTuner
+ * \brief Tuning file with best work-group size for each kernel and device. Each line contains device name, driver version, kernel name and size, separated by tabs.
+ */
+class WorkGroupTuner
+{
+	private:
+
+		/*!
+		 * Path of tuning file.
+		 */
+		static string TuningFile;
+
+		/*!
+		 * Entries of tuning file, value is work-group size X and Y.
+		 */
+		static map<string, pair<int,int> > Entries;
+
+		/*!
+		 * Tuning file was read.
+		 */
+		static bool Loaded;
+
+		/*!
+		 * Read tuning file.
+		 */
+		static void Load();
+
+		/*!
+		 * Write all entries to tuning file.
+		 */
+		static void Save();
+
+		/*!
+		 * Key of entry: device name, driver version and kernel name.
+		 */
+		static string GetKey(cl_device_id device, const string& kernel);
+
+	public:
+
+		/*!
+		 * Set path of tuning file. Default is ./tuning.txt or GPUPROCESSOR_TUNING environment variable.
+		 */
+		static void SetFile(const char* file);
+
+		/*!
+		 * Get stored work-group size of kernel on given device, return false if kernel wasn't tuned.
+		 */
+		static bool Lookup(cl_device_id device, const string& kernel, int* iBlockDimX, int* iBlockDimY);
+
+		/*!
+		 * Store work-group size of kernel on given device and rewrite tuning file.
+		 */
+		static void Store(cl_device_id device, const string& kernel, int iBlockDimX, int iBlockDimY);
+};
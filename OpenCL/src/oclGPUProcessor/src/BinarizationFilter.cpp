@@ -6,20 +6,35 @@
  */
 
 #include "BinarizationFilter.h"
+#include "HostFilters.h"
 
 
-BinarizationFilter::BinarizationFilter(void)
+BinarizationFilter::~BinarizationFilter(void)
 {
 }
 
-
-BinarizationFilter::~BinarizationFilter(void)
+BinarizationFilter::BinarizationFilter(cl_context GPUContext ,GPUTransferManager* transfer, int bin): ContextFreeFilter("./OpenCL/Binarization.cl",GPUContext,transfer,"ckBin")
 {
+	threshold = bin;
 }
 
-
-
 bool BinarizationFilter::filter(cl_command_queue GPUCommandQueue)
 {
-	return false;
+	cl_uint uiThreshold = threshold;
+    GPUError = clSetKernelArg(GPUFilter, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
+    GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+	GPUError |= clSetKernelArg(GPUFilter, 2, sizeof(cl_uint), (void*)&uiThreshold);
+    GPUError |= clSetKernelArg(GPUFilter, 3, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+    GPUError |= clSetKernelArg(GPUFilter, 4, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_uint), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUFilter, 6, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+    if(GPUError) return false;
+
+    return EnqueueKernel(GPUCommandQueue);
+}
+
+bool BinarizationFilter::filterHost()
+{
+	HostBinarization(GPUTransfer->HostBuf, GPUTransfer->HostBufOut, GPUTransfer->ImageWidth, GPUTransfer->ImageHeight, GPUTransfer->nChannels, threshold);
+	return true;
 }
@@ -18,6 +18,7 @@ CloseFilter::~CloseFilter(void)
 
 CloseFilter::CloseFilter(cl_context GPUContext ,GPUTransferManager* transfer)
 {
+	GPUTransfer = transfer;
 	erode = new ErodeFilter(GPUContext,transfer);
 	dilate = new DilateFilter(GPUContext,transfer);
 }
@@ -25,7 +26,50 @@ CloseFilter::CloseFilter(cl_context GPUContext ,GPUTransferManager* transfer)
 
 bool CloseFilter::filter(cl_command_queue GPUCommandQueue)
 {
-	if(dilate->filter(GPUCommandQueue)) return false;
-	if(erode->filter(GPUCommandQueue)) return false;
+	if(!dilate->filter(GPUCommandQueue)) return false;
+	GPUTransfer->SwapBuffers();
+	if(!erode->filter(GPUCommandQueue)) return false;
+	return true;
+}
+
+int CloseFilter::Radius()
+{
+	return erode->Radius() + dilate->Radius();
+}
+
+void CloseFilter::SetTransfer(GPUTransferManager* transfer)
+{
+	GPUTransfer = transfer;
+	erode->SetTransfer(transfer);
+	dilate->SetTransfer(transfer);
+}
+
+bool CloseFilter::Autotune(cl_command_queue GPUCommandQueue, cl_device_id GPUDevice)
+{
+	bool ok = dilate->Autotune(GPUCommandQueue, GPUDevice);
+	return erode->Autotune(GPUCommandQueue, GPUDevice) && ok;
+}
+
+bool CloseFilter::SetFetch(FetchMode mode)
+{
+	bool ok = dilate->SetFetch(mode);
+	ok = erode->SetFetch(mode) && ok;
+	if( ok ) Fetch = mode;
+	return ok;
+}
+
+bool CloseFilter::SetRadius(int radius)
+{
+	bool ok = dilate->SetRadius(radius);
+	ok = erode->SetRadius(radius) && ok;
+	if( ok ) iRadius = radius;
+	return ok;
+}
+
+bool CloseFilter::filterHost()
+{
+	if(!dilate->filterHost()) return false;
+	GPUTransfer->SwapBuffers();
+	if(!erode->filterHost()) return false;
 	return true;
 }
@@ -10,14 +10,184 @@
 
 ContextFilter::~ContextFilter(void)
 {
+	if(GPUImageFilter)clReleaseKernel(GPUImageFilter);
+	if(GPUBufferToImage)clReleaseKernel(GPUBufferToImage);
+	if(GPUImageProgram)ProgramRegistry::Release(GPUImageProgram);
+	if(GPUStencilFilter)clReleaseKernel(GPUStencilFilter);
+	if(GPUStencilProgram)ProgramRegistry::Release(GPUStencilProgram);
 }
 
 ContextFilter::ContextFilter(char* source, cl_context GPUContext ,GPUTransferManager* transfer,char* KernelName): Filter(source,GPUContext,transfer,KernelName)
 {
-
+	ImageKernelName = NULL;
+	GPUImageProgram = NULL;
+	GPUImageFilter = NULL;
+	GPUBufferToImage = NULL;
+	Fetch = FETCH_LOCAL;
+	StencilKernelName = NULL;
+	GPUStencilProgram = NULL;
+	GPUStencilFilter = NULL;
+	iRadius = 1;
 }
 
 ContextFilter::ContextFilter()
 {
+	ImageKernelName = NULL;
+	GPUImageProgram = NULL;
+	GPUImageFilter = NULL;
+	GPUBufferToImage = NULL;
+	Fetch = FETCH_LOCAL;
+	StencilKernelName = NULL;
+	GPUStencilProgram = NULL;
+	GPUStencilFilter = NULL;
+	iRadius = 1;
+}
+
+bool ContextFilter::SetFetch(FetchMode mode)
+{
+	if( mode == FETCH_LOCAL )
+	{
+		Fetch = FETCH_LOCAL;
+		return true;
+	}
+
+	if( ImageKernelName == NULL || GPUTransfer == NULL || GPUTransfer->HostMode ) return false;
+
+	if( GPUImageFilter == NULL )
+	{
+		cl_bool bImageSupport = CL_FALSE;
+		clGetDeviceInfo(GPUTransfer->GPUDevice, CL_DEVICE_IMAGE_SUPPORT, sizeof(cl_bool), &bImageSupport, NULL);
+		if( !bImageSupport ) return false;
+
+		char *flags = "-cl-mad-enable";
+		GPUImageProgram = ProgramRegistry::Acquire( GPUTransfer->GPUContext, "./OpenCL/ImageFilters.cl", flags, &GPUError);
+		CheckErrorBuildProgram(GPUError);
+		if( GPUImageProgram == NULL ) return false;
+
+		GPUBufferToImage = clCreateKernel(GPUImageProgram, "ckBufferToImage", &GPUError);
+		CheckError(GPUError);
+		GPUImageFilter = clCreateKernel(GPUImageProgram, ImageKernelName, &GPUError);
+		CheckError(GPUError);
+		if( GPUImageFilter == NULL || GPUBufferToImage == NULL ) return false;
+	}
+
+	Fetch = FETCH_IMAGE;
+	return true;
+}
+
+bool ContextFilter::UseImage()
+{
+	return Fetch == FETCH_IMAGE && GPUImageFilter != NULL && GPUTransfer->BatchSize == 1;
+}
+
+bool ContextFilter::SetImageArgs(cl_uint)
+{
+	return true;
+}
+
+bool ContextFilter::filterImage(cl_command_queue GPUCommandQueue)
+{
+	cl_mem cmImage = GPUTransfer->InputImage();
+	if( cmImage == NULL ) return false;
+
+	// Image kernels have no local memory, work-group size only shapes the NDRange
+	size_t GPULocalWorkSize[2];
+	GPULocalWorkSize[0] = iBlockDimX;
+	GPULocalWorkSize[1] = iBlockDimY;
+	GPUGlobalWorkSize[0] = shrRoundUp((int)GPULocalWorkSize[0], GPUTransfer->ImageWidth);
+	GPUGlobalWorkSize[1] = shrRoundUp((int)GPULocalWorkSize[1], (int)GPUTransfer->ImageHeight);
+	GPUGlobalWorkSize[2] = 1;
+
+	GPUError = clSetKernelArg(GPUBufferToImage, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
+	GPUError |= clSetKernelArg(GPUBufferToImage, 1, sizeof(cl_mem), (void*)&cmImage);
+	GPUError |= clSetKernelArg(GPUBufferToImage, 2, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+	GPUError |= clSetKernelArg(GPUBufferToImage, 3, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUBufferToImage, 4, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUBufferToImage, 5, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+
+	GPUError |= clSetKernelArg(GPUImageFilter, 0, sizeof(cl_mem), (void*)&cmImage);
+	GPUError |= clSetKernelArg(GPUImageFilter, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+	GPUError |= clSetKernelArg(GPUImageFilter, 2, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+	GPUError |= clSetKernelArg(GPUImageFilter, 3, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUImageFilter, 4, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUImageFilter, 5, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+	if( GPUError || !SetImageArgs(6) ) return false;
+
+	cl_event event;
+	GPUProfiler* profiler = GPUTransfer->Profiler;
+	if( clEnqueueNDRangeKernel( GPUCommandQueue, GPUBufferToImage, 2, NULL, GPUGlobalWorkSize, GPULocalWorkSize, 0, NULL, profiler ? &event : NULL) ) return false;
+	if( profiler ) profiler->Record("ckBufferToImage", event);
+	if( clEnqueueNDRangeKernel( GPUCommandQueue, GPUImageFilter, 2, NULL, GPUGlobalWorkSize, GPULocalWorkSize, 0, NULL, profiler ? &event : NULL) ) return false;
+	if( profiler ) profiler->Record(ImageKernelName, event);
+	return true;
+}
+
+bool ContextFilter::SetRadius(int radius)
+{
+	if( radius < 1 ) return false;
+	if( radius == 1 )
+	{
+		iRadius = 1;
+		return true;
+	}
+
+	if( StencilKernelName == NULL || GPUTransfer == NULL ) return false;
+
+	// Host filters take radius directly
+	if( !GPUTransfer->HostMode && GPUStencilFilter == NULL )
+	{
+		char *flags = "-cl-mad-enable";
+		GPUStencilProgram = ProgramRegistry::Acquire( GPUTransfer->GPUContext, "./OpenCL/StencilFilters.cl", flags, &GPUError);
+		CheckErrorBuildProgram(GPUError);
+		if( GPUStencilProgram == NULL ) return false;
+
+		GPUStencilFilter = clCreateKernel(GPUStencilProgram, StencilKernelName, &GPUError);
+		CheckError(GPUError);
+		if( GPUStencilFilter == NULL ) return false;
+	}
+
+	iRadius = radius;
+	return true;
+}
+
+int ContextFilter::Radius()
+{
+	return iRadius;
+}
 
-}
\ No newline at end of file
+bool ContextFilter::UseStencil()
+{
+	return iRadius > 1 && GPUStencilFilter != NULL;
+}
+
+bool ContextFilter::SetStencilArgs(cl_uint)
+{
+	return true;
+}
+
+bool ContextFilter::filterStencil(cl_command_queue GPUCommandQueue)
+{
+	size_t szTileBytes = (iBlockDimX + 2 * iRadius) * (iBlockDimY + 2 * iRadius) * GPUTransfer->nChannels * sizeof(cl_uchar);
+	if( (cl_ulong)szTileBytes > LocalMemSize() ) return false;
+
+	GPUError = clSetKernelArg(GPUStencilFilter, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
+	GPUError |= clSetKernelArg(GPUStencilFilter, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+	GPUError |= clSetKernelArg(GPUStencilFilter, 2, szTileBytes, NULL);
+	GPUError |= clSetKernelArg(GPUStencilFilter, 3, sizeof(cl_int), (void*)&iRadius);
+	GPUError |= clSetKernelArg(GPUStencilFilter, 4, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+	GPUError |= clSetKernelArg(GPUStencilFilter, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUStencilFilter, 6, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUStencilFilter, 7, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+	if( GPUError || !SetStencilArgs(8) ) return false;
+
+	return EnqueueKernel(GPUCommandQueue, GPUStencilFilter, StencilKernelName);
+}
+
+bool ContextFilter::Autotune(cl_command_queue GPUCommandQueue, cl_device_id GPUDevice)
+{
+	int radius = iRadius;
+	iRadius = 1;
+	bool ok = Filter::Autotune(GPUCommandQueue, GPUDevice);
+	iRadius = radius;
+	return ok;
+}
@@ -16,3 +16,8 @@ ContextFreeFilter::ContextFreeFilter(char* source, cl_context GPUContext ,GPUTra
 {
 
 }
+
+int ContextFreeFilter::Radius()
+{
+	return 0;
+}
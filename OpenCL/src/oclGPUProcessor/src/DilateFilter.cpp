@@ -6,6 +6,7 @@
  */
 
 #include "DilateFilter.h"
+#include "HostFilters.h"
 
 
 DilateFilter::DilateFilter(void)
@@ -21,29 +22,30 @@ DilateFilter::~DilateFilter(void)
 
 DilateFilter::DilateFilter(cl_context GPUContext ,GPUTransferManager* transfer): MorphologyFilter("./OpenCL/DilateFilter.cl",GPUContext,transfer,"ckDilate")
 {
-
+	ImageKernelName = "ckDilateImage";
+	StencilKernelName = "ckDilateR";
 }
 
 bool DilateFilter::filter(cl_command_queue GPUCommandQueue)
 {
+    if( UseStencil() ) return filterStencil(GPUCommandQueue);
+    if( UseImage() ) return filterImage(GPUCommandQueue);
     int iLocalPixPitch = iBlockDimX + 2;
     GPUError = clSetKernelArg(GPUFilter, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
-    GPUError |= clSetKernelArg(GPUFilter, 1, (iLocalPixPitch * (iBlockDimY + 2) *  GPUTransfer->nChannels * sizeof(cl_uchar)), NULL);
-    GPUError |= clSetKernelArg(GPUFilter, 2, sizeof(cl_int), (void*)&iLocalPixPitch);
-    GPUError |= clSetKernelArg(GPUFilter, 3, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
-    GPUError |= clSetKernelArg(GPUFilter, 4, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
-	GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+    GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+    GPUError |= clSetKernelArg(GPUFilter, 2, (iLocalPixPitch * (iBlockDimY + 2) *  GPUTransfer->nChannels * sizeof(cl_uchar)), NULL);
+    GPUError |= clSetKernelArg(GPUFilter, 3, sizeof(cl_int), (void*)&iLocalPixPitch);
+    GPUError |= clSetKernelArg(GPUFilter, 4, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+    GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUFilter, 6, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUFilter, 7, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
     if(GPUError) return false;
 
-	size_t GPULocalWorkSize[2]; 
-    GPULocalWorkSize[0] = iBlockDimX;
-    GPULocalWorkSize[1] = iBlockDimY;
-    GPUGlobalWorkSize[0] = shrRoundUp((int)GPULocalWorkSize[0], GPUTransfer->ImageWidth); 
-
-    GPUGlobalWorkSize[1] = shrRoundUp((int)GPULocalWorkSize[1], (int)GPUTransfer->ImageHeight);
+    return EnqueueKernel(GPUCommandQueue);
+}
 
-    if(clEnqueueNDRangeKernel( GPUCommandQueue, GPUFilter, 2, NULL, GPUGlobalWorkSize, GPULocalWorkSize, 0, NULL, NULL)) return false;
-    
+bool DilateFilter::filterHost()
+{
+	HostDilate(GPUTransfer->HostBuf, GPUTransfer->HostBufOut, GPUTransfer->ImageWidth, GPUTransfer->ImageHeight, GPUTransfer->nChannels, iRadius);
 	return true;
 }
-
@@ -0,0 +1,300 @@
+/*!
+ * \file FFTConvolutionFilter.cpp
+ * \brief Convolution filter with large float mask.
+ */
+
+#include "FFTConvolutionFilter.h"
+#include "HostFilters.h"
+#include <math.h>
+
+FFTConvolutionFilter::~FFTConvolutionFilter(void)
+{
+	if(ckLoad)clReleaseKernel(ckLoad);
+	if(ckLoadMask)clReleaseKernel(ckLoadMask);
+	if(ckRadix2)clReleaseKernel(ckRadix2);
+	if(ckMul)clReleaseKernel(ckMul);
+	if(ckStore)clReleaseKernel(ckStore);
+	if(cmDevBufMask)clReleaseMemObject(cmDevBufMask);
+	delete [] mask;
+}
+
+
+FFTConvolutionFilter::FFTConvolutionFilter(cl_context GPUContext ,GPUTransferManager* transfer, const float* coeffs, int width, int height): LinearFilter("./OpenCL/FFTConvolution.cl",GPUContext,transfer,"ckConvFloat")
+{
+	Method = CONV_AUTO;
+	mask = NULL;
+	iMaskRadiusX = -1;
+	iMaskRadiusY = -1;
+	cmDevBufMask = NULL;
+	ckLoad = NULL;
+	ckLoadMask = NULL;
+	ckRadix2 = NULL;
+	ckMul = NULL;
+	ckStore = NULL;
+
+	if( coeffs == NULL || width < 1 || height < 1 || width % 2 == 0 || height % 2 == 0 )
+	{
+		cout << "Convolution mask needs odd width and height" << endl;
+		return;
+	}
+	iMaskRadiusX = width / 2;
+	iMaskRadiusY = height / 2;
+
+	// Normalised like ckConv divides by sum of the mask, masks summing to 0 are kept
+	int count = width * height;
+	float sum = 0.0f;
+	for( int i = 0 ; i < count ; ++i ) sum += coeffs[i];
+	if( fabs(sum) < 1e-6f ) sum = 1.0f;
+	mask = new float[count];
+	for( int i = 0 ; i < count ; ++i ) mask[i] = coeffs[i] / sum;
+
+	// Host mode, filterHost() reads the mask directly
+	if( GPUContext == NULL || GPUProgram == NULL ) return;
+
+	cmDevBufMask = clCreateBuffer(GPUContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, count * sizeof(cl_float), (void*)mask, &GPUError);
+	CheckError(GPUError);
+
+	ckLoad = clCreateKernel(GPUProgram, "ckFFTLoad", &GPUError);
+	CheckError(GPUError);
+	ckLoadMask = clCreateKernel(GPUProgram, "ckFFTLoadMask", &GPUError);
+	CheckError(GPUError);
+	ckRadix2 = clCreateKernel(GPUProgram, "ckFFTRadix2", &GPUError);
+	CheckError(GPUError);
+	ckMul = clCreateKernel(GPUProgram, "ckSpectrumMul", &GPUError);
+	CheckError(GPUError);
+	ckStore = clCreateKernel(GPUProgram, "ckFFTStore", &GPUError);
+	CheckError(GPUError);
+}
+
+void FFTConvolutionFilter::PaddedSize(int* width, int* height)
+{
+	// Padding must hold the apron of one side and the mirrored mask must not overlap itself
+	int minWidth = max((int)GPUTransfer->ImageWidth + iMaskRadiusX, 2 * iMaskRadiusX + 1);
+	int minHeight = max((int)GPUTransfer->ImageHeight + iMaskRadiusY, 2 * iMaskRadiusY + 1);
+	for( *width = 1 ; *width < minWidth ; *width <<= 1 );
+	for( *height = 1 ; *height < minHeight ; *height <<= 1 );
+}
+
+size_t FFTConvolutionFilter::DirectTileBytes()
+{
+	int radius = Radius();
+	return (iBlockDimX + 2 * radius) * (iBlockDimY + 2 * radius) * GPUTransfer->nChannels * sizeof(cl_uchar);
+}
+
+ConvolutionMethod FFTConvolutionFilter::SelectedMethod()
+{
+	if( Method != CONV_AUTO ) return Method;
+	if( (cl_ulong)DirectTileBytes() > LocalMemSize() ) return CONV_FFT;
+
+	// Direct costs one tap per coefficient, FFT a few passes per log2 step of padded size whatever the mask is
+	int width, height;
+	PaddedSize(&width, &height);
+	int steps = 0;
+	for( int size = width * height ; size > 1 ; size >>= 1 ) steps++;
+	int taps = (2 * iMaskRadiusX + 1) * (2 * iMaskRadiusY + 1);
+	return taps > FFT_TAPS_PER_STEP * steps ? CONV_FFT : CONV_DIRECT;
+}
+
+bool FFTConvolutionFilter::EnqueueFFT(cl_command_queue GPUCommandQueue, cl_kernel kernel, const char* name, size_t width, size_t height)
+{
+	size_t GPUWorkSize[2];
+	GPUWorkSize[0] = width;
+	GPUWorkSize[1] = height;
+
+	cl_event event;
+	GPUProfiler* profiler = GPUTransfer->Profiler;
+	if( clEnqueueNDRangeKernel( GPUCommandQueue, kernel, 2, NULL, GPUWorkSize, NULL, 0, NULL, profiler ? &event : NULL) ) return false;
+	if( profiler ) profiler->Record(name, event);
+	return true;
+}
+
+int FFTConvolutionFilter::Transform(cl_command_queue GPUCommandQueue, cl_mem* buffers, int buffer, float fSign, int width, int height)
+{
+	int iStride = 1;
+	int iBatchStride = width;
+
+	// Rows
+	int iHalf = width / 2;
+	for( int p = 1 ; p < width ; p <<= 1 )
+	{
+		GPUError = clSetKernelArg(ckRadix2, 0, sizeof(cl_mem), (void*)&buffers[buffer]);
+		GPUError |= clSetKernelArg(ckRadix2, 1, sizeof(cl_mem), (void*)&buffers[1 - buffer]);
+		GPUError |= clSetKernelArg(ckRadix2, 2, sizeof(cl_int), (void*)&p);
+		GPUError |= clSetKernelArg(ckRadix2, 3, sizeof(cl_int), (void*)&iHalf);
+		GPUError |= clSetKernelArg(ckRadix2, 4, sizeof(cl_int), (void*)&iStride);
+		GPUError |= clSetKernelArg(ckRadix2, 5, sizeof(cl_int), (void*)&iBatchStride);
+		GPUError |= clSetKernelArg(ckRadix2, 6, sizeof(cl_float), (void*)&fSign);
+		if( GPUError || !EnqueueFFT(GPUCommandQueue, ckRadix2, "ckFFTRadix2", iHalf, height) ) return -1;
+		buffer = 1 - buffer;
+	}
+
+	// Columns
+	iStride = width;
+	iBatchStride = 1;
+	iHalf = height / 2;
+	for( int p = 1 ; p < height ; p <<= 1 )
+	{
+		GPUError = clSetKernelArg(ckRadix2, 0, sizeof(cl_mem), (void*)&buffers[buffer]);
+		GPUError |= clSetKernelArg(ckRadix2, 1, sizeof(cl_mem), (void*)&buffers[1 - buffer]);
+		GPUError |= clSetKernelArg(ckRadix2, 2, sizeof(cl_int), (void*)&p);
+		GPUError |= clSetKernelArg(ckRadix2, 3, sizeof(cl_int), (void*)&iHalf);
+		GPUError |= clSetKernelArg(ckRadix2, 4, sizeof(cl_int), (void*)&iStride);
+		GPUError |= clSetKernelArg(ckRadix2, 5, sizeof(cl_int), (void*)&iBatchStride);
+		GPUError |= clSetKernelArg(ckRadix2, 6, sizeof(cl_float), (void*)&fSign);
+		if( GPUError || !EnqueueFFT(GPUCommandQueue, ckRadix2, "ckFFTRadix2", iHalf, width) ) return -1;
+		buffer = 1 - buffer;
+	}
+	return buffer;
+}
+
+bool FFTConvolutionFilter::PrepareSpectrum(cl_command_queue GPUCommandQueue, int width, int height, cl_mem* buffers)
+{
+	// Spectrum is in the first buffer, stamp is the padded size it was computed for and is cleared when the buffer grows
+	size_t szBytes = (size_t)width * height * sizeof(cl_float2);
+	ScratchBuffer* scratch[3];
+	for( int i = 0 ; i < 3 ; ++i )
+	{
+		scratch[i] = GPUTransfer->Scratch(iScratchOwner, i, szBytes);
+		if( scratch[i] == NULL ) return false;
+		buffers[i] = scratch[i]->Buffer;
+	}
+	cl_ulong ulStamp = ((cl_ulong)width << 32) | (cl_ulong)height;
+	if( scratch[0]->Stamp == ulStamp ) return true;
+
+	// Every pass swaps spectrum and first ping-pong buffer, mask is loaded to the one from which the last pass ends in the spectrum
+	int steps = 0;
+	for( int size = width * height ; size > 1 ; size >>= 1 ) steps++;
+	int buffer = steps % 2;
+
+	GPUError = clSetKernelArg(ckLoadMask, 0, sizeof(cl_mem), (void*)&cmDevBufMask);
+	GPUError |= clSetKernelArg(ckLoadMask, 1, sizeof(cl_mem), (void*)&buffers[buffer]);
+	GPUError |= clSetKernelArg(ckLoadMask, 2, sizeof(cl_int), (void*)&iMaskRadiusX);
+	GPUError |= clSetKernelArg(ckLoadMask, 3, sizeof(cl_int), (void*)&iMaskRadiusY);
+	GPUError |= clSetKernelArg(ckLoadMask, 4, sizeof(cl_int), (void*)&width);
+	GPUError |= clSetKernelArg(ckLoadMask, 5, sizeof(cl_int), (void*)&height);
+	if( GPUError || !EnqueueFFT(GPUCommandQueue, ckLoadMask, "ckFFTLoadMask", width, height) ) return false;
+	if( Transform(GPUCommandQueue, buffers, buffer, -1.0f, width, height) != 0 ) return false;
+
+	scratch[0]->Stamp = ulStamp;
+	return true;
+}
+
+bool FFTConvolutionFilter::filterFFT(cl_command_queue GPUCommandQueue)
+{
+	int iPadWidth, iPadHeight;
+	PaddedSize(&iPadWidth, &iPadHeight);
+	cl_mem buffers[3];
+	if( !PrepareSpectrum(GPUCommandQueue, iPadWidth, iPadHeight, buffers) ) return false;
+	cl_mem cmDevBufSpectrum = buffers[0];
+	cl_mem* cmDevBufComplex = buffers + 1;
+
+	// Channel of each image of the batch is one slot, slots are transformed in pairs
+	int nc = min(GPUTransfer->nChannels, 3);
+	int slots = GPUTransfer->BatchSize * nc;
+	cl_ulong ulImageBytes = (cl_ulong)GPUTransfer->ImagePitch * GPUTransfer->ImageHeight;
+	cl_float fScale = 1.0f / ((float)iPadWidth * (float)iPadHeight);
+	cl_float fInverse = 1.0f;
+
+	for( int s = 0 ; s < slots ; s += 2 )
+	{
+		cl_ulong ulOffsetA = (s / nc) * ulImageBytes;
+		int iChannelA = s % nc;
+		cl_ulong ulOffsetB = 0;
+		int iChannelB = -1;
+		if( s + 1 < slots )
+		{
+			ulOffsetB = ((s + 1) / nc) * ulImageBytes;
+			iChannelB = (s + 1) % nc;
+		}
+
+		GPUError = clSetKernelArg(ckLoad, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
+		GPUError |= clSetKernelArg(ckLoad, 1, sizeof(cl_mem), (void*)&cmDevBufComplex[0]);
+		GPUError |= clSetKernelArg(ckLoad, 2, sizeof(cl_ulong), (void*)&ulOffsetA);
+		GPUError |= clSetKernelArg(ckLoad, 3, sizeof(cl_int), (void*)&iChannelA);
+		GPUError |= clSetKernelArg(ckLoad, 4, sizeof(cl_ulong), (void*)&ulOffsetB);
+		GPUError |= clSetKernelArg(ckLoad, 5, sizeof(cl_int), (void*)&iChannelB);
+		GPUError |= clSetKernelArg(ckLoad, 6, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+		GPUError |= clSetKernelArg(ckLoad, 7, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+		GPUError |= clSetKernelArg(ckLoad, 8, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+		GPUError |= clSetKernelArg(ckLoad, 9, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+		GPUError |= clSetKernelArg(ckLoad, 10, sizeof(cl_int), (void*)&iPadWidth);
+		if( GPUError || !EnqueueFFT(GPUCommandQueue, ckLoad, "ckFFTLoad", iPadWidth, iPadHeight) ) return false;
+
+		int buffer = Transform(GPUCommandQueue, cmDevBufComplex, 0, -1.0f, iPadWidth, iPadHeight);
+		if( buffer < 0 ) return false;
+
+		GPUError = clSetKernelArg(ckMul, 0, sizeof(cl_mem), (void*)&cmDevBufComplex[buffer]);
+		GPUError |= clSetKernelArg(ckMul, 1, sizeof(cl_mem), (void*)&cmDevBufSpectrum);
+		GPUError |= clSetKernelArg(ckMul, 2, sizeof(cl_float), (void*)&fScale);
+		if( GPUError || !EnqueueFFT(GPUCommandQueue, ckMul, "ckSpectrumMul", iPadWidth * iPadHeight, 1) ) return false;
+
+		buffer = Transform(GPUCommandQueue, cmDevBufComplex, buffer, fInverse, iPadWidth, iPadHeight);
+		if( buffer < 0 ) return false;
+
+		GPUError = clSetKernelArg(ckStore, 0, sizeof(cl_mem), (void*)&cmDevBufComplex[buffer]);
+		GPUError |= clSetKernelArg(ckStore, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+		GPUError |= clSetKernelArg(ckStore, 2, sizeof(cl_ulong), (void*)&ulOffsetA);
+		GPUError |= clSetKernelArg(ckStore, 3, sizeof(cl_int), (void*)&iChannelA);
+		GPUError |= clSetKernelArg(ckStore, 4, sizeof(cl_ulong), (void*)&ulOffsetB);
+		GPUError |= clSetKernelArg(ckStore, 5, sizeof(cl_int), (void*)&iChannelB);
+		GPUError |= clSetKernelArg(ckStore, 6, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+		GPUError |= clSetKernelArg(ckStore, 7, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+		GPUError |= clSetKernelArg(ckStore, 8, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+		GPUError |= clSetKernelArg(ckStore, 9, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+		GPUError |= clSetKernelArg(ckStore, 10, sizeof(cl_int), (void*)&iPadWidth);
+		if( GPUError || !EnqueueFFT(GPUCommandQueue, ckStore, "ckFFTStore", iPadWidth, iPadHeight) ) return false;
+	}
+	return true;
+}
+
+bool FFTConvolutionFilter::filterDirect(cl_command_queue GPUCommandQueue)
+{
+	size_t szTileBytes = DirectTileBytes();
+	if( (cl_ulong)szTileBytes > LocalMemSize() ) return false;
+
+	int radius = Radius();
+	GPUError = clSetKernelArg(GPUFilter, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
+	GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+	GPUError |= clSetKernelArg(GPUFilter, 2, szTileBytes, NULL);
+	GPUError |= clSetKernelArg(GPUFilter, 3, sizeof(cl_int), (void*)&radius);
+	GPUError |= clSetKernelArg(GPUFilter, 4, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+	GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUFilter, 6, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUFilter, 7, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+	GPUError |= clSetKernelArg(GPUFilter, 8, sizeof(cl_mem), (void*)&cmDevBufMask);
+	GPUError |= clSetKernelArg(GPUFilter, 9, sizeof(cl_int), (void*)&iMaskRadiusX);
+	GPUError |= clSetKernelArg(GPUFilter, 10, sizeof(cl_int), (void*)&iMaskRadiusY);
+	if(GPUError) return false;
+
+	return EnqueueKernel(GPUCommandQueue);
+}
+
+bool FFTConvolutionFilter::filter(cl_command_queue GPUCommandQueue)
+{
+	if( mask == NULL || GPUFilter == NULL ) return false;
+	if( SelectedMethod() == CONV_FFT ) return filterFFT(GPUCommandQueue);
+	return filterDirect(GPUCommandQueue);
+}
+
+bool FFTConvolutionFilter::filterHost()
+{
+	if( mask == NULL ) return false;
+	HostConvFloat(GPUTransfer->HostBuf, GPUTransfer->HostBufOut, GPUTransfer->ImageWidth, GPUTransfer->ImageHeight, GPUTransfer->nChannels, mask, iMaskRadiusX, iMaskRadiusY);
+	return true;
+}
+
+int FFTConvolutionFilter::Radius()
+{
+	return max(max(iMaskRadiusX, iMaskRadiusY), 0);
+}
+
+bool FFTConvolutionFilter::Autotune(cl_command_queue GPUCommandQueue, cl_device_id GPUDevice)
+{
+	if( SelectedMethod() == CONV_FFT ) return true;
+	return LinearFilter::Autotune(GPUCommandQueue, GPUDevice);
+}
+
+bool FFTConvolutionFilter::PerChannel()
+{
+	return true;
+}
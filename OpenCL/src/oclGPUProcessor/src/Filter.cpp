@@ -10,60 +10,169 @@
 
 Filter::Filter(void)
 {
-
+    GPUTransfer = NULL;
+    GPUProgram = NULL;
+    GPUFilter = NULL;
+    iScratchOwner = GPUTransferManager::NewScratchOwner();
 }
 
 Filter::Filter(char* source, cl_context GPUContext ,GPUTransferManager* transfer,char* KernelName)
 {
     GPUTransfer = transfer;
+    this->KernelName = KernelName;
 
     iBlockDimX = 16;
     iBlockDimY = 16;
-    size_t szKernelLength;	
-	size_t szKernelLengthFilter;
-	size_t szKernelLengthSum;
-
-    // Load OpenCL kernel
-	SourceOpenCL = oclLoadProgSource("/home/mateusz/Pulpit/GIT/gpuprocessor/OpenCL/src/oclGPUProcessor/src/OpenCL/GPUCode.cl", "// My comment\n", &szKernelLength);
-
-    SourceOpenCLFilter = oclLoadProgSource(source, "// My comment\n", &szKernelLengthFilter);
+    GPUProgram = NULL;
+    GPUFilter = NULL;
+    iScratchOwner = GPUTransferManager::NewScratchOwner();
 
-	//strncat (SourceOpenCL, SourceOpenCLFilter,szKernelLengthFilter );
-	szKernelLengthSum = szKernelLength + szKernelLengthFilter;
-	char* sourceCL = new char[szKernelLengthSum];
-	strcpy(sourceCL,SourceOpenCL);
-	strcat (sourceCL, SourceOpenCLFilter);
+    // Host mode, filterHost() is used instead of the kernel
+    if( GPUContext == NULL ) return;
 
-    // creates a program object for a context, and loads the source code specified by the text strings in
-    //the strings array into the program object. The devices associated with the program object are the
-    //devices associated with context.
-
-    
-    GPUProgram = clCreateProgramWithSource( GPUContext , 1, (const char **)&sourceCL, &szKernelLengthSum, &GPUError);
-
-	
-    CheckError(GPUError);
-
-    // Build the program with 'mad' Optimization option
+    // Program made from GPUCode.cl and filter's .cl file is built with 'mad' Optimization option once per context,
+    // filters using the same .cl file share it. Binaries are reused from the on-disk cache.
     char *flags = "-cl-mad-enable";
-//cout << sourceCL << endl;
-    GPUError = clBuildProgram(GPUProgram, 0, NULL, flags, NULL, NULL);
+    GPUProgram = ProgramRegistry::Acquire( GPUContext, source, flags, &GPUError);
     CheckErrorBuildProgram(GPUError);
-    cout << GPUError << endl;
     GPUFilter = clCreateKernel(GPUProgram, KernelName, &GPUError);
 
+    // Work-group size found by Autotune() in one of previous runs
+    if( transfer != NULL && transfer->GPUDevice != NULL )
+    {
+        WorkGroupTuner::Lookup(transfer->GPUDevice, this->KernelName, &iBlockDimX, &iBlockDimY);
+    }
+
 }
 
 Filter::~Filter()
 {
     //cout << "~Filter" <<endl;
 	
-    if(GPUProgram)clReleaseProgram(GPUProgram);
-
     if(GPUFilter)clReleaseKernel(GPUFilter);
+
+    if(GPUProgram)ProgramRegistry::Release(GPUProgram);
 	
 }
 
+bool Filter::EnqueueKernel(cl_command_queue GPUCommandQueue)
+{
+	return EnqueueKernel(GPUCommandQueue, GPUFilter, KernelName.c_str());
+}
+
+bool Filter::EnqueueKernel(cl_command_queue GPUCommandQueue, cl_kernel kernel, const char* name)
+{
+	size_t GPULocalWorkSize[3];
+    GPULocalWorkSize[0] = iBlockDimX;
+    GPULocalWorkSize[1] = iBlockDimY;
+    GPULocalWorkSize[2] = 1;
+    GPUGlobalWorkSize[0] = shrRoundUp((int)GPULocalWorkSize[0], GPUTransfer->ImageWidth);
+    GPUGlobalWorkSize[1] = shrRoundUp((int)GPULocalWorkSize[1], (int)GPUTransfer->ImageHeight);
+    GPUGlobalWorkSize[2] = GPUTransfer->BatchSize;
+
+    // Third dimension selects image of the batch
+    cl_uint uiWorkDim = (GPUTransfer->BatchSize > 1) ? 3 : 2;
+
+    cl_event event;
+    GPUProfiler* profiler = GPUTransfer->Profiler;
+    if( clEnqueueNDRangeKernel( GPUCommandQueue, kernel, uiWorkDim, NULL, GPUGlobalWorkSize, GPULocalWorkSize, 0, NULL, profiler ? &event : NULL) ) return false;
+    if( profiler ) profiler->Record(name, event);
+	return true;
+}
+
+cl_ulong Filter::LocalMemSize()
+{
+    cl_ulong ulLocalMem = 0;
+    if( GPUTransfer->GPUDevice == NULL ) return 0;
+    clGetDeviceInfo(GPUTransfer->GPUDevice, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &ulLocalMem, NULL);
+    return ulLocalMem;
+}
+
+bool Filter::filterHost()
+{
+    return false;
+}
+
+int Filter::Radius()
+{
+    return 1;
+}
+
+bool Filter::PerChannel()
+{
+    return false;
+}
+
+void Filter::SetTransfer(GPUTransferManager* transfer)
+{
+    GPUTransfer = transfer;
+}
+
+bool Filter::Autotune(cl_command_queue GPUCommandQueue, cl_device_id GPUDevice)
+{
+    if( GPUFilter == NULL ) return true;
+
+    size_t szMaxGroup = 0;
+    size_t szMaxItems[3] = {0, 0, 0};
+    cl_ulong ulLocalMem = 0;
+    clGetKernelWorkGroupInfo(GPUFilter, GPUDevice, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &szMaxGroup, NULL);
+    clGetDeviceInfo(GPUDevice, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(szMaxItems), szMaxItems, NULL);
+    clGetDeviceInfo(GPUDevice, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &ulLocalMem, NULL);
+
+    // Kernels run on a private profiler, results don't go to the user's one
+    GPUProfiler* saved = GPUTransfer->Profiler;
+    GPUProfiler profiler;
+    GPUTransfer->Profiler = &profiler;
+
+    int iBestX = iBlockDimX;
+    int iBestY = iBlockDimY;
+    cl_ulong ulBestTime = 0;
+    const int iRuns = 5;
+
+    // Mask is loaded by the first 9 work items of a row and the apron by the first 2 rows, so X >= 16 and Y >= 2
+    for( int x = 16 ; x <= 256 ; x *= 2 )
+    {
+        for( int y = 2 ; y <= 32 ; y *= 2 )
+        {
+            if( (size_t)(x * y) > szMaxGroup || (size_t)x > szMaxItems[0] || (size_t)y > szMaxItems[1] ) continue;
+            // Tile with apron and two 3x3 masks must fit in local memory
+            if( (cl_ulong)((x + 2) * (y + 2) * GPUTransfer->nChannels + 2 * 9 * sizeof(int)) > ulLocalMem ) continue;
+
+            iBlockDimX = x;
+            iBlockDimY = y;
+
+            // First launch is warm-up
+            if( !filter(GPUCommandQueue) ) continue;
+            clFinish(GPUCommandQueue);
+            profiler.Reset();
+
+            bool ok = true;
+            for( int i = 0 ; i < iRuns && ok ; ++i ) ok = filter(GPUCommandQueue);
+            if( !ok ) continue;
+
+            vector<ProfileRecord> records = profiler.GetRecords();
+            cl_ulong ulTime = 0;
+            for( size_t i = 0 ; i < records.size() ; ++i ) ulTime += records[i].End - records[i].Start;
+            profiler.Reset();
+
+            if( ulBestTime == 0 || ulTime < ulBestTime )
+            {
+                ulBestTime = ulTime;
+                iBestX = x;
+                iBestY = y;
+            }
+        }
+    }
+
+    GPUTransfer->Profiler = saved;
+    iBlockDimX = iBestX;
+    iBlockDimY = iBestY;
+    if( ulBestTime == 0 ) return false;
+
+    WorkGroupTuner::Store(GPUDevice, KernelName, iBlockDimX, iBlockDimY);
+    return true;
+}
+
 void Filter::CheckErrorBuildProgram(int code)
 {
 	switch(code)
@@ -8,43 +8,119 @@
  */
 
 #include "GPUImageProcessor.h"
+#include "HostFilters.h"
 
-GPUImageProcessor::GPUImageProcessor(int width,int height,int nChannels)
+GPUImageProcessor::GPUImageProcessor(int width,int height,int nChannels,cl_device_type deviceType,int deviceIndex,int platformIndex,bool profiling)
 {
     //cout << "gpu computing konstr" << endl;
-    
-	
 
-	GPUError = oclGetPlatformID(&cpPlatform);
-    CheckError(GPUError);
+	cdDevices = NULL;
+	uiDevCount = 0;
+	GPUContext = NULL;
+	GPUCommandQueue = NULL;
+	Transfer = NULL;
+	Profiler = NULL;
+	GPUUploadQueue = NULL;
+	GPUDownloadQueue = NULL;
+	nStreamFrames = 0;
+	iStripCapacity = 0;
+	iStripWidth = 0;
+	iTileCapacity = 0;
+	iTileWidth = 0;
+	TileQueues[0] = TileQueues[1] = NULL;
+	TileTransfers[0] = TileTransfers[1] = NULL;
+
+	if( deviceType == DEVICE_TYPE_HOST )
+	{
+		UseHost(width, height, nChannels, profiling);
+		return;
+	}
+
+	if( platformIndex < 0 )
+	{
+		GPUError = oclGetPlatformID(&cpPlatform);
+		CheckError(GPUError);
+		if( GPUError != CL_SUCCESS )
+		{
+			UseHost(width, height, nChannels, profiling);
+			return;
+		}
+	}
+	else
+	{
+		cl_uint uiNumPlatforms = 0;
+		GPUError = clGetPlatformIDs(0, NULL, &uiNumPlatforms);
+		CheckError(GPUError);
+		if( (cl_uint)platformIndex >= uiNumPlatforms )
+		{
+			cout << "Platform " << platformIndex << " not found" << endl;
+			UseHost(width, height, nChannels, profiling);
+			return;
+		}
+		cl_platform_id* platforms = new cl_platform_id [uiNumPlatforms];
+		GPUError = clGetPlatformIDs(uiNumPlatforms, platforms, NULL);
+		CheckError(GPUError);
+		cpPlatform = platforms[platformIndex];
+		delete [] platforms;
+	}
 
 	cl_uint uiNumAllDevs = 0;
 
-	// Get the number of GPU devices available to the platform
-    GPUError = clGetDeviceIDs(cpPlatform, CL_DEVICE_TYPE_GPU, 0, NULL, &uiNumAllDevs);
+	// Get the number of devices of requested type available to the platform
+    GPUError = clGetDeviceIDs(cpPlatform, deviceType, 0, NULL, &uiNumAllDevs);
     CheckError(GPUError);
+    if( uiNumAllDevs == 0 || (deviceIndex >= 0 && (cl_uint)deviceIndex >= uiNumAllDevs) )
+    {
+        cout << "Device not found" << endl;
+        UseHost(width, height, nChannels, profiling);
+        return;
+    }
     uiDevCount = uiNumAllDevs;
 
     // Create the device list
     cdDevices = new cl_device_id [uiDevCount];
-    GPUError = clGetDeviceIDs(cpPlatform, CL_DEVICE_TYPE_GPU, uiDevCount, cdDevices, NULL);
+    GPUError = clGetDeviceIDs(cpPlatform, deviceType, uiDevCount, cdDevices, NULL);
     CheckError(GPUError);
 
-    // Create the OpenCL context on a GPU device
+    // Create the OpenCL context on all devices of requested type
     GPUContext = clCreateContext(0, uiNumAllDevs, cdDevices, NULL, NULL, &GPUError);
     CheckError(GPUError);
-    
-	
-    
+
+    // Selected device is moved to the front, cdDevices[0] is used for processing of whole images
+    cl_device_id selected = (deviceIndex < 0) ? oclGetMaxFlopsDev(GPUContext) : cdDevices[deviceIndex];
+    for( cl_uint d = 0 ; d < uiDevCount ; ++d )
+    {
+        if( cdDevices[d] == selected )
+        {
+            cdDevices[d] = cdDevices[0];
+            cdDevices[0] = selected;
+            break;
+        }
+    }
+
     //The command-queue can be used to queue a set of operations (referred to as commands) in order.
-    GPUCommandQueue = clCreateCommandQueue(GPUContext, cdDevices[0], 0, &GPUError);
+    QueueProperties = profiling ? CL_QUEUE_PROFILING_ENABLE : 0;
+    GPUCommandQueue = clCreateCommandQueue(GPUContext, cdDevices[0], QueueProperties, &GPUError);
     CheckError(GPUError);
 
 	Transfer = new GPUTransferManager(GPUContext,GPUCommandQueue,width,height,nChannels);
+
+	Profiler = profiling ? new GPUProfiler() : NULL;
+	Transfer->Profiler = Profiler;
 	
     oclPrintDevName(LOGBOTH, cdDevices[0]);  
 }
 
+void GPUImageProcessor::UseHost(int width, int height, int nChannels, bool profiling)
+{
+	// Kernels aren't launched, so there is nothing to profile
+	if( profiling ) cout << "Profiling isn't available on host" << endl;
+
+	QueueProperties = 0;
+	Transfer = new GPUTransferManager(width,height,nChannels);
+	cout << "Host processing, " << HostThreadCount() << " threads" << endl;
+}
+
 void GPUImageProcessor::CheckError(int code)
 {
     switch(code)
@@ -60,15 +136,20 @@ void GPUImageProcessor::CheckError(int code)
 
 GPUImageProcessor::~GPUImageProcessor()
 {
+	StopStreaming();
+	ReleaseDevices();
+	ReleaseTiles();
 	delete Transfer;
     int i = (int)filters.size();
     for( int j = 0 ; j < i ; j++)
     {
         delete filters[j];
     }
+    delete Profiler;
 
     if(GPUCommandQueue)clReleaseCommandQueue(GPUCommandQueue);
     if(GPUContext)clReleaseContext(GPUContext);
+    delete [] cdDevices;
 }
 
 void GPUImageProcessor::AddProcessing(Filter* filter)
@@ -78,10 +159,383 @@ void GPUImageProcessor::AddProcessing(Filter* filter)
 
 void GPUImageProcessor::Process()
 {
+    RunChain(GPUCommandQueue, Transfer);
+}
+
+TransferHandle* GPUImageProcessor::ProcessAsync(IplImage* input)
+{
+    // Kernels follow the upload in the in-order queue, its handle isn't needed
+    delete Transfer->BeginSendImage(input);
+    Process();
+    return Transfer->BeginReceiveImage();
+}
+
+IplImage* GPUImageProcessor::ProcessZeroCopy(IplImage* input)
+{
+    // Previous result is released, default buffers are bound again
+    Transfer->UnmapImage();
+    if( !Transfer->WrapImage(input) ) Transfer->SendImage(input);
+    Process();
+    return Transfer->MapImage();
+}
+
+IplImage* GPUImageProcessor::AcquireFrame()
+{
+    return Transfer->AcquireHostImage();
+}
+
+IplImage* GPUImageProcessor::ProcessAcquired()
+{
+    Transfer->SubmitHostImage();
+    Process();
+    return Transfer->MapImage();
+}
+
+void GPUImageProcessor::ReleaseZeroCopy()
+{
+    Transfer->UnmapImage();
+}
+
+void GPUImageProcessor::RunChain(cl_command_queue queue, GPUTransferManager* transfer)
+{
+    int i = (int)filters.size();
+    for( int j = 0 ; j < i ; j++)
+    {
+        filters[j]->SetTransfer(transfer);
+        // Planes are merged before the first filter mixing channels, rest of the chain runs interleaved
+        if( !filters[j]->PerChannel() ) transfer->Interleave();
+        bool done = transfer->HostMode ? filters[j]->filterHost() : filters[j]->filter(queue);
+        // Output of this filter is the input of the next one
+        if( done ) transfer->SwapBuffers();
+    }
+}
+
+void GPUImageProcessor::ProcessHost(IplImage* input, IplImage* output)
+{
+    if( !Transfer->SendImage(input) ) return;
+    RunChain(NULL, Transfer);
+
+    int rowBytes = input->width * Transfer->nChannels;
+    for( int y = 0 ; y < input->height ; ++y )
+    {
+        memcpy(output->imageData + y * output->widthStep, Transfer->HostBuf + y * Transfer->ImagePitch, rowBytes);
+    }
+}
+
+bool GPUImageProcessor::ProcessBatch(IplImage** input, IplImage** output, int count)
+{
+    if( count <= 0 ) return true;
+
+    if( Transfer->HostMode )
+    {
+        for( int k = 0 ; k < count ; ++k ) ProcessHost(input[k], output[k]);
+        return true;
+    }
+
+    if( !Transfer->SendBatch(input, count) ) return false;
+    RunChain(GPUCommandQueue, Transfer);
+    Transfer->ReceiveBatch(output, count);
+    return true;
+}
+
+int GPUImageProcessor::ChainRadius()
+{
+    int radius = 0;
+    int i = (int)filters.size();
+    for( int j = 0 ; j < i ; j++)
+    {
+        radius += filters[j]->Radius();
+    }
+    return radius;
+}
+
+void GPUImageProcessor::ProcessStrips(IplImage* input, IplImage* output)
+{
+    // Host backend splits rows between threads itself
+    if( Transfer->HostMode )
+    {
+        ProcessHost(input, output);
+        return;
+    }
+
+    int height = input->height;
+    int radius = ChainRadius();
+
+    if( DeviceQueues.empty() )
+    {
+        DeviceQueues.resize(uiDevCount);
+        for( cl_uint d = 0 ; d < uiDevCount ; ++d )
+        {
+            DeviceQueues[d] = clCreateCommandQueue(GPUContext, cdDevices[d], QueueProperties, &GPUError);
+            CheckError(GPUError);
+        }
+    }
+
+    // Strip height proportional to number of compute units of device
+    vector<cl_uint> units(uiDevCount, 1);
+    cl_uint totalUnits = 0;
+    for( cl_uint d = 0 ; d < uiDevCount ; ++d )
+    {
+        clGetDeviceInfo(cdDevices[d], CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &units[d], NULL);
+        totalUnits += units[d];
+    }
+
+    vector<int> first(uiDevCount + 1, 0);
+    cl_uint sumUnits = 0;
+    int iMaxRows = 0;
+    for( cl_uint d = 0 ; d < uiDevCount ; ++d )
+    {
+        sumUnits += units[d];
+        first[d+1] = (int)((long long)height * sumUnits / totalUnits);
+        iMaxRows = max(iMaxRows, first[d+1] - first[d]);
+    }
+
+    int iCapacity = min(height, iMaxRows + 2 * radius);
+    if( DeviceTransfers.empty() || iStripWidth != input->width || iStripCapacity < iCapacity )
+    {
+        for( size_t d = 0 ; d < DeviceTransfers.size() ; ++d ) delete DeviceTransfers[d];
+        DeviceTransfers.resize(uiDevCount);
+        for( cl_uint d = 0 ; d < uiDevCount ; ++d )
+        {
+            DeviceTransfers[d] = new GPUTransferManager(GPUContext, DeviceQueues[d], input->width, iCapacity, Transfer->HostChannels);
+            DeviceTransfers[d]->Profiler = Profiler;
+        }
+        iStripWidth = input->width;
+        iStripCapacity = iCapacity;
+    }
+
+    // All commands are enqueued first, devices work in parallel
+    for( cl_uint d = 0 ; d < uiDevCount ; ++d )
+    {
+        if( first[d+1] == first[d] ) continue;
+
+        ProcessBand(DeviceQueues[d], DeviceTransfers[d], input, output, first[d], first[d+1], radius);
+    }
+
+    for( cl_uint d = 0 ; d < uiDevCount ; ++d )
+    {
+        clFinish(DeviceQueues[d]);
+    }
 
+    // Filters work on the default transfer manager again
     int i = (int)filters.size();
     for( int j = 0 ; j < i ; j++)
     {
-        filters[j]->filter(GPUCommandQueue);
+        filters[j]->SetTransfer(Transfer);
     }
 }
+
+void GPUImageProcessor::ProcessBand(cl_command_queue queue, GPUTransferManager* transfer, IplImage* input, IplImage* output, int first, int last, int radius)
+{
+    int top = max(0, first - radius);
+    int bottom = min(input->height, last + radius);
+
+    transfer->SendRows(input, top, bottom - top);
+    RunChain(queue, transfer);
+    transfer->ReceiveRows(output, first, last - first, first - top);
+    clFlush(queue);
+}
+
+bool GPUImageProcessor::ProcessTiled(IplImage* input, IplImage* output, size_t maxTileBytes)
+{
+    if( Transfer->HostMode )
+    {
+        ProcessHost(input, output);
+        return true;
+    }
+
+    int height = input->height;
+    int radius = ChainRadius();
+    size_t szRowBytes = Transfer->RowPitch(input->width);
+
+    if( maxTileBytes == 0 )
+    {
+        // Two slots, each one has input and output buffer
+        cl_ulong ulMaxAlloc = 0;
+        cl_ulong ulGlobalMem = 0;
+        clGetDeviceInfo(cdDevices[0], CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &ulMaxAlloc, NULL);
+        clGetDeviceInfo(cdDevices[0], CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &ulGlobalMem, NULL);
+        maxTileBytes = (size_t)min(ulMaxAlloc, ulGlobalMem / 8);
+    }
+
+    int iTileRows = (int)(maxTileBytes / szRowBytes) - 2 * radius;
+    if( iTileRows <= 0 )
+    {
+        cout << "Tile is smaller than halo" << endl;
+        return false;
+    }
+    iTileRows = min(iTileRows, height);
+
+    int iCapacity = min(height, iTileRows + 2 * radius);
+    if( TileTransfers[0] == NULL || iTileWidth != input->width || iTileCapacity < iCapacity )
+    {
+        ReleaseTiles();
+        for( int slot = 0 ; slot < 2 ; ++slot )
+        {
+            TileQueues[slot] = clCreateCommandQueue(GPUContext, cdDevices[0], QueueProperties, &GPUError);
+            CheckError(GPUError);
+            TileTransfers[slot] = new GPUTransferManager(GPUContext, TileQueues[slot], input->width, iCapacity, Transfer->HostChannels);
+            TileTransfers[slot]->Profiler = Profiler;
+        }
+        iTileWidth = input->width;
+        iTileCapacity = iCapacity;
+    }
+
+    // Filters keep scratch buffers in transfer manager of the slot, so kernels of both slots don't share them
+    int slot = 0;
+    for( int first = 0 ; first < height ; first += iTileRows )
+    {
+        // Buffers of this slot are free when its previous tile is downloaded
+        clFinish(TileQueues[slot]);
+        ProcessBand(TileQueues[slot], TileTransfers[slot], input, output, first, min(height, first + iTileRows), radius);
+        slot = 1 - slot;
+    }
+
+    clFinish(TileQueues[0]);
+    clFinish(TileQueues[1]);
+
+    int i = (int)filters.size();
+    for( int j = 0 ; j < i ; j++)
+    {
+        filters[j]->SetTransfer(Transfer);
+    }
+    return true;
+}
+
+void GPUImageProcessor::ReleaseTiles()
+{
+    for( int slot = 0 ; slot < 2 ; ++slot )
+    {
+        delete TileTransfers[slot];
+        if(TileQueues[slot])clReleaseCommandQueue(TileQueues[slot]);
+        TileTransfers[slot] = NULL;
+        TileQueues[slot] = NULL;
+    }
+    iTileCapacity = 0;
+    iTileWidth = 0;
+}
+
+void GPUImageProcessor::ReleaseDevices()
+{
+    for( size_t d = 0 ; d < DeviceTransfers.size() ; ++d )
+    {
+        delete DeviceTransfers[d];
+    }
+    for( size_t d = 0 ; d < DeviceQueues.size() ; ++d )
+    {
+        if(DeviceQueues[d])clReleaseCommandQueue(DeviceQueues[d]);
+    }
+    DeviceTransfers.clear();
+    DeviceQueues.clear();
+    iStripCapacity = 0;
+    iStripWidth = 0;
+}
+
+
+bool GPUImageProcessor::Autotune(IplImage* sample)
+{
+    if( Transfer->HostMode ) return false;
+
+    // Kernel times are read from events, so tuning needs its own profiling queue
+    cl_command_queue GPUTuningQueue = clCreateCommandQueue(GPUContext, cdDevices[0], CL_QUEUE_PROFILING_ENABLE, &GPUError);
+    CheckError(GPUError);
+    if( GPUError != CL_SUCCESS ) return false;
+
+    Transfer->SendImage(sample);
+    bool tuned = true;
+    int i = (int)filters.size();
+    for( int j = 0 ; j < i ; j++)
+    {
+        // Filter keeps its default size if tuning fails
+        tuned = filters[j]->Autotune(GPUTuningQueue, cdDevices[0]) && tuned;
+    }
+    clFinish(GPUTuningQueue);
+    clReleaseCommandQueue(GPUTuningQueue);
+    return tuned;
+}
+
+void GPUImageProcessor::StartStreaming(int frames)
+{
+    StopStreaming();
+    if( Transfer->HostMode )
+    {
+        cout << "Streaming isn't available on host" << endl;
+        return;
+    }
+
+    // Separate queues for transfers, commands from different queues can run concurrently
+    GPUUploadQueue = clCreateCommandQueue(GPUContext, cdDevices[0], QueueProperties, &GPUError);
+    CheckError(GPUError);
+    GPUDownloadQueue = clCreateCommandQueue(GPUContext, cdDevices[0], QueueProperties, &GPUError);
+    CheckError(GPUError);
+
+    Transfer->AllocateFrames(frames);
+    StreamEvents.assign(frames, (cl_event)NULL);
+    nStreamFrames = frames;
+    iStreamSubmitted = 0;
+    iStreamReturned = 0;
+}
+
+IplImage* GPUImageProcessor::ProcessFrame(IplImage* frame)
+{
+    if( nStreamFrames == 0 ) return NULL;
+
+    int slot = iStreamSubmitted % nStreamFrames;
+    cl_event uploaded;
+    cl_event computed;
+
+    // Slot is free, its previous frame was returned before
+    Transfer->BindFrame(slot);
+    Transfer->SendImageAsync(frame, GPUUploadQueue, &uploaded);
+    clFlush(GPUUploadQueue);
+
+    // Kernels of this frame start when its upload is done
+    GPUError = clEnqueueWaitForEvents(GPUCommandQueue, 1, &uploaded);
+    CheckError(GPUError);
+    Process();
+    GPUError = clEnqueueMarker(GPUCommandQueue, &computed);
+    CheckError(GPUError);
+    clFlush(GPUCommandQueue);
+
+    Transfer->ReceiveImageAsync(GPUDownloadQueue, 1, &computed, &StreamEvents[slot]);
+    clFlush(GPUDownloadQueue);
+    Transfer->BindFrame(-1);
+
+    clReleaseEvent(uploaded);
+    clReleaseEvent(computed);
+    iStreamSubmitted++;
+
+    if( iStreamSubmitted - iStreamReturned < nStreamFrames ) return NULL;
+    return FlushFrame();
+}
+
+IplImage* GPUImageProcessor::FlushFrame()
+{
+    if( nStreamFrames == 0 || iStreamReturned == iStreamSubmitted ) return NULL;
+
+    int slot = iStreamReturned % nStreamFrames;
+    GPUError = clWaitForEvents(1, &StreamEvents[slot]);
+    CheckError(GPUError);
+    clReleaseEvent(StreamEvents[slot]);
+    StreamEvents[slot] = NULL;
+    iStreamReturned++;
+
+    return Transfer->GetFrameImage(slot);
+}
+
+void GPUImageProcessor::StopStreaming()
+{
+    if( nStreamFrames == 0 ) return;
+
+    while( FlushFrame() != NULL );
+    clFinish(GPUCommandQueue);
+
+    Transfer->ReleaseFrames();
+    StreamEvents.clear();
+    nStreamFrames = 0;
+
+    if(GPUUploadQueue)clReleaseCommandQueue(GPUUploadQueue);
+    if(GPUDownloadQueue)clReleaseCommandQueue(GPUDownloadQueue);
+    GPUUploadQueue = NULL;
+    GPUDownloadQueue = NULL;
+}
@@ -0,0 +1,67 @@
+/*!
+ * \file GPUProfiler.cpp
+ * \brief Collecting device timings of kernels and transfers.
+ */
+
+#include "GPUProfiler.h"
+
+GPUProfiler::~GPUProfiler()
+{
+	Reset();
+}
+
+void GPUProfiler::Record(const char* name, cl_event event)
+{
+	Names.push_back(name);
+	Events.push_back(event);
+}
+
+vector<ProfileRecord> GPUProfiler::GetRecords()
+{
+	vector<ProfileRecord> records(Events.size());
+	if( Events.empty() ) return records;
+
+	clWaitForEvents((cl_uint)Events.size(), &Events[0]);
+	for( size_t i = 0 ; i < Events.size() ; ++i )
+	{
+		records[i].Name = Names[i];
+		clGetEventProfilingInfo(Events[i], CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &records[i].Queued, NULL);
+		clGetEventProfilingInfo(Events[i], CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &records[i].Submit, NULL);
+		clGetEventProfilingInfo(Events[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &records[i].Start, NULL);
+		clGetEventProfilingInfo(Events[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &records[i].End, NULL);
+	}
+	return records;
+}
+
+void GPUProfiler::Print()
+{
+	vector<ProfileRecord> records = GetRecords();
+	if( records.empty() ) return;
+
+	cl_ulong origin = records[0].Queued;
+	for( size_t i = 1 ; i < records.size() ; ++i )
+	{
+		if( records[i].Queued < origin ) origin = records[i].Queued;
+	}
+
+	printf("%-24s %10s %10s %10s %10s %10s\n", "command", "queued", "submit", "start", "end", "time");
+	for( size_t i = 0 ; i < records.size() ; ++i )
+	{
+		printf("%-24s %10.3f %10.3f %10.3f %10.3f %10.3f\n", records[i].Name.c_str(),
+			(records[i].Queued - origin) * 1.0e-6,
+			(records[i].Submit - origin) * 1.0e-6,
+			(records[i].Start - origin) * 1.0e-6,
+			(records[i].End - origin) * 1.0e-6,
+			(records[i].End - records[i].Start) * 1.0e-6);
+	}
+}
+
+void GPUProfiler::Reset()
+{
+	for( size_t i = 0 ; i < Events.size() ; ++i )
+	{
+		clReleaseEvent(Events[i]);
+	}
+	Names.clear();
+	Events.clear();
+}
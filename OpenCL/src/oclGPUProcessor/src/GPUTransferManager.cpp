@@ -7,17 +7,100 @@
  */
 
 #include "GPUTransferManager.h"
+#include "ProgramRegistry.h"
+
+int GPUTransferManager::iScratchOwners = 0;
 
 GPUTransferManager::~GPUTransferManager(void)
 {
 	 Cleanup();
+	 CondDestroy(StagingReleased);
+	 MutexDestroy(StagingLock);
 }
 
 GPUTransferManager::GPUTransferManager()
 {
 	cmDevBuf = NULL;
+	cmDevBufOut = NULL;
+	GPUDevice = NULL;
+	Profiler = NULL;
+	BatchSize = 1;
+	ImagePitch = 0;
+	szDevBuffCapacity = 0;
+	nFrames = 0;
+	iBoundFrame = -1;
     GPUInputOutput = NULL;
     cmPinnedBuf = NULL;
+    Upload = UPLOAD_PINNED;
+    iStagingSlot = 0;
+    szStagingBytes = 0;
+    for( int i = 0 ; i < STAGING_BUFFERS ; ++i )
+    {
+        cmStagingBuf[i] = NULL;
+        StagingHost[i] = NULL;
+        StagingEvent[i] = NULL;
+        StagingImage[i] = NULL;
+    }
+    HostMode = false;
+    HostBuf = NULL;
+    HostBufOut = NULL;
+    cmDevImage = NULL;
+    HostChannels = 0;
+    Layout = LAYOUT_INTERLEAVED;
+    cmPackedBuf = NULL;
+    szPackedBytes = 0;
+    GPULayoutProgram = NULL;
+    ckExpand = ckPack = ckSplit = ckMerge = NULL;
+    DeviceLayout = LAYOUT_INTERLEAVED;
+    InitZeroCopy();
+    InitStagingHolds();
+    ReadHost = NULL;
+    szReadBytes = 0;
+}
+
+GPUTransferManager::GPUTransferManager( unsigned int width, unsigned int height, int channels )
+{
+	nChannels = channels;
+	HostChannels = channels;
+	Layout = LAYOUT_INTERLEAVED;
+	cmPackedBuf = NULL;
+	szPackedBytes = 0;
+	GPULayoutProgram = NULL;
+	ckExpand = ckPack = ckSplit = ckMerge = NULL;
+	DeviceLayout = LAYOUT_INTERLEAVED;
+	Profiler = NULL;
+	BatchSize = 1;
+	nFrames = 0;
+	iBoundFrame = -1;
+    GPUContext = NULL;
+    GPUCommandQueue = NULL;
+    GPUDevice = NULL;
+    cmDevBuf = NULL;
+    cmDevBufOut = NULL;
+    cmPinnedBuf = NULL;
+    HostMode = true;
+    cmDevImage = NULL;
+
+    // Filters work on plain host memory, output buffer holds the image returned by ReceiveImage
+    SetImageSize(width, height);
+    HostBuf = (unsigned char*)malloc(szBuffBytes);
+    HostBufOut = (unsigned char*)malloc(szBuffBytes);
+    GPUInputOutput = (cl_uint*)malloc(szBuffBytes);
+    szDevBuffCapacity = szBuffBytes;
+    Upload = UPLOAD_PAGEABLE;
+    iStagingSlot = 0;
+    szStagingBytes = 0;
+    for( int i = 0 ; i < STAGING_BUFFERS ; ++i )
+    {
+        cmStagingBuf[i] = NULL;
+        StagingHost[i] = NULL;
+        StagingEvent[i] = NULL;
+        StagingImage[i] = NULL;
+    }
+    InitZeroCopy();
+    InitStagingHolds();
+    ReadHost = NULL;
+    szReadBytes = 0;
 }
 
 GPUTransferManager::GPUTransferManager( cl_context GPUContextArg, cl_command_queue GPUCommandQueueArg, unsigned int width, unsigned int height, int channels )
@@ -25,13 +108,59 @@ GPUTransferManager::GPUTransferManager( cl_context GPUContextArg, cl_command_que
     //cout << "data transfer konstr" << endl;
 	
 	nChannels = channels;
+	HostChannels = channels;
+	Layout = LAYOUT_INTERLEAVED;
+	cmPackedBuf = NULL;
+	szPackedBytes = 0;
+	GPULayoutProgram = NULL;
+	ckExpand = ckPack = ckSplit = ckMerge = NULL;
+	DeviceLayout = LAYOUT_INTERLEAVED;
+	Profiler = NULL;
+	BatchSize = 1;
+	nFrames = 0;
+	iBoundFrame = -1;
+    HostMode = false;
+    HostBuf = NULL;
+    HostBufOut = NULL;
+    cmDevImage = NULL;
+    InitZeroCopy();
+    InitStagingHolds();
+    ReadHost = NULL;
+    szReadBytes = 0;
     GPUContext = GPUContextArg;
-    ImageHeight = height;
-    ImageWidth = width;
     GPUCommandQueue = GPUCommandQueueArg;
 
+    // Device selected by the owner of the queue, context may hold other devices too
+    GPUDevice = NULL;
+    clGetCommandQueueInfo(GPUCommandQueue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &GPUDevice, NULL);
+
+    SetImageSize(width, height);
+    Upload = UPLOAD_PINNED;
+    iStagingSlot = 0;
+    szStagingBytes = 0;
+    cmPinnedBuf = NULL;
+    GPUInputOutput = NULL;
+    cmDevBuf = NULL;
+    cmDevBufOut = NULL;
+    szDevBuffCapacity = 0;
+    for( int i = 0 ; i < STAGING_BUFFERS ; ++i )
+    {
+        cmStagingBuf[i] = NULL;
+        StagingHost[i] = NULL;
+        StagingEvent[i] = NULL;
+        StagingImage[i] = NULL;
+    }
+
+    // Image bigger than the device is processed in tiles by GPUImageProcessor::ProcessTiled(), buffers of the whole image
+    // aren't created. Without staging buffers transfers write from image data, device buffers are created by the first transfer.
+    cl_ulong ulMaxAlloc = 0;
+    cl_ulong ulGlobalMem = 0;
+    clGetDeviceInfo(GPUDevice, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &ulMaxAlloc, NULL);
+    clGetDeviceInfo(GPUDevice, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &ulGlobalMem, NULL);
+    if( szBuffBytes > ulMaxAlloc || 2 * (cl_ulong)szBuffBytes > ulGlobalMem ) return;
+
     // Allocate pinned input and output host image buffers:  mem copy operations to/from pinned memory is much faster than paged memory
-    szBuffBytes = ImageWidth * ImageHeight * nChannels * sizeof (char);
+    // Buffers have the layout of device image, rows padded to ImagePitch
     // This flag specifies that the application wants the OpenCL implementation to allocate memory from host accessible memory.
     cmPinnedBuf = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, szBuffBytes, NULL, &GPUError);
     CheckError(GPUError);
@@ -41,9 +170,28 @@ GPUTransferManager::GPUTransferManager( cl_context GPUContextArg, cl_command_que
     GPUInputOutput = (cl_uint*)clEnqueueMapBuffer(GPUCommandQueue, cmPinnedBuf, CL_TRUE, CL_MAP_WRITE, 0, szBuffBytes, 0, NULL, NULL, &GPUError);
     CheckError(GPUError);
 
+    // Ring of staging buffers starts with the pinned buffer, uploads and downloads take them in turn
+    szStagingBytes = szBuffBytes;
+    cmStagingBuf[0] = cmPinnedBuf;
+    StagingHost[0] = (char*)GPUInputOutput;
+    StagingImage[0] = cvCreateImageHeader(cvSize(ImageWidth, ImageHeight), IPL_DEPTH_8U, nChannels);
+    for( int i = 1 ; i < STAGING_BUFFERS ; ++i )
+    {
+        cmStagingBuf[i] = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, szBuffBytes, NULL, &GPUError);
+        CheckError(GPUError);
+        StagingHost[i] = (char*)clEnqueueMapBuffer(GPUCommandQueue, cmStagingBuf[i], CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, szBuffBytes, 0, NULL, NULL, &GPUError);
+        CheckError(GPUError);
+        StagingImage[i] = cvCreateImageHeader(cvSize(ImageWidth, ImageHeight), IPL_DEPTH_8U, nChannels);
+    }
+
     // Create the device buffers in GMEM on each device, for now we have one device :)
     cmDevBuf = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE, szBuffBytes, NULL, &GPUError);
     CheckError(GPUError);
+
+    // Second buffer, kernels never read and write the same buffer (ping-pong)
+    cmDevBufOut = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE, szBuffBytes, NULL, &GPUError);
+    CheckError(GPUError);
+    szDevBuffCapacity = szBuffBytes;
 }
 
 
@@ -83,35 +231,1006 @@ void GPUTransferManager::CheckError(int code)
     }
 }
 
+size_t GPUTransferManager::RowPitch(unsigned int width)
+{
+    size_t szRowBytes = width * nChannels * sizeof (char);
+    if( HostMode ) return szRowBytes;
+    return (szRowBytes + DEVICE_ROW_ALIGN - 1) & ~(size_t)(DEVICE_ROW_ALIGN - 1);
+}
+
+void GPUTransferManager::SetImageSize(unsigned int width, unsigned int height)
+{
+    ImageWidth = width;
+    ImageHeight = height;
+    ImagePitch = (unsigned int)RowPitch(width);
+    szBuffBytes = ImagePitch * ImageHeight;
+}
+
+void GPUTransferManager::CopyRows(char* dst, int dstStep, const char* src, int srcStep, int rows)
+{
+    if( dstStep == srcStep )
+    {
+        memcpy(dst, src, dstStep * rows);
+        return;
+    }
+
+    // Padding of rows isn't copied
+    size_t szRowBytes = ImageWidth * nChannels * sizeof (char);
+    for( int y = 0 ; y < rows ; ++y )
+    {
+        memcpy(dst + y * dstStep, src + y * srcStep, szRowBytes);
+    }
+}
+
+void GPUTransferManager::WriteRows(cl_mem buffer, size_t offset, IplImage* imageToLoad, int firstRow, int rows, cl_bool blocking, const char* name)
+{
+    char* src = imageToLoad->imageData + firstRow * imageToLoad->widthStep;
+    size_t szRowBytes = ImageWidth * nChannels * sizeof (char);
+    cl_event event;
+
+    // Host rows padded like device rows, one transfer
+    if( imageToLoad->widthStep == (int)ImagePitch )
+    {
+        GPUError = clEnqueueWriteBuffer(GPUCommandQueue, buffer, blocking, offset, ImagePitch * rows, (void*)src, 0, NULL, Profiler ? &event : NULL);
+        CheckError(GPUError);
+        if( Profiler && GPUError == CL_SUCCESS ) Profiler->Record(name, event);
+        return;
+    }
+
+#ifdef CL_VERSION_1_1
+    size_t bufferOrigin[3] = { offset, 0, 0 };
+    size_t hostOrigin[3] = { 0, 0, 0 };
+    size_t region[3] = { szRowBytes, (size_t)rows, 1 };
+    GPUError = clEnqueueWriteBufferRect(GPUCommandQueue, buffer, blocking, bufferOrigin, hostOrigin, region, ImagePitch, 0, imageToLoad->widthStep, 0, (void*)src, 0, NULL, Profiler ? &event : NULL);
+    CheckError(GPUError);
+    if( Profiler && GPUError == CL_SUCCESS ) Profiler->Record(name, event);
+#else
+    // No rectangular transfers in OpenCL 1.0, rows are written one by one
+    for( int i = 0 ; i < rows ; ++i )
+    {
+        GPUError = clEnqueueWriteBuffer(GPUCommandQueue, buffer, CL_FALSE, offset + i * ImagePitch, szRowBytes, (void*)(src + i * imageToLoad->widthStep), 0, NULL, Profiler ? &event : NULL);
+        CheckError(GPUError);
+        if( Profiler && GPUError == CL_SUCCESS ) Profiler->Record(name, event);
+    }
+    if( blocking ) clFinish(GPUCommandQueue);
+#endif
+}
+
+void GPUTransferManager::ReadRows(cl_mem buffer, size_t offset, IplImage* imageToStore, int firstRow, int rows, cl_bool blocking, const char* name)
+{
+    char* dst = imageToStore->imageData + firstRow * imageToStore->widthStep;
+    size_t szRowBytes = ImageWidth * nChannels * sizeof (char);
+    cl_event event;
+
+    if( imageToStore->widthStep == (int)ImagePitch )
+    {
+        GPUError = clEnqueueReadBuffer(GPUCommandQueue, buffer, blocking, offset, ImagePitch * rows, (void*)dst, 0, NULL, Profiler ? &event : NULL);
+        CheckError(GPUError);
+        if( Profiler && GPUError == CL_SUCCESS ) Profiler->Record(name, event);
+        return;
+    }
+
+#ifdef CL_VERSION_1_1
+    size_t bufferOrigin[3] = { offset, 0, 0 };
+    size_t hostOrigin[3] = { 0, 0, 0 };
+    size_t region[3] = { szRowBytes, (size_t)rows, 1 };
+    GPUError = clEnqueueReadBufferRect(GPUCommandQueue, buffer, blocking, bufferOrigin, hostOrigin, region, ImagePitch, 0, imageToStore->widthStep, 0, (void*)dst, 0, NULL, Profiler ? &event : NULL);
+    CheckError(GPUError);
+    if( Profiler && GPUError == CL_SUCCESS ) Profiler->Record(name, event);
+#else
+    for( int i = 0 ; i < rows ; ++i )
+    {
+        GPUError = clEnqueueReadBuffer(GPUCommandQueue, buffer, CL_FALSE, offset + i * ImagePitch, szRowBytes, (void*)(dst + i * imageToStore->widthStep), 0, NULL, Profiler ? &event : NULL);
+        CheckError(GPUError);
+        if( Profiler && GPUError == CL_SUCCESS ) Profiler->Record(name, event);
+    }
+    if( blocking ) clFinish(GPUCommandQueue);
+#endif
+}
+
 void GPUTransferManager::Cleanup()
 {
     // Cleanup allocated objects
     //cout << "\nStarting Cleanup...\n\n";
 
+    UnmapImage();
+    if( ZeroCopyImage ) cvReleaseImageHeader(&ZeroCopyImage);
+    if( MappedImage ) cvReleaseImageHeader(&MappedImage);
+    free(ReadHost);
+    ReadHost = NULL;
+    szReadBytes = 0;
+
+    if( HostMode )
+    {
+        free(HostBuf);
+        free(HostBufOut);
+        free(GPUInputOutput);
+        HostBuf = HostBufOut = NULL;
+        GPUInputOutput = NULL;
+        return;
+    }
+
+    ReleaseFrames();
+    if( cmZeroCopyBuf )
+    {
+        if( ZeroCopyHost ) clEnqueueUnmapMemObject(GPUCommandQueue, cmZeroCopyBuf, ZeroCopyHost, 0, NULL, NULL);
+        clFinish(GPUCommandQueue);
+        clReleaseMemObject(cmZeroCopyBuf);
+        cmZeroCopyBuf = NULL;
+        ZeroCopyHost = NULL;
+    }
+    for( int i = 0 ; i < STAGING_BUFFERS ; ++i )
+    {
+        if( StagingEvent[i] ) clReleaseEvent(StagingEvent[i]);
+        if( StagingHost[i] ) clEnqueueUnmapMemObject(GPUCommandQueue, cmStagingBuf[i], StagingHost[i], 0, NULL, NULL);
+        StagingEvent[i] = NULL;
+    }
+    if( StagingHost[0] ) clFinish(GPUCommandQueue);
+    for( int i = 0 ; i < STAGING_BUFFERS ; ++i )
+    {
+        if( cmStagingBuf[i] ) clReleaseMemObject(cmStagingBuf[i]);
+        if( StagingImage[i] ) cvReleaseImageHeader(&StagingImage[i]);
+        cmStagingBuf[i] = NULL;
+        StagingHost[i] = NULL;
+    }
+    cmPinnedBuf = NULL;
+    GPUInputOutput = NULL;
+    if(ckExpand)clReleaseKernel(ckExpand);
+    if(ckPack)clReleaseKernel(ckPack);
+    if(ckSplit)clReleaseKernel(ckSplit);
+    if(ckMerge)clReleaseKernel(ckMerge);
+    if(GPULayoutProgram)ProgramRegistry::Release(GPULayoutProgram);
+    ckExpand = ckPack = ckSplit = ckMerge = NULL;
+    GPULayoutProgram = NULL;
+    if(cmPackedBuf)clReleaseMemObject(cmPackedBuf);
+    cmPackedBuf = NULL;
+    if(cmDevImage)clReleaseMemObject(cmDevImage);
+    cmDevImage = NULL;
     if(cmDevBuf)clReleaseMemObject(cmDevBuf);
+    if(cmDevBufOut)clReleaseMemObject(cmDevBufOut);
+    for( map< pair<int, int>, ScratchBuffer >::iterator it = ScratchBuffers.begin() ; it != ScratchBuffers.end() ; ++it )
+    {
+        if(it->second.Buffer)clReleaseMemObject(it->second.Buffer);
+    }
+    ScratchBuffers.clear();
 	
 }
 
+cl_mem GPUTransferManager::InputImage()
+{
+    if( HostMode ) return NULL;
+    if( cmDevImage && uiDevImageWidth == ImageWidth && uiDevImageHeight == ImageHeight ) return cmDevImage;
+    if( cmDevImage ) clReleaseMemObject(cmDevImage);
+
+    // Four 8-bit channels, samplers return them as normalised floats
+    cl_image_format format;
+    format.image_channel_order = CL_RGBA;
+    format.image_channel_data_type = CL_UNORM_INT8;
+    cmDevImage = clCreateImage2D(GPUContext, CL_MEM_READ_WRITE, &format, ImageWidth, ImageHeight, 0, NULL, &GPUError);
+    CheckError(GPUError);
+    if( GPUError != CL_SUCCESS ) cmDevImage = NULL;
+    uiDevImageWidth = ImageWidth;
+    uiDevImageHeight = ImageHeight;
+    return cmDevImage;
+}
+
+bool GPUTransferManager::ConvertsLayout()
+{
+    if( HostMode ) return false;
+    if( Layout == LAYOUT_RGBA ) return HostChannels == 3;
+    if( Layout == LAYOUT_PLANAR ) return HostChannels > 1;
+    return false;
+}
+
+void GPUTransferManager::SetDeviceLayout(ChannelLayout layout)
+{
+    // Pixels of planes have one channel, RGBA pixels four
+    DeviceLayout = layout;
+    if( layout == LAYOUT_RGBA ) nChannels = 4;
+    else if( layout == LAYOUT_PLANAR ) nChannels = 1;
+    else nChannels = HostChannels;
+    SetImageSize(ImageWidth, ImageHeight);
+}
+
+bool GPUTransferManager::ReserveDeviceBuffers(size_t bytes)
+{
+    if( bytes <= szDevBuffCapacity ) return true;
+
+    if( HostMode )
+    {
+        // Filters work on HostBuf and HostBufOut, ReceiveImage() copies the result to GPUInputOutput
+        free(HostBuf);
+        free(HostBufOut);
+        free(GPUInputOutput);
+        HostBuf = (unsigned char*)malloc(bytes);
+        HostBufOut = (unsigned char*)malloc(bytes);
+        GPUInputOutput = (cl_uint*)malloc(bytes);
+        if( HostBuf == NULL || HostBufOut == NULL || GPUInputOutput == NULL )
+        {
+            CheckError(CL_OUT_OF_HOST_MEMORY);
+            free(HostBuf);
+            free(HostBufOut);
+            free(GPUInputOutput);
+            HostBuf = HostBufOut = NULL;
+            GPUInputOutput = NULL;
+            szDevBuffCapacity = 0;
+            return false;
+        }
+        szDevBuffCapacity = bytes;
+        return true;
+    }
+
+    // Zero-copy buffer is released and default buffers are bound again before they are replaced
+    UnmapImage();
+    if(cmDevBuf)clReleaseMemObject(cmDevBuf);
+    if(cmDevBufOut)clReleaseMemObject(cmDevBufOut);
+    cmDevBuf = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE, bytes, NULL, &GPUError);
+    CheckError(GPUError);
+    cmDevBufOut = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE, bytes, NULL, &GPUError);
+    CheckError(GPUError);
+    if( cmDevBuf == NULL || cmDevBufOut == NULL )
+    {
+        if(cmDevBuf)clReleaseMemObject(cmDevBuf);
+        if(cmDevBufOut)clReleaseMemObject(cmDevBufOut);
+        cmDevBuf = cmDevBufOut = NULL;
+        szDevBuffCapacity = 0;
+        return false;
+    }
+    szDevBuffCapacity = bytes;
+    return true;
+}
+
+bool GPUTransferManager::PrepareLayout()
+{
+    if( GPULayoutProgram == NULL )
+    {
+        GPULayoutProgram = ProgramRegistry::Acquire(GPUContext, "./OpenCL/Layout.cl", "-cl-mad-enable", &GPUError);
+        CheckError(GPUError);
+        if( GPULayoutProgram == NULL ) return false;
+
+        ckExpand = clCreateKernel(GPULayoutProgram, "ckExpandRGBA", &GPUError);
+        CheckError(GPUError);
+        ckPack = clCreateKernel(GPULayoutProgram, "ckPackRGB", &GPUError);
+        CheckError(GPUError);
+        ckSplit = clCreateKernel(GPULayoutProgram, "ckSplitPlanes", &GPUError);
+        CheckError(GPUError);
+        ckMerge = clCreateKernel(GPULayoutProgram, "ckMergePlanes", &GPUError);
+        CheckError(GPUError);
+    }
+    if( ckExpand == NULL || ckPack == NULL || ckSplit == NULL || ckMerge == NULL ) return false;
+
+    // Packed buffer grows with the image, szBuffBytes is the size of packed rows here
+    if( szBuffBytes > szPackedBytes )
+    {
+        if( cmPackedBuf ) clReleaseMemObject(cmPackedBuf);
+        cmPackedBuf = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE, szBuffBytes, NULL, &GPUError);
+        CheckError(GPUError);
+        szPackedBytes = (GPUError == CL_SUCCESS) ? szBuffBytes : 0;
+        if( GPUError != CL_SUCCESS ) cmPackedBuf = NULL;
+    }
+    return cmPackedBuf != NULL;
+}
+
+bool GPUTransferManager::RunLayoutKernel(cl_kernel kernel, cl_mem source, cl_mem dest, unsigned int uiSourcePitch, const char* name, cl_event* event)
+{
+    // One work item per pixel, driver picks the work-group size
+    size_t GPUGlobalWorkSize[2] = { ImageWidth, ImageHeight };
+
+    GPUError = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&source);
+    GPUError |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&dest);
+    GPUError |= clSetKernelArg(kernel, 2, sizeof(cl_uint), (void*)&ImageWidth);
+    GPUError |= clSetKernelArg(kernel, 3, sizeof(cl_uint), (void*)&ImageHeight);
+    GPUError |= clSetKernelArg(kernel, 4, sizeof(cl_int), (void*)&uiSourcePitch);
+    GPUError |= clSetKernelArg(kernel, 5, sizeof(cl_int), (void*)&ImagePitch);
+    GPUError |= clSetKernelArg(kernel, 6, sizeof(cl_int), (void*)&HostChannels);
+    CheckError(GPUError);
+    if( GPUError != CL_SUCCESS ) return false;
+
+    cl_event kernelEvent;
+    GPUError = clEnqueueNDRangeKernel(GPUCommandQueue, kernel, 2, NULL, GPUGlobalWorkSize, NULL, 0, NULL, &kernelEvent);
+    CheckError(GPUError);
+    if( GPUError != CL_SUCCESS ) return false;
+
+    if( event )
+    {
+        clRetainEvent(kernelEvent);
+        *event = kernelEvent;
+    }
+    if( Profiler ) Profiler->Record(name, kernelEvent);
+    else clReleaseEvent(kernelEvent);
+    return true;
+}
+
+cl_event GPUTransferManager::SendConverted( IplImage* imageToLoad )
+{
+    BatchSize = 1;
+    image = imageToLoad;
+
+    // Interleaved rows are uploaded as they are, only bytes of host image cross the bus
+    SetDeviceLayout(LAYOUT_INTERLEAVED);
+    SetImageSize(imageToLoad->width, imageToLoad->height);
+    if( !PrepareLayout() ) return NULL;
+    unsigned int uiPackedPitch = ImagePitch;
+
+    int slot = (Upload == UPLOAD_PINNED) ? AcquireStaging() : -1;
+    if( slot < 0 || !UploadStaging(imageToLoad, slot, cmPackedBuf) )
+    {
+        WriteRows(cmPackedBuf, 0, imageToLoad, 0, ImageHeight, CL_TRUE, "SendImage");
+    }
+
+    // Device layout is made on the device, planes are processed like images of a batch
+    bool bPlanar = (Layout == LAYOUT_PLANAR);
+    SetDeviceLayout(Layout);
+    if( bPlanar ) BatchSize = HostChannels;
+    cl_event event = NULL;
+    if( !ReserveDeviceBuffers(szBuffBytes * BatchSize) || !RunLayoutKernel(bPlanar ? ckSplit : ckExpand, cmPackedBuf, cmDevBuf, uiPackedPitch, bPlanar ? "ckSplitPlanes" : "ckExpandRGBA", &event) )
+    {
+        BatchSize = 1;
+        SetDeviceLayout(LAYOUT_INTERLEAVED);
+        return NULL;
+    }
+    clFlush(GPUCommandQueue);
+    return event;
+}
+
+bool GPUTransferManager::PackImage(cl_mem dest)
+{
+    ChannelLayout layout = DeviceLayout;
+    unsigned int uiDevicePitch = ImagePitch;
+    SetDeviceLayout(LAYOUT_INTERLEAVED);
+
+    bool bPlanar = (layout == LAYOUT_PLANAR);
+    if( !PrepareLayout() || !RunLayoutKernel(bPlanar ? ckMerge : ckPack, cmDevBuf, dest, uiDevicePitch, bPlanar ? "ckMergePlanes" : "ckPackRGB", NULL) )
+    {
+        SetDeviceLayout(layout);
+        return false;
+    }
+    return true;
+}
+
+bool GPUTransferManager::Interleave()
+{
+    if( HostMode || DeviceLayout != LAYOUT_PLANAR ) return true;
+
+    // Interleaved image isn't bigger than its planes, output buffer holds it
+    if( !PackImage(cmDevBufOut) ) return false;
+    BatchSize = 1;
+    SwapBuffers();
+    return true;
+}
+
+bool GPUTransferManager::UploadStaging( IplImage* imageToLoad, int slot, cl_mem buffer )
+{
+    // Copy runs while previous transfers and kernels are still in the queue, DMA reads pinned memory
+    if( StagingHost[slot] != imageToLoad->imageData ) CopyRows(StagingHost[slot], ImagePitch, imageToLoad->imageData, imageToLoad->widthStep, ImageHeight);
+    GPUError = clEnqueueWriteBuffer(GPUCommandQueue, buffer, CL_FALSE, 0, szBuffBytes, (void*)StagingHost[slot], 0, NULL, &StagingEvent[slot]);
+    CheckError(GPUError);
+    if( GPUError != CL_SUCCESS )
+    {
+        StagingEvent[slot] = NULL;
+        return false;
+    }
+    if( Profiler )
+    {
+        clRetainEvent(StagingEvent[slot]);
+        Profiler->Record("SendImage", StagingEvent[slot]);
+    }
+    clFlush(GPUCommandQueue);
+    return true;
+}
+
+TransferHandle* GPUTransferManager::BeginSendImage( IplImage* imageToLoad )
+{
+    if( ConvertsLayout() )
+    {
+        // Conversion kernel follows the upload in the queue, its event completes the handle
+        cl_event event = SendConverted(imageToLoad);
+        if( event ) return new TransferHandle(event, NULL);
+    }
+
+    SetDeviceLayout(LAYOUT_INTERLEAVED);
+    SetImageSize(imageToLoad->width, imageToLoad->height);
+    BatchSize = 1;
+    image = imageToLoad;
+    if( !ReserveDeviceBuffers(szBuffBytes) ) return new TransferHandle(NULL, NULL);
+
+    int slot = HostMode ? -1 : AcquireStaging();
+    if( slot >= 0 && UploadStaging(imageToLoad, slot, cmDevBuf) )
+    {
+        // Staging buffer and handle hold one reference each
+        clRetainEvent(StagingEvent[slot]);
+        return new TransferHandle(StagingEvent[slot], NULL);
+    }
+
+    // Host mode or image bigger than staging buffers, transfer is finished on return
+    SendImage(imageToLoad);
+    return new TransferHandle(NULL, NULL);
+}
+
+TransferHandle* GPUTransferManager::BeginReceiveImage()
+{
+    SetImageSize(ImageWidth, ImageHeight);
+    ChannelLayout deviceLayout = DeviceLayout;
+    cl_mem source = cmDevBuf;
+    if( deviceLayout != LAYOUT_INTERLEAVED )
+    {
+        if( !PackImage(cmPackedBuf) ) return new TransferHandle(NULL, NULL);
+        source = cmPackedBuf;
+    }
+
+    int slot = HostMode ? -1 : AcquireStaging();
+    if( slot < 0 )
+    {
+        if( source != cmDevBuf ) SetDeviceLayout(deviceLayout);
+
+        // Image of blocking read is overwritten by next receive, handle gets its own copy
+        IplImage* received = ReceiveImage();
+        return new TransferHandle(NULL, received ? cvCloneImage(received) : NULL, NULL, -1, true);
+    }
+
+    IplImage* result = StagingImage[slot];
+    result->width = ImageWidth;
+    result->height = ImageHeight;
+    cvSetData(result, StagingHost[slot], ImagePitch);
+
+    cl_event event;
+    GPUError = clEnqueueReadBuffer(GPUCommandQueue, source, CL_FALSE, 0, szBuffBytes, (void*)StagingHost[slot], 0, NULL, &event);
+    CheckError(GPUError);
+    if( source != cmDevBuf ) SetDeviceLayout(deviceLayout);
+    if( GPUError != CL_SUCCESS ) return new TransferHandle(NULL, NULL);
+
+    // Staging buffer isn't reused until the read is done
+    StagingEvent[slot] = event;
+    clRetainEvent(event);
+    if( Profiler )
+    {
+        clRetainEvent(event);
+        Profiler->Record("ReceiveImage", event);
+    }
+    clFlush(GPUCommandQueue);
+
+    // Handle holds the buffer until consumer releases it
+    HoldStaging(slot);
+    return new TransferHandle(event, result, this, slot);
+}
+
+int GPUTransferManager::AcquireStaging()
+{
+    if( szBuffBytes > szStagingBytes || StagingHost[0] == NULL ) return -1;
+
+    int slot = iStagingSlot;
+    iStagingSlot = (iStagingSlot + 1) % STAGING_BUFFERS;
+
+    // Buffer is reused after STAGING_BUFFERS transfers, the oldest one is normally done by then
+    if( StagingEvent[slot] )
+    {
+        clWaitForEvents(1, &StagingEvent[slot]);
+        clReleaseEvent(StagingEvent[slot]);
+        StagingEvent[slot] = NULL;
+    }
+
+    // Image of the buffer may still be read by consumer of BeginReceiveImage()
+    MutexLock(StagingLock);
+    while( StagingHolds[slot] > 0 ) CondWait(StagingReleased, StagingLock);
+    MutexUnlock(StagingLock);
+    return slot;
+}
+
 IplImage* GPUTransferManager::ReceiveImage()
 {
 
-	szBuffBytes = ImageWidth * ImageHeight * nChannels * sizeof (char);
-    GPUError = clEnqueueReadBuffer(GPUCommandQueue, cmDevBuf, CL_TRUE, 0, szBuffBytes, (void*)GPUInputOutput, 0, NULL, NULL);
+	SetImageSize(ImageWidth, ImageHeight);
+    if( HostMode )
+    {
+        memcpy(GPUInputOutput, HostBuf, szBuffBytes);
+        image->imageData = (char*)GPUInputOutput;
+        image->widthStep = ImagePitch;
+        image->imageSize = (int)szBuffBytes;
+        return image;
+    }
+
+    // Image is interleaved on the device, only bytes of host image are read
+    ChannelLayout deviceLayout = DeviceLayout;
+    cl_mem source = cmDevBuf;
+    if( deviceLayout != LAYOUT_INTERLEAVED )
+    {
+        if( !PackImage(cmPackedBuf) ) return NULL;
+        source = cmPackedBuf;
+    }
+
+    // Image bigger than staging buffers is read to pageable buffer, it grows with the image
+    int slot = AcquireStaging();
+    char* ptr = (slot >= 0) ? StagingHost[slot] : ReadHost;
+    if( slot < 0 && szBuffBytes > szReadBytes )
+    {
+        free(ReadHost);
+        ReadHost = ptr = (char*)malloc(szBuffBytes);
+        szReadBytes = ReadHost ? szBuffBytes : 0;
+    }
+    if( ptr == NULL )
+    {
+        CheckError(CL_OUT_OF_HOST_MEMORY);
+        if( source != cmDevBuf ) SetDeviceLayout(deviceLayout);
+        return NULL;
+    }
+
+    cl_event event;
+    GPUError = clEnqueueReadBuffer(GPUCommandQueue, source, CL_TRUE, 0, szBuffBytes, (void*)ptr, 0, NULL, Profiler ? &event : NULL);
     CheckError(GPUError);
+    if( Profiler && GPUError == CL_SUCCESS ) Profiler->Record("ReceiveImage", event);
     
-    image->imageData = (char*)GPUInputOutput;
+    // Returned image keeps padding of device rows
+    image->imageData = ptr;
+    image->widthStep = ImagePitch;
+    image->imageSize = (int)szBuffBytes;
+    if( source != cmDevBuf ) SetDeviceLayout(deviceLayout);
     return image;
 }
 
-void GPUTransferManager::SendImage( IplImage* imageToLoad )
+bool GPUTransferManager::SendImage( IplImage* imageToLoad )
 {
+    if( ConvertsLayout() )
+    {
+        cl_event event = SendConverted(imageToLoad);
+        if( event )
+        {
+            clReleaseEvent(event);
+            return true;
+        }
+    }
 
-	ImageHeight = imageToLoad->height;
-    ImageWidth = imageToLoad->width;
-	 szBuffBytes = ImageWidth * ImageHeight * nChannels * sizeof (char);
+    SetDeviceLayout(LAYOUT_INTERLEAVED);
+	SetImageSize(imageToLoad->width, imageToLoad->height);
+    BatchSize = 1;
 	image = imageToLoad;
 
-    GPUError = clEnqueueWriteBuffer(GPUCommandQueue, cmDevBuf, CL_TRUE, 0, szBuffBytes, (void*)imageToLoad->imageData, 0, NULL, NULL);
+    // Padded rows of wider image don't fit buffers of the constructor, they grow with the image
+    if( !ReserveDeviceBuffers(szBuffBytes) ) return false;
+
+    if( HostMode )
+    {
+        CopyRows((char*)HostBuf, ImagePitch, imageToLoad->imageData, imageToLoad->widthStep, ImageHeight);
+        return true;
+    }
+
+    cl_event event;
+    if( Upload == UPLOAD_MAPPED )
+    {
+        // Device buffer is written in place, on CPU and integrated devices nothing else is copied
+        void* ptr = clEnqueueMapBuffer(GPUCommandQueue, cmDevBuf, CL_TRUE, CL_MAP_WRITE, 0, szBuffBytes, 0, NULL, NULL, &GPUError);
+        CheckError(GPUError);
+        if( GPUError == CL_SUCCESS )
+        {
+            CopyRows((char*)ptr, ImagePitch, imageToLoad->imageData, imageToLoad->widthStep, ImageHeight);
+            GPUError = clEnqueueUnmapMemObject(GPUCommandQueue, cmDevBuf, ptr, 0, NULL, Profiler ? &event : NULL);
+            CheckError(GPUError);
+            if( Profiler && GPUError == CL_SUCCESS ) Profiler->Record("SendImageMapped", event);
+            return true;
+        }
+    }
+
+    int slot = (Upload == UPLOAD_PINNED) ? AcquireStaging() : -1;
+    if( slot >= 0 && UploadStaging(imageToLoad, slot, cmDevBuf) ) return true;
+
+    WriteRows(cmDevBuf, 0, imageToLoad, 0, ImageHeight, CL_TRUE, "SendImage");
+    return true;
+}
+
+void GPUTransferManager::SendRows( IplImage* imageToLoad, int firstRow, int rows )
+{
+    SetDeviceLayout(LAYOUT_INTERLEAVED);
+    SetImageSize(imageToLoad->width, rows);
+    BatchSize = 1;
+    WriteRows(cmDevBuf, 0, imageToLoad, firstRow, rows, CL_FALSE, "SendRows");
+}
+
+void GPUTransferManager::ReceiveRows( IplImage* imageToStore, int firstRow, int rows, int deviceRow )
+{
+    ReadRows(cmDevBuf, deviceRow * ImagePitch, imageToStore, firstRow, rows, CL_FALSE, "ReceiveRows");
+}
+
+bool GPUTransferManager::SendBatch( IplImage** images, int count )
+{
+    // Kernels address all images with pitch and height of the first one
+    for( int i = 0 ; i < count ; ++i )
+    {
+        if( images[i]->width != images[0]->width || images[i]->height != images[0]->height || images[i]->nChannels != HostChannels ) return false;
+    }
+
+    BindFrame(-1);
+
+    SetDeviceLayout(LAYOUT_INTERLEAVED);
+    SetImageSize(images[0]->width, images[0]->height);
+    BatchSize = 1;
+    if( !ReserveDeviceBuffers(szBuffBytes * count) ) return false;
+    BatchSize = count;
+
+    // Images are written without waiting, queue is finished once after all writes
+    for( int i = 0 ; i < count ; ++i )
+    {
+        WriteRows(cmDevBuf, i * szBuffBytes, images[i], 0, ImageHeight, CL_FALSE, "SendBatch");
+    }
+    clFinish(GPUCommandQueue);
+    return true;
+}
+
+void GPUTransferManager::ReceiveBatch( IplImage** images, int count )
+{
+    for( int i = 0 ; i < count && i < BatchSize ; ++i )
+    {
+        ReadRows(cmDevBuf, i * szBuffBytes, images[i], 0, ImageHeight, CL_FALSE, "ReceiveBatch");
+    }
+    clFinish(GPUCommandQueue);
+}
+
+ScratchBuffer* GPUTransferManager::Scratch(int owner, int index, size_t bytes)
+{
+    if( HostMode ) return NULL;
+
+    // Inserted entry is zeroed
+    ScratchBuffer& scratch = ScratchBuffers[make_pair(owner, index)];
+    if( scratch.Buffer && scratch.Bytes >= bytes ) return &scratch;
+
+    if( scratch.Buffer ) clReleaseMemObject(scratch.Buffer);
+    scratch.Buffer = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE, bytes, NULL, &GPUError);
+    CheckError(GPUError);
+    scratch.Bytes = scratch.Buffer ? bytes : 0;
+    scratch.Stamp = 0;
+    return scratch.Buffer ? &scratch : NULL;
+}
+
+int GPUTransferManager::NewScratchOwner()
+{
+    return ++iScratchOwners;
+}
+
+void GPUTransferManager::SwapBuffers()
+{
+    cl_mem tmp = cmDevBuf;
+    cmDevBuf = cmDevBufOut;
+    cmDevBufOut = tmp;
+
+    unsigned char* tmpHost = HostBuf;
+    HostBuf = HostBufOut;
+    HostBufOut = tmpHost;
+}
+
+void GPUTransferManager::AllocateFrames(int frames)
+{
+    ReleaseFrames();
+
+    nFrames = frames;
+    SetDeviceLayout(LAYOUT_INTERLEAVED);
+    cmFrameBuf.resize(2 * nFrames);
+    cmFramePinnedIn.resize(nFrames);
+    cmFramePinnedOut.resize(nFrames);
+    FrameHostIn.resize(nFrames);
+    FrameHostOut.resize(nFrames);
+    FrameImage.resize(nFrames);
+
+    for( int i = 0 ; i < nFrames ; ++i )
+    {
+        cmFrameBuf[2*i] = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE, szBuffBytes, NULL, &GPUError);
+        CheckError(GPUError);
+        cmFrameBuf[2*i+1] = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE, szBuffBytes, NULL, &GPUError);
+        CheckError(GPUError);
+
+        // Separate pinned buffers for both directions, upload of the next frame don't overwrite returned image
+        cmFramePinnedIn[i] = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, szBuffBytes, NULL, &GPUError);
+        CheckError(GPUError);
+        FrameHostIn[i] = (char*)clEnqueueMapBuffer(GPUCommandQueue, cmFramePinnedIn[i], CL_TRUE, CL_MAP_WRITE, 0, szBuffBytes, 0, NULL, NULL, &GPUError);
+        CheckError(GPUError);
+
+        cmFramePinnedOut[i] = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, szBuffBytes, NULL, &GPUError);
+        CheckError(GPUError);
+        FrameHostOut[i] = (char*)clEnqueueMapBuffer(GPUCommandQueue, cmFramePinnedOut[i], CL_TRUE, CL_MAP_READ, 0, szBuffBytes, 0, NULL, NULL, &GPUError);
+        CheckError(GPUError);
+
+        FrameImage[i] = cvCreateImageHeader(cvSize(ImageWidth, ImageHeight), IPL_DEPTH_8U, nChannels);
+        cvSetData(FrameImage[i], FrameHostOut[i], ImagePitch);
+    }
+}
+
+void GPUTransferManager::ReleaseFrames()
+{
+    BindFrame(-1);
+
+    for( int i = 0 ; i < nFrames ; ++i )
+    {
+        clEnqueueUnmapMemObject(GPUCommandQueue, cmFramePinnedIn[i], FrameHostIn[i], 0, NULL, NULL);
+        clEnqueueUnmapMemObject(GPUCommandQueue, cmFramePinnedOut[i], FrameHostOut[i], 0, NULL, NULL);
+    }
+    if( nFrames > 0 ) clFinish(GPUCommandQueue);
+
+    for( int i = 0 ; i < nFrames ; ++i )
+    {
+        if(cmFrameBuf[2*i])clReleaseMemObject(cmFrameBuf[2*i]);
+        if(cmFrameBuf[2*i+1])clReleaseMemObject(cmFrameBuf[2*i+1]);
+        if(cmFramePinnedIn[i])clReleaseMemObject(cmFramePinnedIn[i]);
+        if(cmFramePinnedOut[i])clReleaseMemObject(cmFramePinnedOut[i]);
+        cvReleaseImageHeader(&FrameImage[i]);
+    }
+
+    cmFrameBuf.clear();
+    cmFramePinnedIn.clear();
+    cmFramePinnedOut.clear();
+    FrameHostIn.clear();
+    FrameHostOut.clear();
+    FrameImage.clear();
+    nFrames = 0;
+}
+
+void GPUTransferManager::BindFrame(int frame)
+{
+    if( frame == iBoundFrame ) return;
+
+    // Store current pair, swaps done by filters change which buffer is input
+    if( iBoundFrame < 0 )
+    {
+        cmDefaultBuf[0] = cmDevBuf;
+        cmDefaultBuf[1] = cmDevBufOut;
+    }
+    else
+    {
+        cmFrameBuf[2*iBoundFrame] = cmDevBuf;
+        cmFrameBuf[2*iBoundFrame+1] = cmDevBufOut;
+    }
+
+    if( frame < 0 )
+    {
+        cmDevBuf = cmDefaultBuf[0];
+        cmDevBufOut = cmDefaultBuf[1];
+    }
+    else
+    {
+        cmDevBuf = cmFrameBuf[2*frame];
+        cmDevBufOut = cmFrameBuf[2*frame+1];
+    }
+    iBoundFrame = frame;
+}
+
+void GPUTransferManager::SendImageAsync( IplImage* imageToLoad, cl_command_queue queue, cl_event* event )
+{
+    BatchSize = 1;
+    SetDeviceLayout(LAYOUT_INTERLEAVED);
+
+    // Caller can reuse its image as soon as this call returns
+    CopyRows(FrameHostIn[iBoundFrame], ImagePitch, imageToLoad->imageData, imageToLoad->widthStep, ImageHeight);
+
+    GPUError = clEnqueueWriteBuffer(queue, cmDevBuf, CL_FALSE, 0, szBuffBytes, (void*)FrameHostIn[iBoundFrame], 0, NULL, event);
+    CheckError(GPUError);
+    if( Profiler && event && GPUError == CL_SUCCESS )
+    {
+        clRetainEvent(*event);
+        Profiler->Record("SendImageAsync", *event);
+    }
+}
+
+IplImage* GPUTransferManager::ReceiveImageAsync( cl_command_queue queue, cl_uint numWait, const cl_event* waitList, cl_event* event )
+{
+    GPUError = clEnqueueReadBuffer(queue, cmDevBuf, CL_FALSE, 0, szBuffBytes, (void*)FrameHostOut[iBoundFrame], numWait, waitList, event);
+    CheckError(GPUError);
+    if( Profiler && event && GPUError == CL_SUCCESS )
+    {
+        clRetainEvent(*event);
+        Profiler->Record("ReceiveImageAsync", *event);
+    }
+
+    return FrameImage[iBoundFrame];
+}
+
+IplImage* GPUTransferManager::GetFrameImage(int frame)
+{
+    return FrameImage[frame];
+}
+
+void GPUTransferManager::InitZeroCopy()
+{
+    cmWrapBuf = NULL;
+    cmZeroCopyBuf = NULL;
+    ZeroCopyHost = NULL;
+    ZeroCopyImage = NULL;
+    cmMappedBuf = NULL;
+    MappedImage = NULL;
+    cmZeroCopySaved[0] = cmZeroCopySaved[1] = NULL;
+    bZeroCopyBound = false;
+    uiHostAlign = 0;
+}
+
+void GPUTransferManager::InitStagingHolds()
+{
+    for( int i = 0 ; i < STAGING_BUFFERS ; ++i ) StagingHolds[i] = 0;
+    MutexInit(StagingLock);
+    CondInit(StagingReleased);
+}
+
+void GPUTransferManager::HoldStaging(int slot)
+{
+    MutexLock(StagingLock);
+    StagingHolds[slot]++;
+    MutexUnlock(StagingLock);
+}
+
+void GPUTransferManager::ReleaseStaging(int slot)
+{
+    MutexLock(StagingLock);
+    StagingHolds[slot]--;
+    CondBroadcast(StagingReleased);
+    MutexUnlock(StagingLock);
+}
+
+void GPUTransferManager::BindZeroCopy(cl_mem buffer)
+{
+    if( !bZeroCopyBound )
+    {
+        cmZeroCopySaved[0] = cmDevBuf;
+        cmZeroCopySaved[1] = cmDevBufOut;
+        bZeroCopyBound = true;
+    }
+    cmDevBuf = buffer;
+    cmDevBufOut = cmZeroCopySaved[1];
+}
+
+bool GPUTransferManager::WrapImage( IplImage* imageToWrap )
+{
+    if( HostMode ) return false;
+
+    if( uiHostAlign == 0 )
+    {
+        // Device reports alignment in bits
+        cl_uint uiAlignBits = 0;
+        clGetDeviceInfo(GPUDevice, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(cl_uint), &uiAlignBits, NULL);
+        uiHostAlign = max(uiAlignBits / 8, (cl_uint)1);
+    }
+
+    // Buffer is used by kernels as it is, rows must have device layout
+    SetDeviceLayout(LAYOUT_INTERLEAVED);
+    if( imageToWrap->nChannels != nChannels || imageToWrap->widthStep != (int)RowPitch(imageToWrap->width) ) return false;
+    if( ((size_t)imageToWrap->imageData) % uiHostAlign != 0 ) return false;
+
+    UnmapImage();
+
+    SetImageSize(imageToWrap->width, imageToWrap->height);
+    BatchSize = 1;
+    image = imageToWrap;
+
+    // Output buffer stays a device buffer, it must hold the wrapped image
+    if( !ReserveDeviceBuffers(szBuffBytes) ) return false;
+
+    cmWrapBuf = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, szBuffBytes, imageToWrap->imageData, &GPUError);
     CheckError(GPUError);
+    if( GPUError != CL_SUCCESS )
+    {
+        cmWrapBuf = NULL;
+        return false;
+    }
+    BindZeroCopy(cmWrapBuf);
+    return true;
 }
 
+IplImage* GPUTransferManager::AcquireHostImage()
+{
+    if( ZeroCopyImage == NULL ) ZeroCopyImage = cvCreateImageHeader(cvSize(ImageWidth, ImageHeight), IPL_DEPTH_8U, HostChannels);
+    ZeroCopyImage->width = ImageWidth;
+    ZeroCopyImage->height = ImageHeight;
+
+    // Host filters read host buffer directly
+    if( HostMode )
+    {
+        cvSetData(ZeroCopyImage, HostBuf, ImagePitch);
+        return ZeroCopyImage;
+    }
+
+    UnmapImage();
+    SetDeviceLayout(LAYOUT_INTERLEAVED);
+    if( !ReserveDeviceBuffers(szBuffBytes) ) return NULL;
+
+    // Image size changed since the buffer was created
+    size_t szZeroCopyBytes = 0;
+    if( cmZeroCopyBuf ) clGetMemObjectInfo(cmZeroCopyBuf, CL_MEM_SIZE, sizeof(size_t), &szZeroCopyBytes, NULL);
+    if( cmZeroCopyBuf && szZeroCopyBytes < szBuffBytes )
+    {
+        if( ZeroCopyHost ) clEnqueueUnmapMemObject(GPUCommandQueue, cmZeroCopyBuf, ZeroCopyHost, 0, NULL, NULL);
+        clFinish(GPUCommandQueue);
+        clReleaseMemObject(cmZeroCopyBuf);
+        cmZeroCopyBuf = NULL;
+        ZeroCopyHost = NULL;
+    }
+
+    if( cmZeroCopyBuf == NULL )
+    {
+        cmZeroCopyBuf = clCreateBuffer(GPUContext, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, szBuffBytes, NULL, &GPUError);
+        CheckError(GPUError);
+    }
+    if( ZeroCopyHost == NULL )
+    {
+        ZeroCopyHost = (char*)clEnqueueMapBuffer(GPUCommandQueue, cmZeroCopyBuf, CL_TRUE, CL_MAP_WRITE, 0, szBuffBytes, 0, NULL, NULL, &GPUError);
+        CheckError(GPUError);
+    }
+    cvSetData(ZeroCopyImage, ZeroCopyHost, ImagePitch);
+    return ZeroCopyImage;
+}
+
+void GPUTransferManager::SubmitHostImage()
+{
+    BatchSize = 1;
+    image = ZeroCopyImage;
+    if( HostMode || ZeroCopyHost == NULL ) return;
+
+    cl_event event;
+    GPUError = clEnqueueUnmapMemObject(GPUCommandQueue, cmZeroCopyBuf, ZeroCopyHost, 0, NULL, Profiler ? &event : NULL);
+    CheckError(GPUError);
+    if( Profiler && GPUError == CL_SUCCESS ) Profiler->Record("SubmitHostImage", event);
+    ZeroCopyHost = NULL;
+    BindZeroCopy(cmZeroCopyBuf);
+}
+
+IplImage* GPUTransferManager::MapImage()
+{
+    if( MappedImage == NULL ) MappedImage = cvCreateImageHeader(cvSize(ImageWidth, ImageHeight), IPL_DEPTH_8U, HostChannels);
+    MappedImage->width = ImageWidth;
+    MappedImage->height = ImageHeight;
+
+    if( HostMode )
+    {
+        cvSetData(MappedImage, HostBuf, ImagePitch);
+        return MappedImage;
+    }
+
+    // Previous mapping only, result of filters stays bound
+    if( cmMappedBuf )
+    {
+        clEnqueueUnmapMemObject(GPUCommandQueue, cmMappedBuf, MappedImage->imageData, 0, NULL, NULL);
+        cmMappedBuf = NULL;
+    }
+    SetImageSize(ImageWidth, ImageHeight);
+
+    // Expanded or planar image is interleaved first, mapped image has channels of host images
+    ChannelLayout deviceLayout = DeviceLayout;
+    cl_mem source = cmDevBuf;
+    if( deviceLayout != LAYOUT_INTERLEAVED )
+    {
+        if( !PackImage(cmPackedBuf) ) return NULL;
+        source = cmPackedBuf;
+    }
+
+    // On CPU and integrated devices map returns pointer to the buffer itself, nothing is copied
+    cl_event event;
+    void* ptr = clEnqueueMapBuffer(GPUCommandQueue, source, CL_TRUE, CL_MAP_READ, 0, szBuffBytes, 0, NULL, Profiler ? &event : NULL, &GPUError);
+    CheckError(GPUError);
+    unsigned int uiMappedPitch = ImagePitch;
+    if( source != cmDevBuf ) SetDeviceLayout(deviceLayout);
+    if( GPUError != CL_SUCCESS ) return NULL;
+    if( Profiler ) Profiler->Record("MapImage", event);
+
+    cmMappedBuf = source;
+    cvSetData(MappedImage, ptr, uiMappedPitch);
+    return MappedImage;
+}
+
+void GPUTransferManager::UnmapImage()
+{
+    if( HostMode ) return;
+
+    if( cmMappedBuf )
+    {
+        GPUError = clEnqueueUnmapMemObject(GPUCommandQueue, cmMappedBuf, MappedImage->imageData, 0, NULL, NULL);
+        CheckError(GPUError);
+        cmMappedBuf = NULL;
+    }
+
+    if( bZeroCopyBound )
+    {
+        // Kernels using wrapped image must finish before it is released
+        clFinish(GPUCommandQueue);
+        cmDevBuf = cmZeroCopySaved[0];
+        cmDevBufOut = cmZeroCopySaved[1];
+        bZeroCopyBound = false;
+    }
+
+    if( cmWrapBuf )
+    {
+        clReleaseMemObject(cmWrapBuf);
+        cmWrapBuf = NULL;
+    }
+}
@@ -6,6 +6,7 @@
  */
 
 #include "HighpassFilter.h"
+#include "HostFilters.h"
 
 
 HighpassFilter::~HighpassFilter(void)
@@ -16,39 +17,39 @@ HighpassFilter::~HighpassFilter(void)
 
 HighpassFilter::HighpassFilter(char* source, cl_context GPUContext ,GPUTransferManager* transfer,char* KernelName): NonLinearFilter(source,GPUContext,transfer,KernelName)
 {
+	ImageKernelName = "ckGradientImage";
 	
 }
 
 bool HighpassFilter::filter(cl_command_queue GPUCommandQueue)
 {
+    if( UseImage() ) return filterImage(GPUCommandQueue);
 
     int iLocalPixPitch = iBlockDimX + 2;
     GPUError = clSetKernelArg(GPUFilter, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
-	GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&cmDevBufMaskV);
-	GPUError |= clSetKernelArg(GPUFilter, 2, sizeof(cl_mem), (void*)&cmDevBufMaskH);
-    GPUError |= clSetKernelArg(GPUFilter, 3, (iLocalPixPitch * (iBlockDimY + 2) * GPUTransfer->nChannels * sizeof(cl_uchar)), NULL);
-	GPUError |= clSetKernelArg(GPUFilter, 4, ( 9 * sizeof(int)), NULL);
+    GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+	GPUError |= clSetKernelArg(GPUFilter, 2, sizeof(cl_mem), (void*)&cmDevBufMaskV);
+	GPUError |= clSetKernelArg(GPUFilter, 3, sizeof(cl_mem), (void*)&cmDevBufMaskH);
+    GPUError |= clSetKernelArg(GPUFilter, 4, (iLocalPixPitch * (iBlockDimY + 2) * GPUTransfer->nChannels * sizeof(cl_uchar)), NULL);
 	GPUError |= clSetKernelArg(GPUFilter, 5, ( 9 * sizeof(int)), NULL);
-    GPUError |= clSetKernelArg(GPUFilter, 6, sizeof(cl_int), (void*)&iLocalPixPitch);
-    GPUError |= clSetKernelArg(GPUFilter, 7, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
-    GPUError |= clSetKernelArg(GPUFilter, 8, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
-	GPUError |= clSetKernelArg(GPUFilter, 9, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUFilter, 6, ( 9 * sizeof(int)), NULL);
+    GPUError |= clSetKernelArg(GPUFilter, 7, sizeof(cl_int), (void*)&iLocalPixPitch);
+    GPUError |= clSetKernelArg(GPUFilter, 8, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+    GPUError |= clSetKernelArg(GPUFilter, 9, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUFilter, 10, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUFilter, 11, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
     if(GPUError) return false;
 
-	size_t GPULocalWorkSize[2]; 
-    GPULocalWorkSize[0] = iBlockDimX;
-    GPULocalWorkSize[1] = iBlockDimY;
-    GPUGlobalWorkSize[0] = shrRoundUp((int)GPULocalWorkSize[0], GPUTransfer->ImageWidth); 
-
-    GPUGlobalWorkSize[1] = shrRoundUp((int)GPULocalWorkSize[1], (int)GPUTransfer->ImageHeight);
-
-    if(clEnqueueNDRangeKernel( GPUCommandQueue, GPUFilter, 2, NULL, GPUGlobalWorkSize, GPULocalWorkSize, 0, NULL, NULL)) return false;
-	return true;
+    return EnqueueKernel(GPUCommandQueue);
 }
 
 
 void HighpassFilter::LoadMask(cl_mem* cmDevBufMask,int* mask,int count,GPUTransferManager* transfer)
 {
+	*cmDevBufMask = NULL;
+	// Host mode, filterHost() reads the mask directly
+	if( transfer->GPUContext == NULL ) return;
+
 	// Create the device buffers in GMEM on each device, for now we have one device :)
     *cmDevBufMask = clCreateBuffer(transfer->GPUContext, CL_MEM_READ_WRITE, count * sizeof (unsigned int), NULL, &GPUError);
     CheckError(GPUError);
@@ -56,3 +57,16 @@ void HighpassFilter::LoadMask(cl_mem* cmDevBufMask,int* mask,int count,GPUTransf
     GPUError = clEnqueueWriteBuffer(transfer->GPUCommandQueue, *cmDevBufMask, CL_TRUE, 0, count * sizeof (unsigned int), (void*)mask, 0, NULL, NULL);
     CheckError(GPUError);
 }
+
+bool HighpassFilter::SetImageArgs(cl_uint first)
+{
+	GPUError = clSetKernelArg(GPUImageFilter, first, sizeof(cl_mem), (void*)&cmDevBufMaskV);
+	GPUError |= clSetKernelArg(GPUImageFilter, first + 1, sizeof(cl_mem), (void*)&cmDevBufMaskH);
+	return GPUError == CL_SUCCESS;
+}
+
+bool HighpassFilter::filterHost()
+{
+	HostGradient(GPUTransfer->HostBuf, GPUTransfer->HostBufOut, GPUTransfer->ImageWidth, GPUTransfer->ImageHeight, GPUTransfer->nChannels, maskH, maskV);
+	return true;
+}
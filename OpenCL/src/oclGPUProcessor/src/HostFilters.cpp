@@ -0,0 +1,939 @@
+/*!
+ * \file HostFilters.cpp
+ * \brief Host implementations of filters, results are the same as results of the kernels.
+ */
+
+#include "HostFilters.h"
+#include "TileScheduler.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HOST_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+int HostThreadCount()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	int count = (int)info.dwNumberOfProcessors;
+#else
+	int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return count > 0 ? count : 1;
+}
+
+void HostRun(HostJob* job)
+{
+	TileScheduler::Instance()->Run(job);
+}
+
+// Pixel of the source, zero outside of the image like the LMEM apron of the kernels
+static inline int Pixel(const HostJob* job, int x, int y, int c)
+{
+	if( x < 0 || y < 0 || x >= job->Width || y >= job->Height ) return 0;
+	return job->Source[(y * job->Width + x) * job->nChannels + c];
+}
+
+// 3x3 neighbourhood in kernel order: NW, N, NE, W, C, E, SW, S, SE
+static inline void Window(const HostJob* job, int x, int y, int c, int* v)
+{
+	for( int k = 0 ; k < 9 ; ++k )
+	{
+		v[k] = Pixel(job, x + k % 3 - 1, y + k / 3 - 1, c);
+	}
+}
+
+static inline unsigned char* Output(const HostJob* job, int x, int y)
+{
+	return job->Dest + (y * job->Width + x) * job->nChannels;
+}
+
+// Channels written by filters with radius and separable passes, alpha of packed pixels is left
+static inline int WrittenChannels(const HostJob* job)
+{
+	return min(job->nChannels, 3);
+}
+
+// (2 * Radius + 1)^2 neighbourhood in row-major order
+static inline void RadiusWindow(const HostJob* job, int x, int y, int c, int* v)
+{
+	int r = job->Radius;
+	int k = 0;
+	for( int dy = -r ; dy <= r ; ++dy )
+	{
+		for( int dx = -r ; dx <= r ; ++dx ) v[k++] = Pixel(job, x + dx, y + dy, c);
+	}
+}
+
+// Byte offsets of 3x3 neighbourhood in dense image
+static void Offsets(const HostJob* job, int* off)
+{
+	for( int k = 0 ; k < 9 ; ++k )
+	{
+		off[k] = ((k / 3 - 1) * job->Width + (k % 3 - 1)) * job->nChannels;
+	}
+}
+
+//*****************************************************************
+// Convolution
+//*****************************************************************
+
+// Same arithmetic as ckConv: unsigned products, signed division by mask sum, only upper clamp
+static inline unsigned char ConvValue(unsigned int acc, int sum)
+{
+	int res = (int)acc / sum;
+	if( res > 255 ) res = 255;
+	return (unsigned char)res;
+}
+
+#ifdef HOST_SSE2
+// Interior bytes [b, end) of one row, 8 bytes per step. Return first unprocessed byte.
+static int ConvBytesSSE2(const unsigned char* src, unsigned char* dst, int b, int end, const int* off, const int* mask, int sum, int nChannels)
+{
+	__m128i zero = _mm_setzero_si128();
+
+	// Pairs of mask values for _mm_madd_epi16
+	__m128i m[5];
+	for( int k = 0 ; k < 5 ; ++k )
+	{
+		unsigned int lo = (unsigned int)mask[2*k] & 0xFFFF;
+		unsigned int hi = (2*k+1 < 9) ? ((unsigned int)mask[2*k+1] & 0xFFFF) : 0;
+		m[k] = _mm_set1_epi32((int)(lo | (hi << 16)));
+	}
+
+	int acc[8];
+	for( ; b + 8 <= end ; b += 8 )
+	{
+		__m128i sumLo = zero;
+		__m128i sumHi = zero;
+		for( int k = 0 ; k < 5 ; ++k )
+		{
+			__m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src + b + off[2*k])), zero);
+			__m128i c = (2*k+1 < 9) ? _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src + b + off[2*k+1])), zero) : zero;
+			sumLo = _mm_add_epi32(sumLo, _mm_madd_epi16(_mm_unpacklo_epi16(a, c), m[k]));
+			sumHi = _mm_add_epi32(sumHi, _mm_madd_epi16(_mm_unpackhi_epi16(a, c), m[k]));
+		}
+		_mm_storeu_si128((__m128i*)acc, sumLo);
+		_mm_storeu_si128((__m128i*)(acc + 4), sumHi);
+
+		for( int i = 0 ; i < 8 ; ++i )
+		{
+			// Fourth channel is not written by the kernels
+			if( nChannels == 4 && ((b + i) & 3) == 3 ) continue;
+			dst[b + i] = ConvValue((unsigned int)acc[i], sum);
+		}
+	}
+	return b;
+}
+#endif
+
+static void ConvPixel(const HostJob* job, int x, int y, int sum)
+{
+	unsigned char* out = Output(job, x, y);
+	int v[9];
+	for( int c = 0 ; c < 3 ; ++c )
+	{
+		Window(job, x, y, c, v);
+		unsigned int acc = 0;
+		for( int k = 0 ; k < 9 ; ++k ) acc += (unsigned int)v[k] * (unsigned int)job->MaskA[k];
+		out[c] = ConvValue(acc, sum);
+	}
+}
+
+static void ConvKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	const int* mask = job->MaskA;
+	int sum = 0;
+	bool mask16 = true;
+	for( int k = 0 ; k < 9 ; ++k )
+	{
+		sum += mask[k];
+		if( mask[k] < -32768 || mask[k] > 32767 ) mask16 = false;
+	}
+	// ckConv divides by zero for masks with zero sum, host keeps the sum unscaled
+	if( sum == 0 ) sum = 1;
+
+	int off[9];
+	Offsets(job, off);
+	int ch = job->nChannels;
+
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		int xa = max(x0, 1);
+		int xb = min(x1, job->Width - 1);
+		if( y == 0 || y == job->Height - 1 || xa >= xb )
+		{
+			for( int x = x0 ; x < x1 ; ++x ) ConvPixel(job, x, y, sum);
+			continue;
+		}
+
+		for( int x = x0 ; x < xa ; ++x ) ConvPixel(job, x, y, sum);
+
+		const unsigned char* src = job->Source + y * job->Width * ch;
+		unsigned char* dst = job->Dest + y * job->Width * ch;
+		int b = xa * ch;
+		int end = xb * ch;
+#ifdef HOST_SSE2
+		if( mask16 ) b = ConvBytesSSE2(src, dst, b, end, off, mask, sum, ch);
+#endif
+		for( ; b < end ; ++b )
+		{
+			if( ch == 4 && (b & 3) == 3 ) continue;
+			unsigned int acc = 0;
+			for( int k = 0 ; k < 9 ; ++k ) acc += (unsigned int)src[b + off[k]] * (unsigned int)mask[k];
+			dst[b] = ConvValue(acc, sum);
+		}
+
+		for( int x = xb ; x < x1 ; ++x ) ConvPixel(job, x, y, sum);
+	}
+}
+
+static void ConvRadiusKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int n = (2 * job->Radius + 1) * (2 * job->Radius + 1);
+	int sum = 0;
+	for( int k = 0 ; k < n ; ++k ) sum += job->MaskA[k];
+	if( sum == 0 ) sum = 1;
+
+	int* v = new int[n];
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			unsigned char* out = Output(job, x, y);
+			for( int c = 0 ; c < WrittenChannels(job) ; ++c )
+			{
+				RadiusWindow(job, x, y, c, v);
+				int acc = 0;
+				for( int k = 0 ; k < n ; ++k ) acc += v[k] * job->MaskA[k];
+				out[c] = (unsigned char)min(max(acc / sum, 0), 255);
+			}
+		}
+	}
+	delete [] v;
+}
+
+void HostConv(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, const int* mask, int radius)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.MaskA = mask;
+	job.Kernel = ConvKernel;
+	if( radius > 1 )
+	{
+		job.Kernel = ConvRadiusKernel;
+		job.Radius = radius;
+	}
+	HostRun(&job);
+}
+
+//*****************************************************************
+// Gradient
+//*****************************************************************
+
+static void GradientKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	const int* maskV = job->MaskA;
+	const int* maskH = job->MaskB;
+	int v[9];
+
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			float fHSum[3] = {0.0f, 0.0f, 0.0f};
+			float fVSum[3] = {0.0f, 0.0f, 0.0f};
+			for( int c = 0 ; c < 3 ; ++c )
+			{
+				Window(job, x, y, c, v);
+				for( int k = 0 ; k < 9 ; ++k )
+				{
+					fVSum[c] += (float)v[k] * maskV[k];
+					fHSum[c] += (float)v[k] * maskH[k];
+				}
+			}
+
+			// Weighted combination of Root-Sum-Square per-color-band H & V gradients, order as in ckGradient
+			float fTemp = 0.30f * sqrtf((fHSum[0] * fHSum[0]) + (fVSum[0] * fVSum[0]));
+			fTemp += 0.30f * sqrtf((fHSum[1] * fHSum[1]) + (fVSum[1] * fVSum[1]));
+			fTemp += 0.30f * sqrtf((fHSum[2] * fHSum[2]) + (fVSum[2] * fVSum[2]));
+
+			unsigned char pix = (fTemp < 255.0f) ? (unsigned char)(int)fTemp : 255;
+			unsigned char* out = Output(job, x, y);
+			out[0] = out[1] = out[2] = pix;
+		}
+	}
+}
+
+void HostGradient(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, const int* maskH, const int* maskV)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.MaskA = maskV;
+	job.MaskB = maskH;
+	job.Kernel = GradientKernel;
+	HostRun(&job);
+}
+
+//*****************************************************************
+// Median
+//*****************************************************************
+
+// Exact median like sorting networks and histograms of the kernels. Order of v is changed.
+static inline unsigned char MedianSelect(int* v, int n = 9)
+{
+	nth_element(v, v + n / 2, v + n);
+	return (unsigned char)v[n / 2];
+}
+
+static void MedianKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int v[9];
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			unsigned char* out = Output(job, x, y);
+			for( int c = 0 ; c < 3 ; ++c )
+			{
+				Window(job, x, y, c, v);
+				out[c] = MedianSelect(v);
+			}
+		}
+	}
+}
+
+static void MedianRadiusKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int n = (2 * job->Radius + 1) * (2 * job->Radius + 1);
+	int* v = new int[n];
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			unsigned char* out = Output(job, x, y);
+			for( int c = 0 ; c < WrittenChannels(job) ; ++c )
+			{
+				RadiusWindow(job, x, y, c, v);
+				out[c] = MedianSelect(v, n);
+			}
+		}
+	}
+	delete [] v;
+}
+
+void HostMedian(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.Kernel = MedianKernel;
+	if( radius > 1 )
+	{
+		job.Kernel = MedianRadiusKernel;
+		job.Radius = radius;
+	}
+	HostRun(&job);
+}
+
+//*****************************************************************
+// Minimum and maximum
+//*****************************************************************
+
+#ifdef HOST_SSE2
+// Interior bytes [b, end) of one row, 16 bytes per step. Return first unprocessed byte.
+static int MinMaxBytesSSE2(const unsigned char* src, unsigned char* dst, int b, int end, const int* off, bool isMax, int nChannels)
+{
+	// Fourth channel keeps value of destination
+	__m128i keep = (nChannels == 4) ? _mm_set1_epi32((int)0xFF000000) : _mm_setzero_si128();
+
+	for( ; b + 16 <= end ; b += 16 )
+	{
+		__m128i r = _mm_loadu_si128((const __m128i*)(src + b + off[0]));
+		for( int k = 1 ; k < 9 ; ++k )
+		{
+			__m128i p = _mm_loadu_si128((const __m128i*)(src + b + off[k]));
+			r = isMax ? _mm_max_epu8(r, p) : _mm_min_epu8(r, p);
+		}
+		__m128i old = _mm_loadu_si128((const __m128i*)(dst + b));
+		r = _mm_or_si128(_mm_and_si128(keep, old), _mm_andnot_si128(keep, r));
+		_mm_storeu_si128((__m128i*)(dst + b), r);
+	}
+	return b;
+}
+#endif
+
+static void MinMaxPixel(const HostJob* job, int x, int y, bool isMax)
+{
+	unsigned char* out = Output(job, x, y);
+	int v[9];
+	for( int c = 0 ; c < 3 ; ++c )
+	{
+		Window(job, x, y, c, v);
+		int r = v[0];
+		for( int k = 1 ; k < 9 ; ++k ) r = isMax ? max(r, v[k]) : min(r, v[k]);
+		out[c] = (unsigned char)r;
+	}
+}
+
+static void MinMaxRows(const HostJob* job, int x0, int y0, int x1, int y1, bool isMax)
+{
+	int off[9];
+	Offsets(job, off);
+	int ch = job->nChannels;
+
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		int xa = max(x0, 1);
+		int xb = min(x1, job->Width - 1);
+		if( y == 0 || y == job->Height - 1 || xa >= xb )
+		{
+			for( int x = x0 ; x < x1 ; ++x ) MinMaxPixel(job, x, y, isMax);
+			continue;
+		}
+
+		for( int x = x0 ; x < xa ; ++x ) MinMaxPixel(job, x, y, isMax);
+
+		const unsigned char* src = job->Source + y * job->Width * ch;
+		unsigned char* dst = job->Dest + y * job->Width * ch;
+		int b = xa * ch;
+		int end = xb * ch;
+#ifdef HOST_SSE2
+		b = MinMaxBytesSSE2(src, dst, b, end, off, isMax, ch);
+#endif
+		for( ; b < end ; ++b )
+		{
+			if( ch == 4 && (b & 3) == 3 ) continue;
+			int r = src[b + off[0]];
+			for( int k = 1 ; k < 9 ; ++k ) r = isMax ? max(r, (int)src[b + off[k]]) : min(r, (int)src[b + off[k]]);
+			dst[b] = (unsigned char)r;
+		}
+
+		for( int x = xb ; x < x1 ; ++x ) MinMaxPixel(job, x, y, isMax);
+	}
+}
+
+static void MinKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	MinMaxRows(job, x0, y0, x1, y1, false);
+}
+
+static void MaxKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	MinMaxRows(job, x0, y0, x1, y1, true);
+}
+
+// Window of radius larger than 1, Param is 1 for maximum
+static void MinMaxRadiusKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int n = (2 * job->Radius + 1) * (2 * job->Radius + 1);
+	int* v = new int[n];
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			unsigned char* out = Output(job, x, y);
+			for( int c = 0 ; c < WrittenChannels(job) ; ++c )
+			{
+				RadiusWindow(job, x, y, c, v);
+				int res = v[0];
+				for( int k = 1 ; k < n ; ++k ) res = job->Param ? max(res, v[k]) : min(res, v[k]);
+				out[c] = (unsigned char)res;
+			}
+		}
+	}
+	delete [] v;
+}
+
+void HostMin(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.Kernel = MinKernel;
+	if( radius > 1 )
+	{
+		job.Kernel = MinMaxRadiusKernel;
+		job.Radius = radius;
+	}
+	HostRun(&job);
+}
+
+void HostMax(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.Kernel = MaxKernel;
+	if( radius > 1 )
+	{
+		job.Kernel = MinMaxRadiusKernel;
+		job.Radius = radius;
+		job.Param = 1;
+	}
+	HostRun(&job);
+}
+
+//*****************************************************************
+// Binary morphology
+//*****************************************************************
+
+// ckErode tests channel 0 of 8 neighbours for 0, ckDilate tests channel 1 for 255. Centre is skipped.
+static void MorphologyKernel(const HostJob* job, int x0, int y0, int x1, int y1, bool isDilate)
+{
+	int c = isDilate ? 1 : 0;
+	int target = isDilate ? 255 : 0;
+	int v[9];
+
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			Window(job, x, y, c, v);
+			bool found = false;
+			for( int k = 0 ; k < 9 && !found ; ++k )
+			{
+				if( k != 4 && v[k] == target ) found = true;
+			}
+
+			unsigned char pix = (found == isDilate) ? 255 : 0;
+			unsigned char* out = Output(job, x, y);
+			out[0] = out[1] = out[2] = pix;
+		}
+	}
+}
+
+static void ErodeKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	MorphologyKernel(job, x0, y0, x1, y1, false);
+}
+
+static void DilateKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	MorphologyKernel(job, x0, y0, x1, y1, true);
+}
+
+// Window of radius larger than 1, Param is 1 for dilation. Centre is skipped like in the 3x3 kernels.
+static void MorphologyRadiusKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	bool isDilate = job->Param != 0;
+	int c = isDilate ? 1 : 0;
+	int target = isDilate ? 255 : 0;
+	int r = job->Radius;
+
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			bool found = false;
+			for( int dy = -r ; dy <= r && !found ; ++dy )
+			{
+				for( int dx = -r ; dx <= r && !found ; ++dx )
+				{
+					if( (dx != 0 || dy != 0) && Pixel(job, x + dx, y + dy, c) == target ) found = true;
+				}
+			}
+
+			unsigned char pix = (found == isDilate) ? 255 : 0;
+			unsigned char* out = Output(job, x, y);
+			for( int k = 0 ; k < WrittenChannels(job) ; ++k ) out[k] = pix;
+		}
+	}
+}
+
+void HostErode(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.Kernel = ErodeKernel;
+	if( radius > 1 )
+	{
+		job.Kernel = MorphologyRadiusKernel;
+		job.Radius = radius;
+	}
+	HostRun(&job);
+}
+
+void HostDilate(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.Kernel = DilateKernel;
+	if( radius > 1 )
+	{
+		job.Kernel = MorphologyRadiusKernel;
+		job.Radius = radius;
+		job.Param = 1;
+	}
+	HostRun(&job);
+}
+
+//*****************************************************************
+// Point operations
+//*****************************************************************
+
+static void LUTKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		const unsigned char* in = job->Source + (y * job->Width + x0) * job->nChannels;
+		unsigned char* out = Output(job, x0, y);
+		for( int x = x0 ; x < x1 ; ++x, in += job->nChannels, out += job->nChannels )
+		{
+			out[0] = (unsigned char)job->MaskA[in[0]];
+			out[1] = (unsigned char)job->MaskA[in[1]];
+			out[2] = (unsigned char)job->MaskA[in[2]];
+		}
+	}
+}
+
+static void BinarizationKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	float fThreshold = (float)(unsigned int)job->Param;
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		const unsigned char* in = job->Source + (y * job->Width + x0) * job->nChannels;
+		unsigned char* out = Output(job, x0, y);
+		for( int x = x0 ; x < x1 ; ++x, in += job->nChannels, out += job->nChannels )
+		{
+			float fTemp = 0.30f * (int)in[0] + 0.30f * (int)in[1] + 0.30f * (int)in[2];
+			unsigned char pix = (fTemp < fThreshold) ? 0 : 255;
+			out[0] = out[1] = out[2] = pix;
+		}
+	}
+}
+
+void HostLUT(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, const int* lut)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.MaskA = lut;
+	job.Kernel = LUTKernel;
+	HostRun(&job);
+}
+
+void HostBinarization(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int threshold)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.Param = threshold;
+	job.Kernel = BinarizationKernel;
+	HostRun(&job);
+}
+
+//*****************************************************************
+// Separable convolution
+//*****************************************************************
+
+static void SeparableRowKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int ch = job->nChannels;
+	int nc = WrittenChannels(job);
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		const unsigned char* src = job->Source + y * job->Width * ch;
+		float* out = job->Work + y * job->Width * ch;
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			for( int c = 0 ; c < nc ; ++c )
+			{
+				float sum = 0.0f;
+				for( int k = -job->Radius ; k <= job->Radius ; ++k )
+				{
+					int sx = min(max(x + k, 0), job->Width - 1);
+					sum += src[sx * ch + c] * job->Coeffs[k + job->Radius];
+				}
+				out[x * ch + c] = sum;
+			}
+		}
+	}
+}
+
+static void SeparableColumnKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int ch = job->nChannels;
+	int nc = WrittenChannels(job);
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		unsigned char* out = Output(job, 0, y);
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			for( int c = 0 ; c < nc ; ++c )
+			{
+				float sum = 0.0f;
+				for( int k = -job->Radius ; k <= job->Radius ; ++k )
+				{
+					int sy = min(max(y + k, 0), job->Height - 1);
+					sum += job->Work[(sy * job->Width + x) * ch + c] * job->Coeffs[k + job->Radius];
+				}
+				int v = (int)floorf(sum + 0.5f);
+				out[x * ch + c] = (unsigned char)min(max(v, 0), 255);
+			}
+		}
+	}
+}
+
+void HostSeparable(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, const float* row, int rowRadius, const float* col, int colRadius)
+{
+	float* work = new float[width * height * nChannels];
+
+	// Column pass starts when all rows are done
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.Kernel = SeparableRowKernel;
+	job.Coeffs = row;
+	job.Radius = rowRadius;
+	job.Work = work;
+	HostRun(&job);
+	job.Kernel = SeparableColumnKernel;
+	job.Coeffs = col;
+	job.Radius = colRadius;
+	HostRun(&job);
+
+	delete [] work;
+}
+
+//*****************************************************************
+// Convolution with float mask
+//*****************************************************************
+
+static void ConvFloatKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int rx = job->RadiusX;
+	int ry = job->Radius;
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			unsigned char* out = Output(job, x, y);
+			for( int c = 0 ; c < WrittenChannels(job) ; ++c )
+			{
+				float sum = 0.0f;
+				const float* coeff = job->Coeffs;
+				for( int dy = -ry ; dy <= ry ; ++dy )
+				{
+					for( int dx = -rx ; dx <= rx ; ++dx ) sum += Pixel(job, x + dx, y + dy, c) * *coeff++;
+				}
+				int v = (int)floorf(sum + 0.5f);
+				out[c] = (unsigned char)min(max(v, 0), 255);
+			}
+		}
+	}
+}
+
+void HostConvFloat(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, const float* mask, int radiusX, int radiusY)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.Kernel = ConvFloatKernel;
+	job.Coeffs = mask;
+	job.Radius = radiusY;
+	job.RadiusX = radiusX;
+	HostRun(&job);
+}
+
+//*****************************************************************
+// Box mean
+//*****************************************************************
+
+// Horizontal sums are exact in float, Work holds them for the vertical pass
+static void BoxRowsKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int r = job->Radius;
+	int ch = job->nChannels;
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int c = 0 ; c < WrittenChannels(job) ; ++c )
+		{
+			unsigned int sum = 0;
+			for( int x = x0 - r ; x <= x0 + r ; ++x ) sum += Pixel(job, x, y, c);
+
+			float* out = job->Work + y * job->Width * ch + c;
+			for( int x = x0 ; x < x1 ; ++x )
+			{
+				out[x * ch] = (float)sum;
+				sum += Pixel(job, x + r + 1, y, c);
+				sum -= Pixel(job, x - r, y, c);
+			}
+		}
+	}
+}
+
+static inline unsigned int BoxSum(const HostJob* job, int x, int y, int c)
+{
+	if( y < 0 || y >= job->Height ) return 0;
+	return (unsigned int)job->Work[(y * job->Width + x) * job->nChannels + c];
+}
+
+static void BoxColumnsKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int r = job->Radius;
+	unsigned int area = (2 * r + 1) * (2 * r + 1);
+	for( int x = x0 ; x < x1 ; ++x )
+	{
+		for( int c = 0 ; c < WrittenChannels(job) ; ++c )
+		{
+			unsigned int sum = 0;
+			for( int y = y0 - r ; y <= y0 + r ; ++y ) sum += BoxSum(job, x, y, c);
+
+			for( int y = y0 ; y < y1 ; ++y )
+			{
+				Output(job, x, y)[c] = (unsigned char)(sum / area);
+				sum += BoxSum(job, x, y + r + 1, c);
+				sum -= BoxSum(job, x, y - r, c);
+			}
+		}
+	}
+}
+
+void HostBoxMean(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int radius)
+{
+	float* work = new float[width * height * nChannels];
+
+	// Vertical pass starts when all rows are done
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.Kernel = BoxRowsKernel;
+	job.Radius = radius;
+	job.Work = work;
+	HostRun(&job);
+	job.Kernel = BoxColumnsKernel;
+	HostRun(&job);
+
+	delete [] work;
+}
+
+//*****************************************************************
+// Morphology with rectangular element
+//*****************************************************************
+
+static inline int Extremum(int a, int b, bool isMax)
+{
+	return isMax ? max(a, b) : min(a, b);
+}
+
+// van Herk/Gil-Werman pass of ckRectRows and ckRectColumns over outputs [p0, p1) of one line of count pixels
+// step bytes apart. Blocks of length outputs start at p0, suffix extremum of a block is stored first and completed
+// by prefix extremum of the next block.
+static void VanHerkLine(const unsigned char* in, unsigned char* out, int step, int count, int p0, int p1, int length, int before, bool isMax)
+{
+	int neutral = isMax ? 0 : 255;
+	for( int b = p0 ; b < p1 ; b += length )
+	{
+		int e = min(b + length, p1);
+		int k0 = b - before;
+
+		int acc = neutral;
+		for( int s = k0 + length - 1 ; s >= k0 ; --s )
+		{
+			acc = Extremum(acc, (s < 0 || s >= count) ? neutral : in[s * step], isMax);
+			if( s + before < e ) out[(s + before) * step] = (unsigned char)acc;
+		}
+
+		acc = neutral;
+		for( int t = k0 + length ; t < k0 + 2 * length - 1 ; ++t )
+		{
+			int p = t - length + 1 + before;
+			if( p >= e ) break;
+			acc = Extremum(acc, (t < 0 || t >= count) ? neutral : in[t * step], isMax);
+			out[p * step] = (unsigned char)Extremum(out[p * step], acc, isMax);
+		}
+	}
+}
+
+// Radius is the length of the line, RadiusX the pixels before output and Param 1 for maximum
+static void RectRowsKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int ch = job->nChannels;
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int c = 0 ; c < WrittenChannels(job) ; ++c )
+		{
+			int row = y * job->Width * ch + c;
+			VanHerkLine(job->Source + row, job->Dest + row, ch, job->Width, x0, x1, job->Radius, job->RadiusX, job->Param != 0);
+		}
+	}
+}
+
+static void RectColumnsKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int ch = job->nChannels;
+	for( int x = x0 ; x < x1 ; ++x )
+	{
+		for( int c = 0 ; c < WrittenChannels(job) ; ++c )
+		{
+			VanHerkLine(job->Source + x * ch + c, job->Dest + x * ch + c, job->Width * ch, job->Height, y0, y1, job->Radius, job->RadiusX, job->Param != 0);
+		}
+	}
+}
+
+void HostRectMorphology(const unsigned char* src, unsigned char* dst, int width, int height, int nChannels, int length, int before, bool vertical, bool isMax)
+{
+	HostJob job = HostJob();
+	job.Source = src;
+	job.Dest = dst;
+	job.Width = width;
+	job.Height = height;
+	job.nChannels = nChannels;
+	job.Param = isMax ? 1 : 0;
+	job.Kernel = vertical ? RectColumnsKernel : RectRowsKernel;
+	job.Radius = length;
+	job.RadiusX = before;
+	HostRun(&job);
+}
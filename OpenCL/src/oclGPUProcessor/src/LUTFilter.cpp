@@ -6,6 +6,7 @@
  */
 
 #include "LUTFilter.h"
+#include "HostFilters.h"
 
 
 LUTFilter::~LUTFilter(void)
@@ -24,33 +25,41 @@ bool LUTFilter::filter(cl_command_queue GPUCommandQueue)
 	
     int iLocalPixPitch = iBlockDimX + 2;
     GPUError = clSetKernelArg(GPUFilter, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
-	GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&cmDevBufLUT);
-    GPUError |= clSetKernelArg(GPUFilter, 2, (iLocalPixPitch * (iBlockDimY + 2) *  GPUTransfer->nChannels * sizeof(cl_uchar)), NULL);
-    GPUError |= clSetKernelArg(GPUFilter, 3, sizeof(cl_int), (void*)&iLocalPixPitch);
-    GPUError |= clSetKernelArg(GPUFilter, 4, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
-    GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
-	GPUError |= clSetKernelArg(GPUFilter, 6, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+    GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+	GPUError |= clSetKernelArg(GPUFilter, 2, sizeof(cl_mem), (void*)&cmDevBufLUT);
+    GPUError |= clSetKernelArg(GPUFilter, 3, (iLocalPixPitch * (iBlockDimY + 2) *  GPUTransfer->nChannels * sizeof(cl_uchar)), NULL);
+    GPUError |= clSetKernelArg(GPUFilter, 4, sizeof(cl_int), (void*)&iLocalPixPitch);
+    GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+    GPUError |= clSetKernelArg(GPUFilter, 6, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUFilter, 7, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUFilter, 8, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
     if(GPUError) return false;
 
-	size_t GPULocalWorkSize[2]; 
-    GPULocalWorkSize[0] = iBlockDimX;
-    GPULocalWorkSize[1] = iBlockDimY;
-    GPUGlobalWorkSize[0] = shrRoundUp((int)GPULocalWorkSize[0], GPUTransfer->ImageWidth); 
-
-    GPUGlobalWorkSize[1] = shrRoundUp((int)GPULocalWorkSize[1], (int)GPUTransfer->ImageHeight);
-
-    if( clEnqueueNDRangeKernel( GPUCommandQueue, GPUFilter, 2, NULL, GPUGlobalWorkSize, GPULocalWorkSize, 0, NULL, NULL) ) return false;
-    return true;
+    return EnqueueKernel(GPUCommandQueue);
 }
 
 
 void LUTFilter::LoadLookUpTable(int* lut,int count,GPUTransferManager* transfer)
 {
-	
+	cmDevBufLUT = NULL;
+	// Host mode, filterHost() reads the table directly
+	if( transfer->GPUContext == NULL ) return;
+
 	// Create the device buffers in GMEM on each device, for now we have one device :)
     cmDevBufLUT = clCreateBuffer(transfer->GPUContext, CL_MEM_READ_WRITE, count * sizeof (unsigned int), NULL, &GPUError);
     CheckError(GPUError);
 
     GPUError = clEnqueueWriteBuffer(transfer->GPUCommandQueue, cmDevBufLUT, CL_TRUE, 0, count * sizeof (unsigned int), (void*)lut, 0, NULL, NULL);
     CheckError(GPUError);
-}
\ No newline at end of file
+}
+
+bool LUTFilter::filterHost()
+{
+	HostLUT(GPUTransfer->HostBuf, GPUTransfer->HostBufOut, GPUTransfer->ImageWidth, GPUTransfer->ImageHeight, GPUTransfer->nChannels, lut);
+	return true;
+}
+
+bool LUTFilter::PerChannel()
+{
+	return true;
+}
@@ -7,6 +7,7 @@
 
 
 #include "LowpassFilter.h"
+#include "HostFilters.h"
 
 LowpassFilter::~LowpassFilter(void)
 {
@@ -16,44 +17,90 @@ LowpassFilter::~LowpassFilter(void)
 
 LowpassFilter::LowpassFilter(char* source, cl_context GPUContext ,GPUTransferManager* transfer,char* KernelName): LinearFilter(source,GPUContext,transfer,KernelName)
 {
-
+	ImageKernelName = "ckConvImage";
+	StencilKernelName = "ckConvR";
+	mask = NULL;
+	maskCount = 0;
+	cmDevBufMask = NULL;
 }
 
 
 bool LowpassFilter::filter(cl_command_queue GPUCommandQueue)
 {
+    if( UseStencil() ) return filterStencil(GPUCommandQueue);
+    if( UseImage() ) return filterImage(GPUCommandQueue);
 	
     int iLocalPixPitch = iBlockDimX + 2;
     GPUError = clSetKernelArg(GPUFilter, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
-	GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&cmDevBufMask);
-    GPUError |= clSetKernelArg(GPUFilter, 2, (iLocalPixPitch * (iBlockDimY + 2) * GPUTransfer->nChannels * sizeof(cl_uchar)), NULL);
-	GPUError |= clSetKernelArg(GPUFilter, 3, ( 9 * sizeof(int)), NULL);  
-    GPUError |= clSetKernelArg(GPUFilter, 4, sizeof(cl_int), (void*)&iLocalPixPitch);  // radius
-    GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
-    GPUError |= clSetKernelArg(GPUFilter, 6, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
-	GPUError |= clSetKernelArg(GPUFilter, 7, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+    GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+	GPUError |= clSetKernelArg(GPUFilter, 2, sizeof(cl_mem), (void*)&cmDevBufMask);
+    GPUError |= clSetKernelArg(GPUFilter, 3, (iLocalPixPitch * (iBlockDimY + 2) * GPUTransfer->nChannels * sizeof(cl_uchar)), NULL);
+	GPUError |= clSetKernelArg(GPUFilter, 4, ( 9 * sizeof(int)), NULL);  
+    GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_int), (void*)&iLocalPixPitch);  // radius
+    GPUError |= clSetKernelArg(GPUFilter, 6, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+    GPUError |= clSetKernelArg(GPUFilter, 7, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUFilter, 8, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUFilter, 9, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
     if(GPUError) return false;
 
-	size_t GPULocalWorkSize[2]; 
-    GPULocalWorkSize[0] = iBlockDimX;
-    GPULocalWorkSize[1] = iBlockDimY;
-    GPUGlobalWorkSize[0] = shrRoundUp((int)GPULocalWorkSize[0], GPUTransfer->ImageWidth); 
-
-    GPUGlobalWorkSize[1] = shrRoundUp((int)GPULocalWorkSize[1], (int)GPUTransfer->ImageHeight);
-
-    if( clEnqueueNDRangeKernel( GPUCommandQueue, GPUFilter, 2, NULL, GPUGlobalWorkSize, GPULocalWorkSize, 0, NULL, NULL) ) return false;
-	return true;
+    return EnqueueKernel(GPUCommandQueue);
 }
 
 
 
 void LowpassFilter::LoadMask(int* mask,int count,GPUTransferManager* transfer)
 {
-	
+	// Mask is replaced when radius changes
+	if(cmDevBufMask)clReleaseMemObject(cmDevBufMask);
+	cmDevBufMask = NULL;
+	maskCount = count;
+	// Host mode, filterHost() reads the mask directly
+	if( transfer->GPUContext == NULL ) return;
+
 	// Create the device buffers in GMEM on each device, for now we have one device :)
     cmDevBufMask = clCreateBuffer(transfer->GPUContext, CL_MEM_READ_WRITE, count * sizeof (unsigned int), NULL, &GPUError);
     CheckError(GPUError);
 
     GPUError = clEnqueueWriteBuffer(transfer->GPUCommandQueue, cmDevBufMask, CL_TRUE, 0, count * sizeof (unsigned int), (void*)mask, 0, NULL, NULL);
     CheckError(GPUError);
-}
\ No newline at end of file
+}
+
+bool LowpassFilter::SetImageArgs(cl_uint first)
+{
+	GPUError = clSetKernelArg(GPUImageFilter, first, sizeof(cl_mem), (void*)&cmDevBufMask);
+	return GPUError == CL_SUCCESS;
+}
+
+bool LowpassFilter::SetStencilArgs(cl_uint first)
+{
+	// Zero sum is kept unscaled like in HostConv
+	int sum = 0;
+	for( int i = 0 ; i < maskCount ; i++ ) sum += mask[i];
+	if( sum == 0 ) sum = 1;
+
+	GPUError = clSetKernelArg(GPUStencilFilter, first, sizeof(cl_mem), (void*)&cmDevBufMask);
+	GPUError |= clSetKernelArg(GPUStencilFilter, first + 1, sizeof(cl_int), (void*)&sum);
+	return GPUError == CL_SUCCESS;
+}
+
+bool LowpassFilter::SetRadius(int radius)
+{
+	int side = 2 * radius + 1;
+	if( maskCount != side * side )
+	{
+		cout << "Mask of " << maskCount << " coefficients doesn't match radius " << radius << endl;
+		return false;
+	}
+	return ContextFilter::SetRadius(radius);
+}
+
+bool LowpassFilter::filterHost()
+{
+	HostConv(GPUTransfer->HostBuf, GPUTransfer->HostBufOut, GPUTransfer->ImageWidth, GPUTransfer->ImageHeight, GPUTransfer->nChannels, mask, iRadius);
+	return true;
+}
+
+bool LowpassFilter::PerChannel()
+{
+	return true;
+}
@@ -6,21 +6,120 @@
  */
 
 #include "MeanFilter.h"
+#include "HostFilters.h"
 
 
 
 MeanFilter::~MeanFilter(void)
 {
+	if(ckBoxRows)clReleaseKernel(ckBoxRows);
+	if(ckBoxColumns)clReleaseKernel(ckBoxColumns);
+	if(GPUBoxProgram)ProgramRegistry::Release(GPUBoxProgram);
 }
 
 
 	
-MeanFilter::MeanFilter(cl_context GPUContext ,GPUTransferManager* transfer): LowpassFilter("./OpenCL/LowpassFilter.cl",GPUContext,transfer,"ckConv")
+MeanFilter::MeanFilter(cl_context GPUContext ,GPUTransferManager* transfer, int radius): LowpassFilter("./OpenCL/LowpassFilter.cl",GPUContext,transfer,"ckConv")
 {
+	GPUBoxProgram = NULL;
+	ckBoxRows = NULL;
+	ckBoxColumns = NULL;
+
 	mask = new int[9];
 	for(int i = 0 ; i < 9 ; ++i )
 	{
 		mask[i] = 1;
 	}
 	LoadMask(mask,9,transfer);
+	if( radius > 1 ) SetRadius(radius);
+}
+
+bool MeanFilter::SetRadius(int radius)
+{
+	if( radius < 1 ) return false;
+	if( radius > 1 && !PrepareBox() ) return false;
+	iRadius = radius;
+	return true;
+}
+
+bool MeanFilter::PrepareBox()
+{
+	if( GPUTransfer->HostMode || GPUBoxProgram != NULL ) return true;
+
+	char *flags = "-cl-mad-enable";
+	GPUBoxProgram = ProgramRegistry::Acquire( GPUTransfer->GPUContext, "./OpenCL/BoxFilter.cl", flags, &GPUError);
+	CheckErrorBuildProgram(GPUError);
+	if( GPUBoxProgram == NULL ) return false;
+
+	ckBoxRows = clCreateKernel(GPUBoxProgram, "ckBoxRows", &GPUError);
+	CheckError(GPUError);
+	ckBoxColumns = clCreateKernel(GPUBoxProgram, "ckBoxColumns", &GPUError);
+	CheckError(GPUError);
+	return ckBoxRows != NULL && ckBoxColumns != NULL;
+}
+
+bool MeanFilter::filterBox(cl_command_queue GPUCommandQueue)
+{
+	size_t szBytes = (size_t)GPUTransfer->ImageWidth * GPUTransfer->ImageHeight * GPUTransfer->nChannels * GPUTransfer->BatchSize * sizeof(cl_uint);
+	ScratchBuffer* sums = GPUTransfer->Scratch(iScratchOwner, 0, szBytes);
+	if( sums == NULL ) return false;
+	cl_mem cmDevBufSums = sums->Buffer;
+
+	int iSegment = max(2 * iRadius + 1, BOX_MIN_SEGMENT);
+	cl_uint uiArea = (2 * iRadius + 1) * (2 * iRadius + 1);
+
+	GPUError = clSetKernelArg(ckBoxRows, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
+	GPUError |= clSetKernelArg(ckBoxRows, 1, sizeof(cl_mem), (void*)&cmDevBufSums);
+	GPUError |= clSetKernelArg(ckBoxRows, 2, sizeof(cl_int), (void*)&iRadius);
+	GPUError |= clSetKernelArg(ckBoxRows, 3, sizeof(cl_int), (void*)&iSegment);
+	GPUError |= clSetKernelArg(ckBoxRows, 4, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+	GPUError |= clSetKernelArg(ckBoxRows, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(ckBoxRows, 6, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(ckBoxRows, 7, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+
+	GPUError |= clSetKernelArg(ckBoxColumns, 0, sizeof(cl_mem), (void*)&cmDevBufSums);
+	GPUError |= clSetKernelArg(ckBoxColumns, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+	GPUError |= clSetKernelArg(ckBoxColumns, 2, sizeof(cl_int), (void*)&iRadius);
+	GPUError |= clSetKernelArg(ckBoxColumns, 3, sizeof(cl_int), (void*)&iSegment);
+	GPUError |= clSetKernelArg(ckBoxColumns, 4, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+	GPUError |= clSetKernelArg(ckBoxColumns, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(ckBoxColumns, 6, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(ckBoxColumns, 7, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+	GPUError |= clSetKernelArg(ckBoxColumns, 8, sizeof(cl_uint), (void*)&uiArea);
+	if(GPUError) return false;
+
+	// Segments along rows, then segments along columns. Work-group size is chosen by the driver.
+	cl_uint uiWorkDim = (GPUTransfer->BatchSize > 1) ? 3 : 2;
+	size_t GPURowsWorkSize[3];
+	GPURowsWorkSize[0] = (GPUTransfer->ImageWidth + iSegment - 1) / iSegment;
+	GPURowsWorkSize[1] = GPUTransfer->ImageHeight;
+	GPURowsWorkSize[2] = GPUTransfer->BatchSize;
+	size_t GPUColumnsWorkSize[3];
+	GPUColumnsWorkSize[0] = GPUTransfer->ImageWidth;
+	GPUColumnsWorkSize[1] = (GPUTransfer->ImageHeight + iSegment - 1) / iSegment;
+	GPUColumnsWorkSize[2] = GPUTransfer->BatchSize;
+
+	cl_event event;
+	GPUProfiler* profiler = GPUTransfer->Profiler;
+	if( clEnqueueNDRangeKernel( GPUCommandQueue, ckBoxRows, uiWorkDim, NULL, GPURowsWorkSize, NULL, 0, NULL, profiler ? &event : NULL) ) return false;
+	if( profiler ) profiler->Record("ckBoxRows", event);
+	if( clEnqueueNDRangeKernel( GPUCommandQueue, ckBoxColumns, uiWorkDim, NULL, GPUColumnsWorkSize, NULL, 0, NULL, profiler ? &event : NULL) ) return false;
+	if( profiler ) profiler->Record("ckBoxColumns", event);
+	return true;
+}
+
+bool MeanFilter::filter(cl_command_queue GPUCommandQueue)
+{
+	if( iRadius > 1 ) return filterBox(GPUCommandQueue);
+	return LowpassFilter::filter(GPUCommandQueue);
+}
+
+bool MeanFilter::filterHost()
+{
+	if( iRadius > 1 )
+	{
+		HostBoxMean(GPUTransfer->HostBuf, GPUTransfer->HostBufOut, GPUTransfer->ImageWidth, GPUTransfer->ImageHeight, GPUTransfer->nChannels, iRadius);
+		return true;
+	}
+	return LowpassFilter::filterHost();
 }
@@ -6,37 +6,111 @@
  */
 
 #include "MedianFilter.h"
+#include "HostFilters.h"
 
 MedianFilter::~MedianFilter(void)
 {
+	if(ckHistogram)clReleaseKernel(ckHistogram);
+	if(GPUHistogramProgram)ProgramRegistry::Release(GPUHistogramProgram);
 }
 
 MedianFilter::MedianFilter(cl_context GPUContext ,GPUTransferManager* transfer): NonLinearFilter("./OpenCL/MedianFilter.cl",GPUContext,transfer,"ckMedian")
 {
+	ImageKernelName = "ckMedianImage";
+	StencilKernelName = "ckMedianR";
+	GPUHistogramProgram = NULL;
+	ckHistogram = NULL;
+}
+
+bool MedianFilter::SetRadius(int radius)
+{
+	if( !NonLinearFilter::SetRadius(radius) ) return false;
 
+	// Without histogram kernel ckMedianR is used
+	if( radius >= MEDIAN_HISTOGRAM_RADIUS ) PrepareHistogram();
+	return true;
+}
+
+bool MedianFilter::PrepareHistogram()
+{
+	if( GPUTransfer->HostMode || GPUHistogramProgram != NULL ) return true;
+
+	char *flags = "-cl-mad-enable";
+	GPUHistogramProgram = ProgramRegistry::Acquire( GPUTransfer->GPUContext, "./OpenCL/MedianHistogram.cl", flags, &GPUError);
+	CheckErrorBuildProgram(GPUError);
+	if( GPUHistogramProgram == NULL ) return false;
+
+	ckHistogram = clCreateKernel(GPUHistogramProgram, "ckMedianHistogram", &GPUError);
+	CheckError(GPUError);
+	return ckHistogram != NULL;
+}
+
+bool MedianFilter::filterHistogram(cl_command_queue GPUCommandQueue)
+{
+	// 256 fine and 16 coarse counters per written channel
+	int nPlanes = (GPUTransfer->nChannels == 1) ? 1 : 3;
+	size_t szItemBytes = nPlanes * (256 + 16) * sizeof(cl_ushort);
+	if( (cl_ulong)szItemBytes > LocalMemSize() ) return filterStencil(GPUCommandQueue);
+
+	size_t szGroup = 1;
+	while( szGroup * 2 <= MEDIAN_MAX_GROUP && (cl_ulong)(szGroup * 2 * szItemBytes) <= LocalMemSize() ) szGroup *= 2;
+
+	int iSegment = max(2 * (2 * iRadius + 1), MEDIAN_MIN_SEGMENT);
+	int iSegments = (GPUTransfer->ImageWidth + iSegment - 1) / iSegment;
+
+	GPUError = clSetKernelArg(ckHistogram, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
+	GPUError |= clSetKernelArg(ckHistogram, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+	GPUError |= clSetKernelArg(ckHistogram, 2, szGroup * szItemBytes, NULL);
+	GPUError |= clSetKernelArg(ckHistogram, 3, sizeof(cl_int), (void*)&iRadius);
+	GPUError |= clSetKernelArg(ckHistogram, 4, sizeof(cl_int), (void*)&iSegment);
+	GPUError |= clSetKernelArg(ckHistogram, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+	GPUError |= clSetKernelArg(ckHistogram, 6, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(ckHistogram, 7, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(ckHistogram, 8, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+	if(GPUError) return false;
+
+	// Work-group spans segments of one row, size is limited by local memory
+	cl_uint uiWorkDim = (GPUTransfer->BatchSize > 1) ? 3 : 2;
+	size_t GPUHistogramLocalSize[3] = { szGroup, 1, 1 };
+	size_t GPUHistogramWorkSize[3];
+	GPUHistogramWorkSize[0] = shrRoundUp((int)szGroup, iSegments);
+	GPUHistogramWorkSize[1] = GPUTransfer->ImageHeight;
+	GPUHistogramWorkSize[2] = GPUTransfer->BatchSize;
+
+	cl_event event;
+	GPUProfiler* profiler = GPUTransfer->Profiler;
+	if( clEnqueueNDRangeKernel( GPUCommandQueue, ckHistogram, uiWorkDim, NULL, GPUHistogramWorkSize, GPUHistogramLocalSize, 0, NULL, profiler ? &event : NULL) ) return false;
+	if( profiler ) profiler->Record("ckMedianHistogram", event);
+	return true;
 }
 
 bool MedianFilter::filter(cl_command_queue GPUCommandQueue)
 {
+    if( iRadius >= MEDIAN_HISTOGRAM_RADIUS && ckHistogram != NULL ) return filterHistogram(GPUCommandQueue);
+    if( UseStencil() ) return filterStencil(GPUCommandQueue);
+    if( UseImage() ) return filterImage(GPUCommandQueue);
  
     int iLocalPixPitch = iBlockDimX + 2;
     GPUError = clSetKernelArg(GPUFilter, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
-    GPUError |= clSetKernelArg(GPUFilter, 1, (iLocalPixPitch * (iBlockDimY + 2) *  GPUTransfer->nChannels * sizeof(cl_uchar)), NULL);
-    GPUError |= clSetKernelArg(GPUFilter, 2, sizeof(cl_int), (void*)&iLocalPixPitch);
-    GPUError |= clSetKernelArg(GPUFilter, 3, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
-    GPUError |= clSetKernelArg(GPUFilter, 4, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
-	GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+    GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+    GPUError |= clSetKernelArg(GPUFilter, 2, (iLocalPixPitch * (iBlockDimY + 2) *  GPUTransfer->nChannels * sizeof(cl_uchar)), NULL);
+    GPUError |= clSetKernelArg(GPUFilter, 3, sizeof(cl_int), (void*)&iLocalPixPitch);
+    GPUError |= clSetKernelArg(GPUFilter, 4, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+    GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUFilter, 6, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUFilter, 7, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
     if(GPUError) return false;
 
-	size_t GPULocalWorkSize[2]; 
-    GPULocalWorkSize[0] = iBlockDimX;
-    GPULocalWorkSize[1] = iBlockDimY;
-    GPUGlobalWorkSize[0] = shrRoundUp((int)GPULocalWorkSize[0], GPUTransfer->ImageWidth); 
-
-    GPUGlobalWorkSize[1] = shrRoundUp((int)GPULocalWorkSize[1], (int)GPUTransfer->ImageHeight);
+    return EnqueueKernel(GPUCommandQueue);
+}
 
-    
+bool MedianFilter::filterHost()
+{
+	HostMedian(GPUTransfer->HostBuf, GPUTransfer->HostBufOut, GPUTransfer->ImageWidth, GPUTransfer->ImageHeight, GPUTransfer->nChannels, iRadius);
+	return true;
+}
 
-    if(clEnqueueNDRangeKernel( GPUCommandQueue, GPUFilter, 2, NULL, GPUGlobalWorkSize, GPULocalWorkSize, 0, NULL, NULL)) return false;
+bool MedianFilter::PerChannel()
+{
 	return true;
-}
\ No newline at end of file
+}
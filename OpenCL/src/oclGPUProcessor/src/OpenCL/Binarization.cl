@@ -2,13 +2,16 @@
 
 
 
-__kernel void ckBin(__global uchar* ucSource,unsigned int Threshold,
-                      unsigned int uiImageWidth, unsigned int uiDevImageHeight,unsigned int nChannels)
+__kernel void ckBin(__global uchar* ucSource, __global uchar* ucDest, unsigned int Threshold,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight,unsigned int nChannels, int iPitch)
 {
+	    // Image of the batch processed by this work item
+	    ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	    ucDest += ImageOffset(iPitch, uiDevImageHeight);
 
 		int iImagePosX = get_global_id(0);
-	    int iDevYPrime = get_global_id(1) - 1;  // Shift offset up 1 radius (1 row) for reads
-	    int iDevGMEMOffset = mul24(iDevYPrime, (int)get_global_size(0)) + iImagePosX;
+	    int iImagePosY = get_global_id(1);
+	    int iDevGMEMOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels);
 
 		uchar4 input = GetDataFromGlobalMemory(ucSource,iDevGMEMOffset,nChannels);
 
@@ -25,8 +28,8 @@ __kernel void ckBin(__global uchar* ucSource,unsigned int Threshold,
 		}
 
 		// Write out to GMEM with restored offset
-	    if((iDevYPrime < uiDevImageHeight) && (iImagePosX < uiImageWidth))
+	    if((iImagePosY < uiDevImageHeight) && (iImagePosX < uiImageWidth))
 	    {
-		     setData(ucSource,input.x ,input.x, input.x, iDevGMEMOffset,nChannels);
+		     setData(ucDest,input.x ,input.x, input.x, iDevGMEMOffset,nChannels);
 	    }
 }
@@ -0,0 +1,97 @@
+// Box mean with (2 * iRadius + 1)^2 window in two running-sum passes, cost per pixel doesn't depend on radius.
+// Each work item runs the window over a segment of iSegment pixels: the first sum is computed in full, then one pixel
+// enters and one leaves per step. Pixels outside of the image are zero and sums are exact in uint, so result is
+// the same as ckConvR with mask of ones.
+
+uint4 GetUintData(__global uint* data, int iOffset, int nChannels)
+{
+	if( nChannels == 4 ) return vload4(0, data + iOffset);
+	if( nChannels == 1 ) return (uint4)(data[iOffset]);
+
+	uint4 pix = (uint4)(0);
+	pix.x = data[iOffset];
+	pix.y = data[iOffset+1];
+	pix.z = data[iOffset+2];
+	return pix;
+}
+
+void SetUintData(__global uint* data, uint4 pix, int iOffset, int nChannels)
+{
+	if( nChannels == 4 )
+	{
+		vstore4(pix, 0, data + iOffset);
+		return;
+	}
+	data[iOffset] = pix.x;
+	if( nChannels == 1 ) return;
+	data[iOffset+1] = pix.y;
+	data[iOffset+2] = pix.z;
+}
+
+uint4 GetPixelOrZero(__global uchar* ucSource, int x, int y, unsigned int uiImageWidth, int nChannels, int iPitch)
+{
+	if( x < 0 || x >= uiImageWidth ) return (uint4)(0);
+	return convert_uint4(GetDataFromGlobalMemory(ucSource, PixelOffset(x, y, iPitch, nChannels), nChannels));
+}
+
+uint4 GetSumOrZero(__global uint* uiSource, int x, int y, unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels)
+{
+	if( y < 0 || y >= uiDevImageHeight ) return (uint4)(0);
+	return GetUintData(uiSource, mul24(mul24(y, (int)uiImageWidth) + x, nChannels), nChannels);
+}
+
+// Horizontal sums of a segment of one row, work item (segment, row, image of batch)
+__kernel void ckBoxRows(__global uchar* ucSource, __global uint* uiDest, int iRadius, int iSegment,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	uiDest += get_global_id(2) * (size_t)uiImageWidth * uiDevImageHeight * nChannels;
+
+	int x0 = mul24((int)get_global_id(0), iSegment);
+	int y = get_global_id(1);
+	if( x0 >= uiImageWidth || y >= uiDevImageHeight ) return;
+	int x1 = min(x0 + iSegment, (int)uiImageWidth);
+
+	uint4 uiSum = (uint4)(0);
+	for( int x = max(x0 - iRadius, 0) ; x <= min(x0 + iRadius, (int)uiImageWidth - 1) ; x++ )
+	{
+		uiSum += GetPixelOrZero(ucSource, x, y, uiImageWidth, nChannels, iPitch);
+	}
+
+	int iOffset = mul24(mul24(y, (int)uiImageWidth) + x0, nChannels);
+	for( int x = x0 ; x < x1 ; x++ )
+	{
+		SetUintData(uiDest, uiSum, iOffset, nChannels);
+		iOffset += nChannels;
+		uiSum += GetPixelOrZero(ucSource, x + iRadius + 1, y, uiImageWidth, nChannels, iPitch);
+		uiSum -= GetPixelOrZero(ucSource, x - iRadius, y, uiImageWidth, nChannels, iPitch);
+	}
+}
+
+// Vertical sums of horizontal sums over a segment of one column and division by area of the window.
+// Work item (column, segment, image of batch), neighbouring work items read neighbouring sums.
+__kernel void ckBoxColumns(__global uint* uiSource, __global uchar* ucDest, int iRadius, int iSegment,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch, unsigned int uiArea)
+{
+	uiSource += get_global_id(2) * (size_t)uiImageWidth * uiDevImageHeight * nChannels;
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	int x = get_global_id(0);
+	int y0 = mul24((int)get_global_id(1), iSegment);
+	if( x >= uiImageWidth || y0 >= uiDevImageHeight ) return;
+	int y1 = min(y0 + iSegment, (int)uiDevImageHeight);
+
+	uint4 uiSum = (uint4)(0);
+	for( int y = max(y0 - iRadius, 0) ; y <= min(y0 + iRadius, (int)uiDevImageHeight - 1) ; y++ )
+	{
+		uiSum += GetSumOrZero(uiSource, x, y, uiImageWidth, uiDevImageHeight, nChannels);
+	}
+
+	for( int y = y0 ; y < y1 ; y++ )
+	{
+		uchar4 res = convert_uchar4_sat(uiSum / uiArea);
+		setData(ucDest, (char)res.x, (char)res.y, (char)res.z, PixelOffset(x, y, iPitch, nChannels), nChannels);
+		uiSum += GetSumOrZero(uiSource, x, y + iRadius + 1, uiImageWidth, uiDevImageHeight, nChannels);
+		uiSum -= GetSumOrZero(uiSource, x, y - iRadius, uiImageWidth, uiDevImageHeight, nChannels);
+	}
+}
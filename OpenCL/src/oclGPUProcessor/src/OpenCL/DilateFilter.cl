@@ -3,17 +3,20 @@
 
 
 
-__kernel void ckDilate(__global uchar* ucSource,
+__kernel void ckDilate(__global uchar* ucSource, __global uchar* ucDest,
                       __local uchar* ucLocalData, int iLocalPixPitch, 
-                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels)
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
 {
+	    // Image of the batch processed by this work item
+	    ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	    ucDest += ImageOffset(iPitch, uiDevImageHeight);
 		
-	    LoadToLocalMemNew(ucSource,ucLocalData, iLocalPixPitch, uiImageWidth, uiDevImageHeight,nChannels);
+	    LoadToLocalMemNew(ucSource,ucLocalData, iLocalPixPitch, uiImageWidth, uiDevImageHeight,nChannels, iPitch);
 	
 
 	    int iImagePosX = get_global_id(0);
-	    int iDevYPrime = get_global_id(1) - 1;  // Shift offset up 1 radius (1 row) for reads
-	    int iDevGMEMOffset = mul24(iDevYPrime, (int)get_global_size(0)) + iImagePosX;
+	    int iImagePosY = get_global_id(1);
+	    int iDevGMEMOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels);
 	    // Synchronize the read into LMEM
 	    barrier(CLK_LOCAL_MEM_FENCE);
 
@@ -111,8 +114,8 @@ __kernel void ckDilate(__global uchar* ucSource,
 		}
 	    
 		// Write out to GMEM with restored offset
-	    if((iDevYPrime < uiDevImageHeight) && (iImagePosX < uiImageWidth))
+	    if((iImagePosY < uiDevImageHeight) && (iImagePosX < uiImageWidth))
 	    {
-			setData(ucSource,pix.x ,pix.y, pix.z, iDevGMEMOffset,nChannels );
+			setData(ucDest,pix.x ,pix.y, pix.z, iDevGMEMOffset,nChannels );
 	    }
 }
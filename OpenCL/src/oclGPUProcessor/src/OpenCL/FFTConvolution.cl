@@ -0,0 +1,115 @@
+// Convolution with large float mask, directly or through radix-2 FFT of padded image.
+// Mask is applied like in ckConv: coefficient (dx, dy) multiplies pixel (x + dx, y + dy), pixels outside of the image are zero.
+
+// Direct path. Tile with apron of iRadius = max(mask radii) pixels is staged in local memory.
+__kernel void ckConvFloat(__global uchar* ucSource, __global uchar* ucDest, __local uchar* ucLocalData, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch,
+                      __constant float* fMask, int iMaskRadiusX, int iMaskRadiusY)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	LoadTileToLocalMem(ucSource, ucLocalData, iRadius, uiImageWidth, uiDevImageHeight, nChannels, iPitch);
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	float4 fSum = (float4)(0.0f);
+	int k = 0;
+	for( int dy = -iMaskRadiusY ; dy <= iMaskRadiusY ; dy++ )
+	{
+		for( int dx = -iMaskRadiusX ; dx <= iMaskRadiusX ; dx++ )
+		{
+			fSum += convert_float4(GetDataFromTile(ucLocalData, iRadius, dx, dy, nChannels)) * fMask[k++];
+		}
+	}
+
+	uchar4 res = convert_uchar4_sat_rte(fSum);
+	setData(ucDest, (char)res.x, (char)res.y, (char)res.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+// Two real channels are transformed at once as real and imaginary part, mask is real so results don't mix.
+// Channel A goes to real part, channel B to imaginary part, B < 0 is zero. Padding right and below the image is zero.
+__kernel void ckFFTLoad(__global uchar* ucSource, __global float2* fDest, ulong ulOffsetA, int iChannelA, ulong ulOffsetB, int iChannelB,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch, int iPadWidth)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+
+	float2 value = (float2)(0.0f);
+	if( x < uiImageWidth && y < uiDevImageHeight )
+	{
+		int iPixOffset = PixelOffset(x, y, iPitch, nChannels);
+		value.x = ucSource[ulOffsetA + iPixOffset + iChannelA];
+		if( iChannelB >= 0 ) value.y = ucSource[ulOffsetB + iPixOffset + iChannelB];
+	}
+	fDest[mul24(y, iPadWidth) + x] = value;
+}
+
+// Mask is stored mirrored with origin at (0, 0), then circular convolution of padded image gives ckConv ordering
+__kernel void ckFFTLoadMask(__constant float* fMask, __global float2* fDest, int iMaskRadiusX, int iMaskRadiusY, int iPadWidth, int iPadHeight)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+
+	// Coefficient (dx, dy) lands at (-dx, -dy) modulo padded size
+	int dx = (x <= iMaskRadiusX) ? -x : iPadWidth - x;
+	int dy = (y <= iMaskRadiusY) ? -y : iPadHeight - y;
+
+	float2 value = (float2)(0.0f);
+	if( dx >= -iMaskRadiusX && dx <= iMaskRadiusX && dy >= -iMaskRadiusY && dy <= iMaskRadiusY )
+	{
+		value.x = fMask[mul24(dy + iMaskRadiusY, 2 * iMaskRadiusX + 1) + dx + iMaskRadiusX];
+	}
+	fDest[mul24(y, iPadWidth) + x] = value;
+}
+
+// One radix-2 Stockham pass over transforms of length 2 * iHalf, output is in natural order after log2(length) passes.
+// Elements of a transform are iStride apart, transforms are iBatchStride apart (rows: 1, width; columns: width, 1).
+// fSign is -1 for forward and +1 for inverse transform.
+__kernel void ckFFTRadix2(__global float2* fSource, __global float2* fDest, int p, int iHalf, int iStride, int iBatchStride, float fSign)
+{
+	int i = get_global_id(0);
+	int iBase = mul24((int)get_global_id(1), iBatchStride);
+
+	int k = i & (p - 1);
+	float2 u0 = fSource[iBase + mul24(i, iStride)];
+	float2 u1 = fSource[iBase + mul24(i + iHalf, iStride)];
+
+	float fCos;
+	float fSin = sincos(fSign * M_PI_F * (float)k / (float)p, &fCos);
+	u1 = (float2)(u1.x * fCos - u1.y * fSin, u1.x * fSin + u1.y * fCos);
+
+	int j = (i << 1) - k;
+	fDest[iBase + mul24(j, iStride)] = u0 + u1;
+	fDest[iBase + mul24(j + p, iStride)] = u0 - u1;
+}
+
+// Pointwise product with spectrum of the mask, scaled by 1 / (padded size) of inverse transform
+__kernel void ckSpectrumMul(__global float2* fData, __global float2* fSpectrum, float fScale)
+{
+	int i = get_global_id(0);
+	float2 a = fData[i];
+	float2 b = fSpectrum[i];
+	fData[i] = (float2)(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x) * fScale;
+}
+
+// Real part goes back to channel A, imaginary part to channel B
+__kernel void ckFFTStore(__global float2* fSource, __global uchar* ucDest, ulong ulOffsetA, int iChannelA, ulong ulOffsetB, int iChannelB,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch, int iPadWidth)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	if( x >= uiImageWidth || y >= uiDevImageHeight ) return;
+
+	float2 value = fSource[mul24(y, iPadWidth) + x];
+	int iPixOffset = PixelOffset(x, y, iPitch, nChannels);
+	ucDest[ulOffsetA + iPixOffset + iChannelA] = convert_uchar_sat_rte(value.x);
+	if( iChannelB >= 0 ) ucDest[ulOffsetB + iPixOffset + iChannelB] = convert_uchar_sat_rte(value.y);
+
+	// Fourth channel of packed pixels is written opaque like in setData
+	if( nChannels == 4 && iChannelA == 0 ) ucDest[ulOffsetA + iPixOffset + 3] = 255;
+}
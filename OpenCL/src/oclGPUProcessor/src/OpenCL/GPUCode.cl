@@ -1,29 +1,47 @@
 
+// Global memory offsets are in bytes, rows of device image are iPitch bytes long and may be padded
+// Packed 4-channel pixels (LAYOUT_RGBA) are moved with one vector load/store instead of byte by byte,
+// planes of LAYOUT_PLANAR have 1 channel and are read with unit stride
 void GetData(__global uchar* dataIn, __local uchar* dataOut, int iDevGMEMOffset, int iLocalPixOffset, int nChannels)
 {
-	dataOut[iLocalPixOffset*nChannels] = dataIn[iDevGMEMOffset*nChannels];
-	dataOut[iLocalPixOffset*nChannels+1] = dataIn[iDevGMEMOffset*nChannels+1];
-	dataOut[iLocalPixOffset*nChannels+2] = dataIn[iDevGMEMOffset*nChannels+2];
 	if( nChannels == 4 )
 	{
-		dataOut[iLocalPixOffset*nChannels+3] = dataIn[iDevGMEMOffset*nChannels+3];
+		vstore4(vload4(0, dataIn + iDevGMEMOffset), iLocalPixOffset, dataOut);
+		return;
 	}
+	if( nChannels == 1 )
+	{
+		dataOut[iLocalPixOffset] = dataIn[iDevGMEMOffset];
+		return;
+	}
+	dataOut[iLocalPixOffset*nChannels] = dataIn[iDevGMEMOffset];
+	dataOut[iLocalPixOffset*nChannels+1] = dataIn[iDevGMEMOffset+1];
+	dataOut[iLocalPixOffset*nChannels+2] = dataIn[iDevGMEMOffset+2];
 }
 
 void SetZERO(__local uchar* dataOut, int iLocalPixOffset, int nChannels)
 {
-	dataOut[iLocalPixOffset*nChannels] = (char)0;
-	dataOut[iLocalPixOffset*nChannels+1] = (char)0;
-	dataOut[iLocalPixOffset*nChannels+2] = (char)0;
 	if( nChannels == 4 )
 	{
-		dataOut[iLocalPixOffset*nChannels+3] = (char)0;
+		vstore4((uchar4)(0), iLocalPixOffset, dataOut);
+		return;
 	}
+	if( nChannels == 1 )
+	{
+		dataOut[iLocalPixOffset] = (char)0;
+		return;
+	}
+	dataOut[iLocalPixOffset*nChannels] = (char)0;
+	dataOut[iLocalPixOffset*nChannels+1] = (char)0;
+	dataOut[iLocalPixOffset*nChannels+2] = (char)0;
 }
 
 
 uchar4 GetDataFromLocalMemory( __local uchar* data,  int iLocalPixOffset , int nChannels)
 {
+	if( nChannels == 4 ) return vload4(iLocalPixOffset, data);
+	if( nChannels == 1 ) return (uchar4)(data[iLocalPixOffset]);
+
 	uchar4 pix;
 	pix.x = data[iLocalPixOffset*nChannels];
 	pix.y = data[iLocalPixOffset*nChannels+1];
@@ -31,31 +49,119 @@ uchar4 GetDataFromLocalMemory( __local uchar* data,  int iLocalPixOffset , int n
 	return pix;
 }
 
+// 3x3 neighbourhood of work item from LMEM block in order NW, N, NE, W, C, E, SW, S, SE, each pixel is loaded once
+void GetWindowFromLocalMemory( __local uchar* data, int iLocalPixPitch, int nChannels, uchar4* v)
+{
+	int iLocalPixOffset = mul24((int)get_local_id(1), iLocalPixPitch) + get_local_id(0);
+	for( int iRow = 0 ; iRow < 3 ; iRow++ )
+	{
+		v[3*iRow] = GetDataFromLocalMemory(data, iLocalPixOffset, nChannels);
+		v[3*iRow+1] = GetDataFromLocalMemory(data, iLocalPixOffset + 1, nChannels);
+		v[3*iRow+2] = GetDataFromLocalMemory(data, iLocalPixOffset + 2, nChannels);
+		iLocalPixOffset += iLocalPixPitch;
+	}
+}
+
+// Fourth channel of packed pixels is written opaque
 void setData(__global char* data, char x , char y, char z, int iDevGMEMOffset , int nChannels)
 {
-	data[iDevGMEMOffset*nChannels] = x;
-	data[iDevGMEMOffset*nChannels+1] = y;
-	data[iDevGMEMOffset*nChannels+2] = z;
+	if( nChannels == 4 )
+	{
+		vstore4((uchar4)((uchar)x, (uchar)y, (uchar)z, (uchar)255), 0, (__global uchar*)data + iDevGMEMOffset);
+		return;
+	}
+	if( nChannels == 1 )
+	{
+		data[iDevGMEMOffset] = x;
+		return;
+	}
+	data[iDevGMEMOffset] = x;
+	data[iDevGMEMOffset+1] = y;
+	data[iDevGMEMOffset+2] = z;
 }
 
 uchar4 GetDataFromGlobalMemory( __global uchar* data,  int iDevGMEMOffset , int nChannels)
 {
+	if( nChannels == 4 ) return vload4(0, data + iDevGMEMOffset);
+	if( nChannels == 1 ) return (uchar4)(data[iDevGMEMOffset]);
+
 	uchar4 pix;
-	pix.x = data[iDevGMEMOffset*nChannels];
-	pix.y = data[iDevGMEMOffset*nChannels+1];
-	pix.z = data[iDevGMEMOffset*nChannels+2];
+	pix.x = data[iDevGMEMOffset];
+	pix.y = data[iDevGMEMOffset+1];
+	pix.z = data[iDevGMEMOffset+2];
 	return pix;
 }
 
 
+// Compare-exchange of all channels at once, a gets the smaller values
+#define PIX_SORT(a,b) { uchar4 t = min(a, b); b = max(a, b); a = t; }
+
+// Exact median of 9 values, min/max network of 19 compare-exchanges (Paeth, Devillard). Indices are constant so
+// the window stays in registers. Order of v is changed.
+uchar4 Median9(uchar4* v)
+{
+	PIX_SORT(v[1], v[2]); PIX_SORT(v[4], v[5]); PIX_SORT(v[7], v[8]);
+	PIX_SORT(v[0], v[1]); PIX_SORT(v[3], v[4]); PIX_SORT(v[6], v[7]);
+	PIX_SORT(v[1], v[2]); PIX_SORT(v[4], v[5]); PIX_SORT(v[7], v[8]);
+	PIX_SORT(v[0], v[3]); PIX_SORT(v[5], v[8]); PIX_SORT(v[4], v[7]);
+	PIX_SORT(v[3], v[6]); PIX_SORT(v[1], v[4]); PIX_SORT(v[2], v[5]);
+	PIX_SORT(v[4], v[7]); PIX_SORT(v[4], v[2]); PIX_SORT(v[6], v[4]);
+	PIX_SORT(v[4], v[2]);
+	return v[4];
+}
+
+// Exact median of 25 values, network of 99 compare-exchanges (Devillard). Order of v is changed.
+uchar4 Median25(uchar4* v)
+{
+	PIX_SORT(v[0], v[1]);   PIX_SORT(v[3], v[4]);   PIX_SORT(v[2], v[4]);   PIX_SORT(v[2], v[3]);
+	PIX_SORT(v[6], v[7]);   PIX_SORT(v[5], v[7]);   PIX_SORT(v[5], v[6]);   PIX_SORT(v[9], v[10]);
+	PIX_SORT(v[8], v[10]);  PIX_SORT(v[8], v[9]);   PIX_SORT(v[12], v[13]); PIX_SORT(v[11], v[13]);
+	PIX_SORT(v[11], v[12]); PIX_SORT(v[15], v[16]); PIX_SORT(v[14], v[16]); PIX_SORT(v[14], v[15]);
+	PIX_SORT(v[18], v[19]); PIX_SORT(v[17], v[19]); PIX_SORT(v[17], v[18]); PIX_SORT(v[21], v[22]);
+	PIX_SORT(v[20], v[22]); PIX_SORT(v[20], v[21]); PIX_SORT(v[23], v[24]); PIX_SORT(v[2], v[5]);
+	PIX_SORT(v[3], v[6]);   PIX_SORT(v[0], v[6]);   PIX_SORT(v[0], v[3]);   PIX_SORT(v[4], v[7]);
+	PIX_SORT(v[1], v[7]);   PIX_SORT(v[1], v[4]);   PIX_SORT(v[11], v[14]); PIX_SORT(v[8], v[14]);
+	PIX_SORT(v[8], v[11]);  PIX_SORT(v[12], v[15]); PIX_SORT(v[9], v[15]);  PIX_SORT(v[9], v[12]);
+	PIX_SORT(v[13], v[16]); PIX_SORT(v[10], v[16]); PIX_SORT(v[10], v[13]); PIX_SORT(v[20], v[23]);
+	PIX_SORT(v[17], v[23]); PIX_SORT(v[17], v[20]); PIX_SORT(v[21], v[24]); PIX_SORT(v[18], v[24]);
+	PIX_SORT(v[18], v[21]); PIX_SORT(v[19], v[22]); PIX_SORT(v[8], v[17]);  PIX_SORT(v[9], v[18]);
+	PIX_SORT(v[0], v[18]);  PIX_SORT(v[0], v[9]);   PIX_SORT(v[10], v[19]); PIX_SORT(v[1], v[19]);
+	PIX_SORT(v[1], v[10]);  PIX_SORT(v[11], v[20]); PIX_SORT(v[2], v[20]);  PIX_SORT(v[2], v[11]);
+	PIX_SORT(v[12], v[21]); PIX_SORT(v[3], v[21]);  PIX_SORT(v[3], v[12]);  PIX_SORT(v[13], v[22]);
+	PIX_SORT(v[4], v[22]);  PIX_SORT(v[4], v[13]);  PIX_SORT(v[14], v[23]); PIX_SORT(v[5], v[23]);
+	PIX_SORT(v[5], v[14]);  PIX_SORT(v[15], v[24]); PIX_SORT(v[6], v[24]);  PIX_SORT(v[6], v[15]);
+	PIX_SORT(v[7], v[16]);  PIX_SORT(v[7], v[19]);  PIX_SORT(v[13], v[21]); PIX_SORT(v[15], v[23]);
+	PIX_SORT(v[7], v[13]);  PIX_SORT(v[7], v[15]);  PIX_SORT(v[1], v[9]);   PIX_SORT(v[3], v[11]);
+	PIX_SORT(v[5], v[17]);  PIX_SORT(v[11], v[17]); PIX_SORT(v[9], v[17]);  PIX_SORT(v[4], v[10]);
+	PIX_SORT(v[6], v[12]);  PIX_SORT(v[7], v[14]);  PIX_SORT(v[4], v[6]);   PIX_SORT(v[4], v[7]);
+	PIX_SORT(v[12], v[14]); PIX_SORT(v[10], v[14]); PIX_SORT(v[6], v[7]);   PIX_SORT(v[10], v[12]);
+	PIX_SORT(v[6], v[10]);  PIX_SORT(v[6], v[17]);  PIX_SORT(v[12], v[17]); PIX_SORT(v[7], v[17]);
+	PIX_SORT(v[7], v[10]);  PIX_SORT(v[12], v[18]); PIX_SORT(v[7], v[12]);  PIX_SORT(v[10], v[18]);
+	PIX_SORT(v[12], v[20]); PIX_SORT(v[10], v[20]); PIX_SORT(v[10], v[12]);
+	return v[12];
+}
+
+
+// Offset in bytes of pixel (x,y) in image with rows of iPitch bytes
+int PixelOffset(int x, int y, int iPitch, int nChannels)
+{
+	return mul24(y, iPitch) + mul24(x, nChannels);
+}
+
+// Offset of the batch image processed by work item, images of a batch are stored one after another.
+// Whole batch can be bigger than 2 GB, offset is computed in size_t.
+size_t ImageOffset(int iPitch, unsigned int uiDevImageHeight)
+{
+	return get_global_id(2) * (size_t)iPitch * uiDevImageHeight;
+}
 
 void LoadToLocalMemNew(__global uchar* ucSource,__local uchar* ucLocalData, int iLocalPixPitch, 
-                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels)
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
 {
 	    // Get parent image x and y pixel coordinates from global ID, and compute offset into parent GMEM data
 	    int iImagePosX = get_global_id(0);
 	    int iDevYPrime = get_global_id(1) - 1;  // Shift offset up 1 radius (1 row) for reads
-	    int iDevGMEMOffset = mul24(iDevYPrime, (int)get_global_size(0)) + iImagePosX; 
+	    int iDevGMEMOffset = PixelOffset(iImagePosX, iDevYPrime, iPitch, nChannels);
 
 	    // Compute initial offset of current pixel within work group LMEM block
 	    int iLocalPixOffset = mul24((int)get_local_id(1), iLocalPixPitch) + get_local_id(0) + 1;
@@ -83,7 +189,7 @@ void LoadToLocalMemNew(__global uchar* ucSource,__local uchar* ucLocalData, int
 			if (((iDevYPrime + get_local_size(1)) < uiDevImageHeight) && (iImagePosX < uiImageWidth))
 			{
 				// Read in top rows from the next block region down
-				GetData(ucSource,ucLocalData,iDevGMEMOffset + mul24(get_local_size(1), get_global_size(0)),iLocalPixOffset,nChannels);
+				GetData(ucSource,ucLocalData,iDevGMEMOffset + mul24((int)get_local_size(1), iPitch),iLocalPixOffset,nChannels);
 			}
 			else 
 			{
@@ -101,7 +207,7 @@ void LoadToLocalMemNew(__global uchar* ucSource,__local uchar* ucLocalData, int
 			if ((iDevYPrime >= 0) && (iDevYPrime < uiDevImageHeight) && (get_group_id(0) > 0))
 			{
 				// Read data into the LMEM apron from the GMEM at the left edge of the next block region over
-				GetData(ucSource,ucLocalData,mul24(iDevYPrime, (int)get_global_size(0)) + mul24(get_group_id(0), get_local_size(0)) - 1,iLocalPixOffset,nChannels);
+				GetData(ucSource,ucLocalData,PixelOffset(mul24(get_group_id(0), get_local_size(0)) - 1, iDevYPrime, iPitch, nChannels),iLocalPixOffset,nChannels);
 			}
 			else 
 			{
@@ -119,7 +225,7 @@ void LoadToLocalMemNew(__global uchar* ucSource,__local uchar* ucLocalData, int
 				if (((iDevYPrime + get_local_size(1)) < uiDevImageHeight) && (get_group_id(0) > 0))
 				{
 					// read in from GMEM (reaching down 1 workgroup LMEM block height and left 1 pixel)
-					GetData(ucSource,ucLocalData,mul24((iDevYPrime + (int)get_local_size(1)), (int)get_global_size(0)) + mul24(get_group_id(0), get_local_size(0)) - 1,iLocalPixOffset,nChannels);
+					GetData(ucSource,ucLocalData,PixelOffset(mul24(get_group_id(0), get_local_size(0)) - 1, iDevYPrime + (int)get_local_size(1), iPitch, nChannels),iLocalPixOffset,nChannels);
 				}
 				else 
 				{
@@ -135,7 +241,7 @@ void LoadToLocalMemNew(__global uchar* ucSource,__local uchar* ucLocalData, int
 			if ((iDevYPrime >= 0) && (iDevYPrime < uiDevImageHeight) && (mul24(((int)get_group_id(0) + 1), (int)get_local_size(0)) < uiImageWidth))
 			{
 				// read in from GMEM (reaching left 1 pixel) if source offset is within image boundaries
-				GetData(ucSource,ucLocalData,mul24(iDevYPrime, (int)get_global_size(0)) + mul24((get_group_id(0) + 1), get_local_size(0)),iLocalPixOffset,nChannels);
+				GetData(ucSource,ucLocalData,PixelOffset(mul24((get_group_id(0) + 1), get_local_size(0)), iDevYPrime, iPitch, nChannels),iLocalPixOffset,nChannels);
 			}
 			else 
 			{
@@ -151,7 +257,7 @@ void LoadToLocalMemNew(__global uchar* ucSource,__local uchar* ucLocalData, int
 				if (((iDevYPrime + get_local_size(1)) < uiDevImageHeight) && (mul24((get_group_id(0) + 1), get_local_size(0)) < uiImageWidth) )
 				{
 					// read in from GMEM (reaching down 1 workgroup LMEM block height and left 1 pixel) if source offset is within image boundaries
-					GetData(ucSource,ucLocalData,mul24((iDevYPrime + (int)get_local_size(1)), (int)get_global_size(0)) + mul24((get_group_id(0) + 1), get_local_size(0)),iLocalPixOffset,nChannels);
+					GetData(ucSource,ucLocalData,PixelOffset(mul24((get_group_id(0) + 1), get_local_size(0)), iDevYPrime + (int)get_local_size(1), iPitch, nChannels),iLocalPixOffset,nChannels);
 				}
 				else 
 				{
@@ -162,3 +268,38 @@ void LoadToLocalMemNew(__global uchar* ucSource,__local uchar* ucLocalData, int
 
         
 }
+
+// Tile of work-group with apron of iRadius pixels on each side, (local_size(0) + 2 * iRadius) x (local_size(1) + 2 * iRadius) pixels.
+// Work items load it together in row-major order, neighbouring work items read neighbouring pixels of a row.
+// Pixels outside of the image are zero like in LoadToLocalMemNew.
+void LoadTileToLocalMem(__global uchar* ucSource, __local uchar* ucLocalData, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	int iTilePitch = get_local_size(0) + 2 * iRadius;
+	int iTilePixels = mul24(iTilePitch, (int)get_local_size(1) + 2 * iRadius);
+	int iGroupSize = mul24((int)get_local_size(0), (int)get_local_size(1));
+	int iTileX = mul24((int)get_group_id(0), (int)get_local_size(0)) - iRadius;
+	int iTileY = mul24((int)get_group_id(1), (int)get_local_size(1)) - iRadius;
+
+	for( int i = mul24((int)get_local_id(1), (int)get_local_size(0)) + get_local_id(0) ; i < iTilePixels ; i += iGroupSize )
+	{
+		int x = iTileX + i % iTilePitch;
+		int y = iTileY + i / iTilePitch;
+		if( x >= 0 && y >= 0 && x < uiImageWidth && y < uiDevImageHeight )
+		{
+			GetData(ucSource, ucLocalData, PixelOffset(x, y, iPitch, nChannels), i, nChannels);
+		}
+		else
+		{
+			SetZERO(ucLocalData, i, nChannels);
+		}
+	}
+}
+
+// Pixel (dx, dy) away from pixel of work item, -iRadius <= dx, dy <= iRadius
+uchar4 GetDataFromTile(__local uchar* ucLocalData, int iRadius, int dx, int dy, int nChannels)
+{
+	int iTilePitch = get_local_size(0) + 2 * iRadius;
+	int iLocalPixOffset = mul24((int)get_local_id(1) + iRadius + dy, iTilePitch) + get_local_id(0) + iRadius + dx;
+	return GetDataFromLocalMemory(ucLocalData, iLocalPixOffset, nChannels);
+}
@@ -1,19 +1,23 @@
 
-__kernel void ckGradient(__global uchar* ucSource, __global int* maskGlobalH, __global int* maskGlobalV,
+__kernel void ckGradient(__global uchar* ucSource, __global uchar* ucDest, __global int* maskGlobalH, __global int* maskGlobalV,
                       __local uchar* ucLocalData, __local int* maskLocalH, __local int* maskLocalV, int iLocalPixPitch, 
-                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int channels)
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int channels, int iPitch)
 {
+	    // Image of the batch processed by this work item
+	    ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	    ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
 		int nChannels = channels;
 
-	    LoadToLocalMemNew(ucSource,ucLocalData, iLocalPixPitch, uiImageWidth, uiDevImageHeight,nChannels);
+	    LoadToLocalMemNew(ucSource,ucLocalData, iLocalPixPitch, uiImageWidth, uiDevImageHeight,nChannels, iPitch);
 	    
 
 	    barrier(CLK_LOCAL_MEM_FENCE);
 
 	    unsigned int isZero = 0;
 	    int iImagePosX = get_global_id(0);
-	    int iDevYPrime = get_global_id(1) - 1;  // Shift offset up 1 radius (1 row) for reads
-	    int iDevGMEMOffset = mul24(iDevYPrime, (int)get_global_size(0)) + iImagePosX;
+	    int iImagePosY = get_global_id(1);
+	    int iDevGMEMOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels);
 
 
 		int tmp = get_local_id(0);
@@ -21,7 +25,7 @@ __kernel void ckGradient(__global uchar* ucSource, __global int* maskGlobalH, __
 
 		if( size < 9 ) return;
 
-		if( get_local_id(1) == 0)
+		if( get_local_id(1) == 0 && tmp < 9 )
 		{
 			maskLocalH[tmp] = maskGlobalH[tmp];
 			maskLocalV[tmp] = maskGlobalV[tmp];
@@ -37,89 +41,19 @@ __kernel void ckGradient(__global uchar* ucSource, __global int* maskGlobalH, __
 	    float fVSum [3] = {0.0f, 0.0f, 0.0f};
 
 	    
-	    // set local offset
-	    
-	    int iLocalPixOffset = mul24((int)get_local_id(1), iLocalPixPitch) + get_local_id(0);
-
-
-
-	    // NW
-		fVSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalV[0];    
-		fVSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalV[0];    
-		fVSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalV[0];  
-		fHSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalH[0];    
-		fHSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalH[0];    
-		fHSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocalH[0];
-
-	    // N
-		fVSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalV[1];    
-		fVSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalV[1];    
-		fVSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalV[1];  
-		fHSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalH[1];    
-		fHSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalH[1];    
-		fHSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocalH[1];
-
-	    // NE
-		fVSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalV[2];    
-		fVSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalV[2];    
-		fVSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalV[2];  
-		fHSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalH[2];    
-		fHSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalH[2];    
-		fHSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalH[2];
-
-	    // increment LMEM block to next row, and unwind increments
-	    iLocalPixOffset += (iLocalPixPitch - 2);    
-		        
-	    // W
-		fVSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalV[3];    
-		fVSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalV[3];    
-		fVSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalV[3];  
-		fHSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalH[3];    
-		fHSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalH[3];    
-		fHSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocalH[3];
-
-	    // C
-	    fVSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalV[4];    
-		fVSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalV[4];    
-		fVSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalV[4];  
-		fHSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalH[4];    
-		fHSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalH[4];    
-		fHSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocalH[4];
-
-	    // E
-		fVSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalV[5];    
-		fVSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalV[5];    
-		fVSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalV[5];  
-		fHSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalH[5];    
-		fHSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalH[5];    
-		fHSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalH[5];
-
-	    // increment LMEM block to next row, and unwind increments
-	    iLocalPixOffset += (iLocalPixPitch - 2);    
-
-	    // SW
-		fVSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalV[6];    
-		fVSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalV[6];    
-		fVSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalV[6];  
-		fHSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalH[6];    
-		fHSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalH[6];    
-		fHSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocalH[6];
-
-	    // S
-		fVSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalV[7];    
-		fVSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalV[7];    
-		fVSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalV[7];  
-		fHSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalH[7];    
-		fHSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalH[7];    
-		fHSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocalH[7];
-
-	    // SE
-		fVSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalV[8];    
-		fVSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalV[8];    
-		fVSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalV[8];  
-		fHSum[0] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocalH[8];    
-		fHSum[1] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocalH[8];    
-		fHSum[2] +=  (float)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocalH[8];
+	    uchar4 v[9];
+	    GetWindowFromLocalMemory(ucLocalData, iLocalPixPitch, nChannels, v);
+
+	    // NW, N, NE, W, C, E, SW, S, SE
+	    for( int k = 0 ; k < 9 ; k++ )
+	    {
+		    fVSum[0] +=  (float)v[k].x*maskLocalV[k];
+		    fVSum[1] +=  (float)v[k].y*maskLocalV[k];
+		    fVSum[2] +=  (float)v[k].z*maskLocalV[k];
+		    fHSum[0] +=  (float)v[k].x*maskLocalH[k];
+		    fHSum[1] +=  (float)v[k].y*maskLocalH[k];
+		    fHSum[2] +=  (float)v[k].z*maskLocalH[k];
+	    }
 
 		// Weighted combination of Root-Sum-Square per-color-band H & V gradients for each of RGB
 		fTemp =  0.30f * sqrt((fHSum[0] * fHSum[0]) + (fVSum[0] * fVSum[0]));
@@ -144,9 +78,9 @@ __kernel void ckGradient(__global uchar* ucSource, __global int* maskGlobalH, __
 	    
 
 		// Write out to GMEM with restored offset
-	    if((iDevYPrime < uiDevImageHeight) && (iImagePosX < uiImageWidth))
+	    if((iImagePosY < uiDevImageHeight) && (iImagePosX < uiImageWidth))
 	    {
-		    setData(ucSource,pix.x ,pix.y, pix.z, iDevGMEMOffset,nChannels);
+		    setData(ucDest,pix.x ,pix.y, pix.z, iDevGMEMOffset,nChannels);
 	    }
 
 }
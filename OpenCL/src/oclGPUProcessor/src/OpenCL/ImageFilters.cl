@@ -0,0 +1,168 @@
+// 3x3 filters reading the image through samplers. Results are written to the pitched buffer like in the LMEM kernels.
+// Pixels outside of the image repeat the edge pixel, LMEM kernels read them as zero.
+
+__constant sampler_t EdgeSampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+
+// Pixel of CL_UNORM_INT8 image as bytes
+uchar4 ReadPixel(__read_only image2d_t image, int x, int y)
+{
+	return convert_uchar4_sat_rte(read_imagef(image, EdgeSampler, (int2)(x, y)) * 255.0f);
+}
+
+// 3x3 neighbourhood in order NW, N, NE, W, C, E, SW, S, SE
+void ReadWindow(__read_only image2d_t image, int x, int y, uchar4* v)
+{
+	for( int k = 0 ; k < 9 ; k++ )
+	{
+		v[k] = ReadPixel(image, x + k % 3 - 1, y + k / 3 - 1);
+	}
+}
+
+// Copy pitched buffer to image, fourth channel is opaque for 3-channel images
+__kernel void ckBufferToImage(__global uchar* ucSource, __write_only image2d_t imgDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	int iDevGMEMOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels);
+	uchar4 pix = GetDataFromGlobalMemory(ucSource, iDevGMEMOffset, nChannels);
+	if( nChannels != 4 ) pix.w = 255;
+	write_imagef(imgDest, (int2)(iImagePosX, iImagePosY), convert_float4(pix) * (1.0f / 255.0f));
+}
+
+__kernel void ckConvImage(__read_only image2d_t imgSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch,
+                      __constant int* mask)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 v[9];
+	ReadWindow(imgSource, iImagePosX, iImagePosY, v);
+
+	int4 iSum = (int4)(0);
+	int sum = 0;
+	for( int k = 0 ; k < 9 ; k++ )
+	{
+		iSum += convert_int4(v[k]) * mask[k];
+		sum += mask[k];
+	}
+	if( sum == 0 ) sum = 1;
+
+	int4 res = min(iSum / sum, (int4)(255));
+	setData(ucDest, (char)res.x, (char)res.y, (char)res.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+__kernel void ckGradientImage(__read_only image2d_t imgSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch,
+                      __constant int* maskH, __constant int* maskV)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 v[9];
+	ReadWindow(imgSource, iImagePosX, iImagePosY, v);
+
+	float4 fHSum = (float4)(0.0f);
+	float4 fVSum = (float4)(0.0f);
+	for( int k = 0 ; k < 9 ; k++ )
+	{
+		float4 pix = convert_float4(v[k]);
+		fHSum += pix * (float)maskH[k];
+		fVSum += pix * (float)maskV[k];
+	}
+
+	// Weighted combination of Root-Sum-Square per-color-band H & V gradients
+	float fTemp = 0.30f * sqrt((fHSum.x * fHSum.x) + (fVSum.x * fVSum.x));
+	fTemp += 0.30f * sqrt((fHSum.y * fHSum.y) + (fVSum.y * fVSum.y));
+	fTemp += 0.30f * sqrt((fHSum.z * fHSum.z) + (fVSum.z * fVSum.z));
+
+	uchar pix = (fTemp < 255.0f) ? (uchar)fTemp : 255;
+	setData(ucDest, pix, pix, pix, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+__kernel void ckMedianImage(__read_only image2d_t imgSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 v[9];
+	ReadWindow(imgSource, iImagePosX, iImagePosY, v);
+
+	uchar4 result = Median9(v);
+	setData(ucDest, result.x, result.y, result.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+__kernel void ckMinImage(__read_only image2d_t imgSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 v[9];
+	ReadWindow(imgSource, iImagePosX, iImagePosY, v);
+
+	uchar4 result = v[0];
+	for( int k = 1 ; k < 9 ; k++ ) result = min(result, v[k]);
+	setData(ucDest, result.x, result.y, result.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+__kernel void ckMaxImage(__read_only image2d_t imgSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 v[9];
+	ReadWindow(imgSource, iImagePosX, iImagePosY, v);
+
+	uchar4 result = v[0];
+	for( int k = 1 ; k < 9 ; k++ ) result = max(result, v[k]);
+	setData(ucDest, result.x, result.y, result.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+// Pixel is cleared if channel 0 of one of 8 neighbours is 0, like ckErode
+__kernel void ckErodeImage(__read_only image2d_t imgSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 v[9];
+	ReadWindow(imgSource, iImagePosX, iImagePosY, v);
+
+	uchar pix = 255;
+	for( int k = 0 ; k < 9 ; k++ )
+	{
+		if( k != 4 && v[k].x == 0 ) pix = 0;
+	}
+	setData(ucDest, pix, pix, pix, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+// Pixel is set if channel 1 of one of 8 neighbours is 255, like ckDilate
+__kernel void ckDilateImage(__read_only image2d_t imgSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 v[9];
+	ReadWindow(imgSource, iImagePosX, iImagePosY, v);
+
+	uchar pix = 0;
+	for( int k = 0 ; k < 9 ; k++ )
+	{
+		if( k != 4 && v[k].y == 255 ) pix = 255;
+	}
+	setData(ucDest, pix, pix, pix, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
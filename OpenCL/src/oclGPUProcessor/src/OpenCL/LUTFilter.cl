@@ -2,14 +2,17 @@
 
 
 
-__kernel void ckLUT(__global uchar* ucSource, __global int* LUT,
+__kernel void ckLUT(__global uchar* ucSource, __global uchar* ucDest, __global int* LUT,
                       __local uchar* ucLocalData, int iLocalPixPitch, 
-                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels)
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
 {
+	    // Image of the batch processed by this work item
+	    ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	    ucDest += ImageOffset(iPitch, uiDevImageHeight);
 		
 		int iImagePosX = get_global_id(0);
-	    int iDevYPrime = get_global_id(1) - 1;  // Shift offset up 1 radius (1 row) for reads
-	    int iDevGMEMOffset = mul24(iDevYPrime, (int)get_global_size(0)) + iImagePosX;
+	    int iImagePosY = get_global_id(1);
+	    int iDevGMEMOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels);
 
 		uchar4 input = GetDataFromGlobalMemory(ucSource,iDevGMEMOffset,nChannels);
 		input.x = LUT[input.x];
@@ -18,8 +21,8 @@ __kernel void ckLUT(__global uchar* ucSource, __global int* LUT,
 		
 
 		// Write out to GMEM with restored offset
-	    if((iDevYPrime < uiDevImageHeight) && (iImagePosX < uiImageWidth))
+	    if((iImagePosY < uiDevImageHeight) && (iImagePosX < uiImageWidth))
 	    {
-		     setData(ucSource,input.x ,input.y, input.z, iDevGMEMOffset,nChannels );
+		     setData(ucDest,input.x ,input.y, input.z, iDevGMEMOffset,nChannels );
 	    }
 }
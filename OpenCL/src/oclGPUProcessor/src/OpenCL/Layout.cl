@@ -0,0 +1,61 @@
+// Conversion between interleaved rows of host images and device layouts (LAYOUT_RGBA, LAYOUT_PLANAR).
+// nChannels is number of channels of interleaved side.
+
+// BGR to BGRA, fourth channel is opaque
+__kernel void ckExpandRGBA(__global uchar* ucSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int iSourcePitch, int iPitch, int nChannels)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 pix = GetDataFromGlobalMemory(ucSource, PixelOffset(iImagePosX, iImagePosY, iSourcePitch, nChannels), nChannels);
+	setData(ucDest, pix.x, pix.y, pix.z, PixelOffset(iImagePosX, iImagePosY, iPitch, 4), 4);
+}
+
+// BGRA to BGR, fourth channel is dropped
+__kernel void ckPackRGB(__global uchar* ucSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int iSourcePitch, int iPitch, int nChannels)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 pix = GetDataFromGlobalMemory(ucSource, PixelOffset(iImagePosX, iImagePosY, iSourcePitch, 4), 4);
+	setData(ucDest, pix.x, pix.y, pix.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+// Interleaved pixels to one plane per channel. Planes are stored one after another like images of a batch,
+// so kernels process them with the third NDRange dimension.
+__kernel void ckSplitPlanes(__global uchar* ucSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int iSourcePitch, int iPitch, int nChannels)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	int iSourceOffset = PixelOffset(iImagePosX, iImagePosY, iSourcePitch, nChannels);
+	int iDestOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, 1);
+	int iPlaneBytes = iPitch * (int)uiDevImageHeight;
+	for( int c = 0 ; c < nChannels ; c++ )
+	{
+		ucDest[iDestOffset + c * iPlaneBytes] = ucSource[iSourceOffset + c];
+	}
+}
+
+// Planes back to interleaved pixels
+__kernel void ckMergePlanes(__global uchar* ucSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int iSourcePitch, int iPitch, int nChannels)
+{
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	int iSourceOffset = PixelOffset(iImagePosX, iImagePosY, iSourcePitch, 1);
+	int iDestOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels);
+	int iPlaneBytes = iSourcePitch * (int)uiDevImageHeight;
+	for( int c = 0 ; c < nChannels ; c++ )
+	{
+		ucDest[iDestOffset + c] = ucSource[iSourceOffset + c * iPlaneBytes];
+	}
+}
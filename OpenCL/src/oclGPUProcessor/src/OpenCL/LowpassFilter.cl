@@ -1,24 +1,27 @@
 
 
-__kernel void ckConv(__global uchar* ucSource, __global unsigned int* maskGlobal,
+__kernel void ckConv(__global uchar* ucSource, __global uchar* ucDest, __global unsigned int* maskGlobal,
                       __local uchar* ucLocalData, __local unsigned int* maskLocal, int iLocalPixPitch, 
-                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels)
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
 {
+	    // Image of the batch processed by this work item
+	    ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	    ucDest += ImageOffset(iPitch, uiDevImageHeight);
 		
-	    LoadToLocalMemNew(ucSource,ucLocalData, iLocalPixPitch, uiImageWidth, uiDevImageHeight,nChannels);
+	    LoadToLocalMemNew(ucSource,ucLocalData, iLocalPixPitch, uiImageWidth, uiDevImageHeight,nChannels, iPitch);
 	    
 	    barrier(CLK_LOCAL_MEM_FENCE);
 
 		int iImagePosX = get_global_id(0);
-	    int iDevYPrime = get_global_id(1) - 1;  // Shift offset up 1 radius (1 row) for reads
-	    int iDevGMEMOffset = mul24(iDevYPrime, (int)get_global_size(0)) + iImagePosX;
+	    int iImagePosY = get_global_id(1);
+	    int iDevGMEMOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels);
 
 		int tmp = get_local_id(0);
 		int size = get_local_size(0);
 
 		if( size < 9 ) return;
 
-		if( get_local_id(1) == 0)
+		if( get_local_id(1) == 0 && tmp < 9 )
 		{
 			maskLocal[tmp] = maskGlobal[tmp];
 		}
@@ -31,61 +34,16 @@ __kernel void ckConv(__global uchar* ucSource, __global unsigned int* maskGlobal
 	    int fVSum [3] = {0, 0, 0};
 		int res[3] = {0, 0, 0};
 	    
-	    // set local offset
-	    
-	    int iLocalPixOffset = mul24((int)get_local_id(1), iLocalPixPitch) + get_local_id(0);
-		
-	    // NW
-	    fVSum[0] = fVSum[0] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocal[0];    
-		fVSum[1] = fVSum[1] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocal[0];    
-		fVSum[2] = fVSum[2] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocal[0];  
-
-	    // N
-	    fVSum[0] = fVSum[0] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocal[1];    
-		fVSum[1] = fVSum[1] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocal[1];    
-		fVSum[2] = fVSum[2] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocal[1];  
-
-	    // NE
-	    fVSum[0] = fVSum[0] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocal[2];    
-		fVSum[1] = fVSum[1] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocal[2];    
-		fVSum[2] = fVSum[2] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocal[2];  
-
-	    // increment LMEM block to next row, and unwind increments
-	    iLocalPixOffset += (iLocalPixPitch - 2);    
-		        
-	    // W
-	    fVSum[0] = fVSum[0] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocal[3];    
-		fVSum[1] = fVSum[1] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocal[3];    
-		fVSum[2] = fVSum[2] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocal[3]; 
-
-	    // C
-	    fVSum[0] = fVSum[0] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocal[4];    
-		fVSum[1] = fVSum[1] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocal[4];    
-		fVSum[2] = fVSum[2] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocal[4];  
-
-	    // E
-	    fVSum[0] = fVSum[0] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocal[5];    
-		fVSum[1] = fVSum[1] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocal[5];  
-		fVSum[2] = fVSum[2] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocal[5]; 
-
-	    // increment LMEM block to next row, and unwind increments
-	    iLocalPixOffset += (iLocalPixPitch - 2);    
-
-	    // SW
-	    fVSum[0] = fVSum[0] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocal[6];    
-		fVSum[1] = fVSum[1] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocal[6];   
-		fVSum[2] = fVSum[2] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocal[6]; 
-
-	    // S
-		fVSum[0] = fVSum[0] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocal[7];    
-		fVSum[1] = fVSum[1] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocal[7];   
-		fVSum[2] = fVSum[2] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset++,nChannels).z*maskLocal[7]; 
-
-	    // SE
-		fVSum[0] = fVSum[0] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x*maskLocal[8];    
-		fVSum[1] = fVSum[1] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y*maskLocal[8];   
-		fVSum[2] = fVSum[2] + (int)GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z*maskLocal[8]; 
+	    uchar4 v[9];
+	    GetWindowFromLocalMemory(ucLocalData, iLocalPixPitch, nChannels, v);
 
+	    // NW, N, NE, W, C, E, SW, S, SE
+	    for( int k = 0 ; k < 9 ; k++ )
+	    {
+		    fVSum[0] = fVSum[0] + (int)v[k].x*maskLocal[k];
+		    fVSum[1] = fVSum[1] + (int)v[k].y*maskLocal[k];
+		    fVSum[2] = fVSum[2] + (int)v[k].z*maskLocal[k];
+	    }
 		
 		int sum = 0;
 		for( int i = 0 ; i < 9 ; i++)
@@ -102,10 +60,10 @@ __kernel void ckConv(__global uchar* ucSource, __global unsigned int* maskGlobal
 
 	
 	    // Write out to GMEM with restored offset
-	    if((iDevYPrime < uiDevImageHeight) && (iImagePosX < uiImageWidth))
+	    if((iImagePosY < uiDevImageHeight) && (iImagePosX < uiImageWidth))
 	    {
 		    //setData(ucSource,(char)res[0] ,(char)res[1], (char)res[2], iDevGMEMOffset );
-			setData(ucSource,(char)res[0] ,(char)res[1], (char)res[2], iDevGMEMOffset ,nChannels);
+			setData(ucDest,(char)res[0] ,(char)res[1], (char)res[2], iDevGMEMOffset ,nChannels);
 	    }
 	
 
@@ -1,84 +1,44 @@
-﻿__kernel void ckMax(__global uchar* ucSource,
+﻿__kernel void ckMax(__global uchar* ucSource, __global uchar* ucDest,
                       __local uchar* ucLocalData, int iLocalPixPitch, 
-                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels)
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
 {
+	    // Image of the batch processed by this work item
+	    ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	    ucDest += ImageOffset(iPitch, uiDevImageHeight);
 	
-	LoadToLocalMemNew(ucSource,ucLocalData, iLocalPixPitch, uiImageWidth, uiDevImageHeight,nChannels);
+	LoadToLocalMemNew(ucSource,ucLocalData, iLocalPixPitch, uiImageWidth, uiDevImageHeight,nChannels, iPitch);
 	    
 	barrier(CLK_LOCAL_MEM_FENCE);
 
 	int iImagePosX = get_global_id(0);
-	int iDevYPrime = get_global_id(1) - 1;  // Shift offset up 1 radius (1 row) for reads
-	int iDevGMEMOffset = mul24(iDevYPrime, (int)get_global_size(0)) + iImagePosX;
+	int iImagePosY = get_global_id(1);
+	int iDevGMEMOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels);
     int fMiximalEstimate[3] = { 0, 0, 0};
     
-    // set local offset and kernel offset
-    int iLocalPixOffset = mul24((int)get_local_id(1), iLocalPixPitch) + get_local_id(0);
+    uchar4 v[9];
+    GetWindowFromLocalMemory(ucLocalData, iLocalPixPitch, nChannels, v);
 
 	// Row1 Left Pix (RGB)
-	fMiximalEstimate[0] = GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x;					// red
-	fMiximalEstimate[1] = GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y;				    // green
-	fMiximalEstimate[2] = GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z;				    //blue
-    ++iLocalPixOffset;
+	fMiximalEstimate[0] = v[0].x;					// red
+	fMiximalEstimate[1] = v[0].y;				    // green
+	fMiximalEstimate[2] = v[0].z;				    //blue
 
-	// Row1 Middle Pix (RGB)
-    fMiximalEstimate[0] = fMiximalEstimate[0] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMiximalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMiximalEstimate[1] = fMiximalEstimate[1] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMiximalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMiximalEstimate[2] = fMiximalEstimate[2] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMiximalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;	
-    ++iLocalPixOffset;
-
-	// Row1 Right Pix (RGB)
-	fMiximalEstimate[0] = fMiximalEstimate[0] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMiximalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMiximalEstimate[1] = fMiximalEstimate[1] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMiximalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMiximalEstimate[2] = fMiximalEstimate[2] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMiximalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;						
-
-	// set the offset into SMEM for next row
-	iLocalPixOffset += (iLocalPixPitch - 2);	
-
-	// Row2 Left Pix (RGB)
-	fMiximalEstimate[0] = fMiximalEstimate[0] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMiximalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMiximalEstimate[1] = fMiximalEstimate[1] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMiximalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMiximalEstimate[2] = fMiximalEstimate[2] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMiximalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;	
-    ++iLocalPixOffset;				
-
-	// Row2 Middle Pix (RGB)
-	fMiximalEstimate[0] = fMiximalEstimate[0] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMiximalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMiximalEstimate[1] = fMiximalEstimate[1] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMiximalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMiximalEstimate[2] = fMiximalEstimate[2] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMiximalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;		
-    ++iLocalPixOffset;				
-
-	// Row2 Right Pix (RGB)
-	fMiximalEstimate[0] = fMiximalEstimate[0] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMiximalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMiximalEstimate[1] = fMiximalEstimate[1] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMiximalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMiximalEstimate[2] = fMiximalEstimate[2] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMiximalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;					
-
-	// set the offset into SMEM for next row
-	iLocalPixOffset += (iLocalPixPitch - 2);	
-
-	// Row3 Left Pix (RGB)
-	fMiximalEstimate[0] = fMiximalEstimate[0] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMiximalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMiximalEstimate[1] = fMiximalEstimate[1] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMiximalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMiximalEstimate[2] = fMiximalEstimate[2] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMiximalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;		
-    ++iLocalPixOffset;					
-
-	// Row3 Middle Pix (RGB)
-	fMiximalEstimate[0] = fMiximalEstimate[0] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMiximalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMiximalEstimate[1] = fMiximalEstimate[1] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMiximalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMiximalEstimate[2] = fMiximalEstimate[2] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMiximalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;	
-    ++iLocalPixOffset;			
+	// Remaining 8 pixels of the window
+	for( int k = 1 ; k < 9 ; k++ )
+	{
+		fMiximalEstimate[0] = max(fMiximalEstimate[0], (int)v[k].x);
+		fMiximalEstimate[1] = max(fMiximalEstimate[1], (int)v[k].y);
+		fMiximalEstimate[2] = max(fMiximalEstimate[2], (int)v[k].z);
+	}
 
-	// Row3 Right Pix (RGB)
-	fMiximalEstimate[0] = fMiximalEstimate[0] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMiximalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMiximalEstimate[1] = fMiximalEstimate[1] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMiximalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMiximalEstimate[2] = fMiximalEstimate[2] > GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMiximalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;
 
     uchar4 result;
 	result.x = (char)fMiximalEstimate[0];
 	result.y = (char)fMiximalEstimate[1];
 	result.z = (char)fMiximalEstimate[2];
 
-	if((iDevYPrime < uiDevImageHeight) && (iImagePosX < uiImageWidth))
+	if((iImagePosY < uiDevImageHeight) && (iImagePosX < uiImageWidth))
 	{
-		    setData(ucSource,result.x ,result.y, result.z, iDevGMEMOffset ,nChannels);
+		    setData(ucDest,result.x ,result.y, result.z, iDevGMEMOffset ,nChannels);
 	}
 }
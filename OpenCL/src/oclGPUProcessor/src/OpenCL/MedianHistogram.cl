@@ -0,0 +1,97 @@
+// Median of (2 * iRadius + 1)^2 window from histogram sliding along a segment of a row (Huang).
+// Each work item keeps 256 fine and 16 coarse counters per channel in local memory. The first window of a segment
+// is counted in full, then one column enters and one leaves per step, so cost per pixel is 2 * (2 * iRadius + 1)
+// updates and at most 32 bins searched instead of a pass over the whole window.
+// Pixels outside of the image are zero like in ckMedianR, result is the exact median.
+
+#define HIST_BINS 256
+#define HIST_COARSE 16
+#define HIST_SIZE (HIST_BINS + HIST_COARSE)
+
+uchar4 GetPixelOrZero(__global uchar* ucSource, int x, int y, unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	if( x < 0 || x >= uiImageWidth || y < 0 || y >= uiDevImageHeight ) return (uchar4)(0);
+	return GetDataFromGlobalMemory(ucSource, PixelOffset(x, y, iPitch, nChannels), nChannels);
+}
+
+void HistogramAdd(__local ushort* usHist, uchar ucValue, int iDelta)
+{
+	usHist[ucValue] += iDelta;
+	usHist[HIST_BINS + (ucValue >> 4)] += iDelta;
+}
+
+// Add (iDelta = 1) or remove (iDelta = -1) column x of the window around row y
+void HistogramColumn(__local ushort* usHist, int nPlanes, __global uchar* ucSource, int x, int y, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch, int iDelta)
+{
+	// Column outside of the image is all zero
+	if( x < 0 || x >= uiImageWidth )
+	{
+		for( int p = 0 ; p < nPlanes ; p++ )
+		{
+			usHist[mul24(p, HIST_SIZE)] += iDelta * (2 * iRadius + 1);
+			usHist[mul24(p, HIST_SIZE) + HIST_BINS] += iDelta * (2 * iRadius + 1);
+		}
+		return;
+	}
+
+	for( int dy = -iRadius ; dy <= iRadius ; dy++ )
+	{
+		uchar4 pix = GetPixelOrZero(ucSource, x, y + dy, uiImageWidth, uiDevImageHeight, nChannels, iPitch);
+		HistogramAdd(usHist, pix.x, iDelta);
+		if( nPlanes == 1 ) continue;
+		HistogramAdd(usHist + HIST_SIZE, pix.y, iDelta);
+		HistogramAdd(usHist + 2 * HIST_SIZE, pix.z, iDelta);
+	}
+}
+
+// Level of value with rank iRank (from 0) in the histogram, coarse counters skip 16 levels at once
+uchar HistogramMedian(__local ushort* usHist, int iRank)
+{
+	int iCount = 0;
+	int iBin = 0;
+	while( iCount + usHist[HIST_BINS + iBin] <= iRank ) iCount += usHist[HIST_BINS + iBin++];
+
+	iBin <<= 4;
+	while( iCount + usHist[iBin] <= iRank ) iCount += usHist[iBin++];
+	return iBin;
+}
+
+// Work item (segment, row, image of batch). usHistograms holds HIST_SIZE counters per written channel for every
+// work item of the group, 1 channel for planar images and 3 otherwise.
+__kernel void ckMedianHistogram(__global uchar* ucSource, __global uchar* ucDest, __local ushort* usHistograms, int iRadius, int iSegment,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	int nPlanes = (nChannels == 1) ? 1 : 3;
+	__local ushort* usHist = usHistograms + mul24((int)get_local_id(0), nPlanes * HIST_SIZE);
+
+	int x0 = mul24((int)get_global_id(0), iSegment);
+	int y = get_global_id(1);
+	if( x0 >= uiImageWidth || y >= uiDevImageHeight ) return;
+	int x1 = min(x0 + iSegment, (int)uiImageWidth);
+
+	for( int i = 0 ; i < nPlanes * HIST_SIZE ; i++ ) usHist[i] = 0;
+	for( int x = x0 - iRadius ; x <= x0 + iRadius ; x++ )
+	{
+		HistogramColumn(usHist, nPlanes, ucSource, x, y, iRadius, uiImageWidth, uiDevImageHeight, nChannels, iPitch, 1);
+	}
+
+	int iRank = (2 * iRadius + 1) * (2 * iRadius + 1) / 2;
+	for( int x = x0 ; x < x1 ; x++ )
+	{
+		uchar4 res = (uchar4)(HistogramMedian(usHist, iRank));
+		if( nPlanes == 3 )
+		{
+			res.y = HistogramMedian(usHist + HIST_SIZE, iRank);
+			res.z = HistogramMedian(usHist + 2 * HIST_SIZE, iRank);
+		}
+		setData(ucDest, (char)res.x, (char)res.y, (char)res.z, PixelOffset(x, y, iPitch, nChannels), nChannels);
+
+		if( x + 1 == x1 ) break;
+		HistogramColumn(usHist, nPlanes, ucSource, x + iRadius + 1, y, iRadius, uiImageWidth, uiDevImageHeight, nChannels, iPitch, 1);
+		HistogramColumn(usHist, nPlanes, ucSource, x - iRadius, y, iRadius, uiImageWidth, uiDevImageHeight, nChannels, iPitch, -1);
+	}
+}
@@ -1,76 +1,35 @@
-﻿__kernel void ckMin(__global uchar* ucSource,
+﻿__kernel void ckMin(__global uchar* ucSource, __global uchar* ucDest,
                       __local uchar* ucLocalData, int iLocalPixPitch, 
-                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels)
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
 {
+	    // Image of the batch processed by this work item
+	    ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	    ucDest += ImageOffset(iPitch, uiDevImageHeight);
 	
-	LoadToLocalMemNew(ucSource,ucLocalData, iLocalPixPitch, uiImageWidth, uiDevImageHeight,nChannels);
+	LoadToLocalMemNew(ucSource,ucLocalData, iLocalPixPitch, uiImageWidth, uiDevImageHeight,nChannels, iPitch);
 	    
 	barrier(CLK_LOCAL_MEM_FENCE);
 
 	int iImagePosX = get_global_id(0);
-	int iDevYPrime = get_global_id(1) - 1;  // Shift offset up 1 radius (1 row) for reads
-	int iDevGMEMOffset = mul24(iDevYPrime, (int)get_global_size(0)) + iImagePosX;
+	int iImagePosY = get_global_id(1);
+	int iDevGMEMOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels);
     int fMinimalEstimate[3] = { 0, 0, 0};
     
-    // set local offset and kernel offset
-    int iLocalPixOffset = mul24((int)get_local_id(1), iLocalPixPitch) + get_local_id(0);
+    uchar4 v[9];
+    GetWindowFromLocalMemory(ucLocalData, iLocalPixPitch, nChannels, v);
 
 	// Row1 Left Pix (RGB)
-	fMinimalEstimate[0] = GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x;					// red
-	fMinimalEstimate[1] = GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y;				    // green
-	fMinimalEstimate[2] = GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z;				    //blue
-    ++iLocalPixOffset;
+	fMinimalEstimate[0] = v[0].x;					// red
+	fMinimalEstimate[1] = v[0].y;				    // green
+	fMinimalEstimate[2] = v[0].z;				    //blue
 
-	// Row1 Middle Pix (RGB)
-    fMinimalEstimate[0] = fMinimalEstimate[0] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMinimalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMinimalEstimate[1] = fMinimalEstimate[1] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMinimalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMinimalEstimate[2] = fMinimalEstimate[2] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMinimalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;	
-    ++iLocalPixOffset;
-
-	// Row1 Right Pix (RGB)
-	fMinimalEstimate[0] = fMinimalEstimate[0] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMinimalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMinimalEstimate[1] = fMinimalEstimate[1] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMinimalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMinimalEstimate[2] = fMinimalEstimate[2] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMinimalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;						
-
-	// set the offset into SMEM for next row
-	iLocalPixOffset += (iLocalPixPitch - 2);	
-
-	// Row2 Left Pix (RGB)
-	fMinimalEstimate[0] = fMinimalEstimate[0] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMinimalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMinimalEstimate[1] = fMinimalEstimate[1] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMinimalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMinimalEstimate[2] = fMinimalEstimate[2] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMinimalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;	
-    ++iLocalPixOffset;				
-
-	// Row2 Middle Pix (RGB)
-	fMinimalEstimate[0] = fMinimalEstimate[0] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMinimalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMinimalEstimate[1] = fMinimalEstimate[1] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMinimalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMinimalEstimate[2] = fMinimalEstimate[2] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMinimalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;		
-    ++iLocalPixOffset;				
-
-	// Row2 Right Pix (RGB)
-	fMinimalEstimate[0] = fMinimalEstimate[0] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMinimalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMinimalEstimate[1] = fMinimalEstimate[1] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMinimalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMinimalEstimate[2] = fMinimalEstimate[2] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMinimalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;					
-
-	// set the offset into SMEM for next row
-	iLocalPixOffset += (iLocalPixPitch - 2);	
-
-	// Row3 Left Pix (RGB)
-	fMinimalEstimate[0] = fMinimalEstimate[0] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMinimalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMinimalEstimate[1] = fMinimalEstimate[1] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMinimalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMinimalEstimate[2] = fMinimalEstimate[2] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMinimalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;		
-    ++iLocalPixOffset;					
-
-	// Row3 Middle Pix (RGB)
-	fMinimalEstimate[0] = fMinimalEstimate[0] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMinimalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMinimalEstimate[1] = fMinimalEstimate[1] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMinimalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMinimalEstimate[2] = fMinimalEstimate[2] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMinimalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;	
-    ++iLocalPixOffset;			
-
-	// Row3 Right Pix (RGB)
-	fMinimalEstimate[0] = fMinimalEstimate[0] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ? fMinimalEstimate[0] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).x ;					
-	fMinimalEstimate[1] = fMinimalEstimate[1] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ? fMinimalEstimate[1] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).y ;						
-	fMinimalEstimate[2] = fMinimalEstimate[2] < GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ? fMinimalEstimate[2] : GetDataFromLocalMemory(ucLocalData,iLocalPixOffset,nChannels).z ;					
+	// Remaining 8 pixels of the window
+	for( int k = 1 ; k < 9 ; k++ )
+	{
+		fMinimalEstimate[0] = min(fMinimalEstimate[0], (int)v[k].x);
+		fMinimalEstimate[1] = min(fMinimalEstimate[1], (int)v[k].y);
+		fMinimalEstimate[2] = min(fMinimalEstimate[2], (int)v[k].z);
+	}
 
 
     uchar4 result;
@@ -79,8 +38,8 @@
 	result.z = (char)fMinimalEstimate[2];
 
 	// Write out to GMEM with restored offset
-	if((iDevYPrime < uiDevImageHeight) && (iImagePosX < uiImageWidth))
+	if((iImagePosY < uiDevImageHeight) && (iImagePosX < uiImageWidth))
 	{
-		    setData(ucSource,result.x ,result.y, result.z, iDevGMEMOffset,nChannels );
+		    setData(ucDest,result.x ,result.y, result.z, iDevGMEMOffset,nChannels );
 	}
 }
@@ -1,13 +1,18 @@
 ﻿
-__kernel void ckRGB2HSV(__global uchar4* ucSource,
-                      unsigned int uiImageWidth, unsigned int uiDevImageHeight)
+__kernel void ckRGB2HSV(__global uchar* ucSource, __global uchar* ucDest,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int iPitch)
 {
 		int nChannels = 3;
+
+	    // Image of the batch processed by this work item
+	    ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	    ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
 		int iImagePosX = get_global_id(0);
-	    int iDevYPrime = get_global_id(1) - 1;  // Shift offset up 1 radius (1 row) for reads
-	    int iDevGMEMOffset = mul24(iDevYPrime, (int)get_global_size(0)) + iImagePosX;
+	    int iImagePosY = get_global_id(1);
+	    int iDevGMEMOffset = PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels);
 
-		uchar4 pix = ucSource[iDevGMEMOffset];
+		uchar4 pix = GetDataFromGlobalMemory(ucSource, iDevGMEMOffset, nChannels);
 		float R = (float)pix.x;
 		float G = (float)pix.y;
 		float B = (float)pix.z;
@@ -23,9 +28,9 @@ __kernel void ckRGB2HSV(__global uchar4* ucSource,
 		pix.z = (char)V;
 
 		// Write out to GMEM with restored offset
-	    if((iDevYPrime < uiDevImageHeight) && (iImagePosX < uiImageWidth))
+	    if((iImagePosY < uiDevImageHeight) && (iImagePosX < uiImageWidth))
 	    {
-		     setData(ucSource,pix.x ,pix.y, pix.z, iDevGMEMOffset,nChannels );
+		     setData(ucDest,pix.x ,pix.y, pix.z, iDevGMEMOffset,nChannels );
 	    }
 		
 }
\ No newline at end of file
@@ -0,0 +1,73 @@
+// Minimum (erosion) or maximum (dilation) over a line of iLength pixels by van Herk/Gil-Werman, one pass per axis.
+// Window of output p is [p - iBefore, p - iBefore + iLength - 1]. Each work item handles one block of iLength outputs:
+// extremum of the block suffix is written to the output first, then the prefix of the next block completes the
+// windows, about 3 comparisons per pixel whatever the length. Pixels outside of the image are neutral
+// (255 for minimum, 0 for maximum) so borders are not eroded or dilated from outside.
+
+uchar4 Extremum(uchar4 a, uchar4 b, int iMax)
+{
+	return iMax ? max(a, b) : min(a, b);
+}
+
+// Pixel p of a line with pixels iStride bytes apart, neutral outside of the line
+uchar4 LinePixel(__global uchar* ucLine, int p, int iCount, int iStride, int nChannels, int iMax)
+{
+	if( p < 0 || p >= iCount ) return (uchar4)(iMax ? 0 : 255);
+	return GetDataFromGlobalMemory(ucLine, mul24(p, iStride), nChannels);
+}
+
+// Outputs [iStart, min(iStart + iLength, iCount)) of one line
+void VanHerkBlock(__global uchar* ucSource, __global uchar* ucDest, int iStart, int iLength, int iBefore,
+                      int iCount, int iStride, int nChannels, int iMax)
+{
+	int iEnd = min(iStart + iLength, iCount);
+	int k0 = iStart - iBefore;
+
+	// Suffix extremum of [s, k0 + iLength) is written at output of window starting at s
+	uchar4 acc = (uchar4)(iMax ? 0 : 255);
+	for( int s = k0 + iLength - 1 ; s >= k0 ; s-- )
+	{
+		acc = Extremum(acc, LinePixel(ucSource, s, iCount, iStride, nChannels, iMax), iMax);
+		int p = s + iBefore;
+		if( p < iEnd ) setData(ucDest, (char)acc.x, (char)acc.y, (char)acc.z, mul24(p, iStride), nChannels);
+	}
+
+	// Prefix extremum of [k0 + iLength, t] completes window ending at t
+	acc = (uchar4)(iMax ? 0 : 255);
+	for( int t = k0 + iLength ; t < k0 + 2 * iLength - 1 ; t++ )
+	{
+		int p = t - iLength + 1 + iBefore;
+		if( p >= iEnd ) break;
+		acc = Extremum(acc, LinePixel(ucSource, t, iCount, iStride, nChannels, iMax), iMax);
+		uchar4 res = Extremum(GetDataFromGlobalMemory(ucDest, mul24(p, iStride), nChannels), acc, iMax);
+		setData(ucDest, (char)res.x, (char)res.y, (char)res.z, mul24(p, iStride), nChannels);
+	}
+}
+
+// Work item (block, row, image of batch)
+__kernel void ckRectRows(__global uchar* ucSource, __global uchar* ucDest, int iLength, int iBefore, int iMax,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	int x0 = mul24((int)get_global_id(0), iLength);
+	int y = get_global_id(1);
+	if( x0 >= uiImageWidth || y >= uiDevImageHeight ) return;
+
+	VanHerkBlock(ucSource + mul24(y, iPitch), ucDest + mul24(y, iPitch), x0, iLength, iBefore, uiImageWidth, nChannels, nChannels, iMax);
+}
+
+// Work item (column, block, image of batch), neighbouring work items read neighbouring pixels
+__kernel void ckRectColumns(__global uchar* ucSource, __global uchar* ucDest, int iLength, int iBefore, int iMax,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	int x = get_global_id(0);
+	int y0 = mul24((int)get_global_id(1), iLength);
+	if( x >= uiImageWidth || y0 >= uiDevImageHeight ) return;
+
+	VanHerkBlock(ucSource + mul24(x, nChannels), ucDest + mul24(x, nChannels), y0, iLength, iBefore, uiDevImageHeight, iPitch, nChannels, iMax);
+}
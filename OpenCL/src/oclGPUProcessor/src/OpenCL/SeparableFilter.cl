@@ -0,0 +1,103 @@
+// Separable convolution in two passes. Row pass writes sums of row taps to dense float buffer, column pass
+// convolves them with column taps and rounds once. Each pass stages a tile with apron of iRadius pixels along
+// its own axis only. Pixels outside of the image repeat the edge pixel, large blurs don't darken the borders.
+
+// Pixel of dense float image with nChannels floats per pixel
+float4 GetFloatData(__global float* data, int iOffset, int nChannels)
+{
+	if( nChannels == 4 ) return vload4(0, data + iOffset);
+	if( nChannels == 1 ) return (float4)(data[iOffset]);
+
+	float4 pix = (float4)(0.0f);
+	pix.x = data[iOffset];
+	pix.y = data[iOffset+1];
+	pix.z = data[iOffset+2];
+	return pix;
+}
+
+void SetFloatData(__global float* data, float4 pix, int iOffset, int nChannels)
+{
+	if( nChannels == 4 )
+	{
+		vstore4(pix, 0, data + iOffset);
+		return;
+	}
+	data[iOffset] = pix.x;
+	if( nChannels == 1 ) return;
+	data[iOffset+1] = pix.y;
+	data[iOffset+2] = pix.z;
+}
+
+// Tile is (local_size(0) + 2 * iRadius) x local_size(1) pixels
+__kernel void ckSeparableRow(__global uchar* ucSource, __global float* fDest, __constant float* fCoeffs,
+                      __local uchar* ucLocalData, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	fDest += get_global_id(2) * (size_t)uiImageWidth * uiDevImageHeight * nChannels;
+
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	int iLocalPixPitch = get_local_size(0) + 2 * iRadius;
+	int iLocalRow = mul24((int)get_local_id(1), iLocalPixPitch);
+
+	// Rows below the image load the last row, they are not written
+	int iSourceY = min(iImagePosY, (int)uiDevImageHeight - 1);
+	int iTileX = mul24((int)get_group_id(0), (int)get_local_size(0)) - iRadius;
+	for( int i = get_local_id(0) ; i < iLocalPixPitch ; i += get_local_size(0) )
+	{
+		int iSourceX = clamp(iTileX + i, 0, (int)uiImageWidth - 1);
+		GetData(ucSource, ucLocalData, PixelOffset(iSourceX, iSourceY, iPitch, nChannels), iLocalRow + i, nChannels);
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	float4 fSum = (float4)(0.0f);
+	int iLocalPixOffset = iLocalRow + get_local_id(0);
+	for( int k = 0 ; k <= 2 * iRadius ; k++ )
+	{
+		fSum += convert_float4(GetDataFromLocalMemory(ucLocalData, iLocalPixOffset + k, nChannels)) * fCoeffs[k];
+	}
+
+	SetFloatData(fDest, fSum, mul24(mul24(iImagePosY, (int)uiImageWidth) + iImagePosX, nChannels), nChannels);
+}
+
+// Tile is local_size(0) x (local_size(1) + 2 * iRadius) pixels
+__kernel void ckSeparableColumn(__global float* fSource, __global uchar* ucDest, __constant float* fCoeffs,
+                      __local float4* fLocalData, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	fSource += get_global_id(2) * (size_t)uiImageWidth * uiDevImageHeight * nChannels;
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	int iLocalWidth = get_local_size(0);
+	int iLocalHeight = get_local_size(1) + 2 * iRadius;
+
+	// Columns right of the image load the last column, they are not written
+	int iSourceX = min(iImagePosX, (int)uiImageWidth - 1);
+	int iTileY = mul24((int)get_group_id(1), (int)get_local_size(1)) - iRadius;
+	for( int i = get_local_id(1) ; i < iLocalHeight ; i += get_local_size(1) )
+	{
+		int iSourceY = clamp(iTileY + i, 0, (int)uiDevImageHeight - 1);
+		fLocalData[mul24(i, iLocalWidth) + get_local_id(0)] = GetFloatData(fSource, mul24(mul24(iSourceY, (int)uiImageWidth) + iSourceX, nChannels), nChannels);
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	float4 fSum = (float4)(0.0f);
+	int iLocalPixOffset = mul24((int)get_local_id(1), iLocalWidth) + get_local_id(0);
+	for( int k = 0 ; k <= 2 * iRadius ; k++ )
+	{
+		fSum += fLocalData[iLocalPixOffset] * fCoeffs[k];
+		iLocalPixOffset += iLocalWidth;
+	}
+
+	uchar4 res = convert_uchar4_sat_rte(fSum);
+	setData(ucDest, (char)res.x, (char)res.y, (char)res.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
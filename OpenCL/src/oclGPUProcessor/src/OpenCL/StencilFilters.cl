@@ -0,0 +1,200 @@
+// Neighbourhood filters with window of (2 * iRadius + 1) x (2 * iRadius + 1) pixels, used for radius > 1.
+// Tile with apron is loaded by LoadTileToLocalMem, pixels outside of the image are zero like in the 3x3 kernels.
+// Arguments after the common ones (source, output, tile, radius, width, height, channels, pitch) are filter specific.
+
+// Exact median of window. 5x5 goes through Median25 network, larger windows bisect 256 levels in 8 steps,
+// MedianFilter runs ckMedianHistogram instead when histograms fit in local memory.
+__kernel void ckMedianR(__global uchar* ucSource, __global uchar* ucDest, __local uchar* ucLocalData, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	LoadTileToLocalMem(ucSource, ucLocalData, iRadius, uiImageWidth, uiDevImageHeight, nChannels, iPitch);
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 res;
+	if( iRadius == 2 )
+	{
+		uchar4 v[25];
+		int k = 0;
+		for( int dy = -2 ; dy <= 2 ; dy++ )
+		{
+			for( int dx = -2 ; dx <= 2 ; dx++ )
+			{
+				v[k++] = GetDataFromTile(ucLocalData, iRadius, dx, dy, nChannels);
+			}
+		}
+		res = Median25(v);
+	}
+	else
+	{
+		// Median is the smallest level with more than half of the window at or below it
+		int iSide = 2 * iRadius + 1;
+		int4 iHalf = (int4)(iSide * iSide / 2);
+		int4 iLow = (int4)(0);
+		int4 iHigh = (int4)(255);
+		for( int iSearch = 0 ; iSearch < 8 ; iSearch++ )
+		{
+			int4 iMid = (iLow + iHigh) >> 1;
+
+			// Vector comparison is -1 where true
+			int4 iCount = (int4)(0);
+			for( int dy = -iRadius ; dy <= iRadius ; dy++ )
+			{
+				for( int dx = -iRadius ; dx <= iRadius ; dx++ )
+				{
+					iCount -= convert_int4(GetDataFromTile(ucLocalData, iRadius, dx, dy, nChannels)) <= iMid;
+				}
+			}
+
+			int4 iFound = iCount > iHalf;
+			iHigh = select(iHigh, iMid, iFound);
+			iLow = select(iMid + 1, iLow, iFound);
+		}
+		res = convert_uchar4(iLow);
+	}
+
+	setData(ucDest, (char)res.x, (char)res.y, (char)res.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+__kernel void ckMinR(__global uchar* ucSource, __global uchar* ucDest, __local uchar* ucLocalData, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	LoadTileToLocalMem(ucSource, ucLocalData, iRadius, uiImageWidth, uiDevImageHeight, nChannels, iPitch);
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 res = (uchar4)(255);
+	for( int dy = -iRadius ; dy <= iRadius ; dy++ )
+	{
+		for( int dx = -iRadius ; dx <= iRadius ; dx++ )
+		{
+			res = min(res, GetDataFromTile(ucLocalData, iRadius, dx, dy, nChannels));
+		}
+	}
+
+	setData(ucDest, (char)res.x, (char)res.y, (char)res.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+__kernel void ckMaxR(__global uchar* ucSource, __global uchar* ucDest, __local uchar* ucLocalData, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	LoadTileToLocalMem(ucSource, ucLocalData, iRadius, uiImageWidth, uiDevImageHeight, nChannels, iPitch);
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar4 res = (uchar4)(0);
+	for( int dy = -iRadius ; dy <= iRadius ; dy++ )
+	{
+		for( int dx = -iRadius ; dx <= iRadius ; dx++ )
+		{
+			res = max(res, GetDataFromTile(ucLocalData, iRadius, dx, dy, nChannels));
+		}
+	}
+
+	setData(ucDest, (char)res.x, (char)res.y, (char)res.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+// Binary erosion tests channel 0 of the window for 0 like ckErode, centre is skipped
+__kernel void ckErodeR(__global uchar* ucSource, __global uchar* ucDest, __local uchar* ucLocalData, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	LoadTileToLocalMem(ucSource, ucLocalData, iRadius, uiImageWidth, uiDevImageHeight, nChannels, iPitch);
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar pix = 255;
+	for( int dy = -iRadius ; dy <= iRadius ; dy++ )
+	{
+		for( int dx = -iRadius ; dx <= iRadius ; dx++ )
+		{
+			if( (dx != 0 || dy != 0) && GetDataFromTile(ucLocalData, iRadius, dx, dy, nChannels).x == 0 ) pix = 0;
+		}
+	}
+
+	setData(ucDest, (char)pix, (char)pix, (char)pix, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+// Binary dilation tests channel 1 of the window for 255 like ckDilate, centre is skipped
+__kernel void ckDilateR(__global uchar* ucSource, __global uchar* ucDest, __local uchar* ucLocalData, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	LoadTileToLocalMem(ucSource, ucLocalData, iRadius, uiImageWidth, uiDevImageHeight, nChannels, iPitch);
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	uchar pix = 0;
+	for( int dy = -iRadius ; dy <= iRadius ; dy++ )
+	{
+		for( int dx = -iRadius ; dx <= iRadius ; dx++ )
+		{
+			if( (dx != 0 || dy != 0) && GetDataFromTile(ucLocalData, iRadius, dx, dy, nChannels).y == 255 ) pix = 255;
+		}
+	}
+
+	setData(ucDest, (char)pix, (char)pix, (char)pix, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
+
+// Convolution with (2 * iRadius + 1)^2 integer mask in row-major order, normalised by sum of the mask
+__kernel void ckConvR(__global uchar* ucSource, __global uchar* ucDest, __local uchar* ucLocalData, int iRadius,
+                      unsigned int uiImageWidth, unsigned int uiDevImageHeight, int nChannels, int iPitch,
+                      __constant int* iMask, int iMaskSum)
+{
+	ucSource += ImageOffset(iPitch, uiDevImageHeight);
+	ucDest += ImageOffset(iPitch, uiDevImageHeight);
+
+	LoadTileToLocalMem(ucSource, ucLocalData, iRadius, uiImageWidth, uiDevImageHeight, nChannels, iPitch);
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	int iImagePosX = get_global_id(0);
+	int iImagePosY = get_global_id(1);
+	if( iImagePosX >= uiImageWidth || iImagePosY >= uiDevImageHeight ) return;
+
+	int4 iSum = (int4)(0);
+	int k = 0;
+	for( int dy = -iRadius ; dy <= iRadius ; dy++ )
+	{
+		for( int dx = -iRadius ; dx <= iRadius ; dx++ )
+		{
+			iSum += convert_int4(GetDataFromTile(ucLocalData, iRadius, dx, dy, nChannels)) * iMask[k++];
+		}
+	}
+
+	uchar4 res = convert_uchar4_sat(iSum / iMaskSum);
+	setData(ucDest, (char)res.x, (char)res.y, (char)res.z, PixelOffset(iImagePosX, iImagePosY, iPitch, nChannels), nChannels);
+}
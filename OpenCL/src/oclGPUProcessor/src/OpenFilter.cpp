@@ -18,15 +18,57 @@ OpenFilter::~OpenFilter(void)
 OpenFilter::OpenFilter(cl_context GPUContext ,GPUTransferManager* transfer)
 {
 	//MorphologyFilter("",GPUContext,transfer,"");
+	GPUTransfer = transfer;
 	erode = new ErodeFilter(GPUContext,transfer);
 	dilate = new DilateFilter(GPUContext,transfer);
 }
 
 bool OpenFilter::filter(cl_command_queue GPUCommandQueue)
 {
-	if(erode->filter(GPUCommandQueue)) return false;
-	if(dilate->filter(GPUCommandQueue)) return false;
+	if(!erode->filter(GPUCommandQueue)) return false;
+	GPUTransfer->SwapBuffers();
+	if(!dilate->filter(GPUCommandQueue)) return false;
 	return true;
 }
 
+int OpenFilter::Radius()
+{
+	return erode->Radius() + dilate->Radius();
+}
+
+void OpenFilter::SetTransfer(GPUTransferManager* transfer)
+{
+	GPUTransfer = transfer;
+	erode->SetTransfer(transfer);
+	dilate->SetTransfer(transfer);
+}
 
+bool OpenFilter::Autotune(cl_command_queue GPUCommandQueue, cl_device_id GPUDevice)
+{
+	bool ok = erode->Autotune(GPUCommandQueue, GPUDevice);
+	return dilate->Autotune(GPUCommandQueue, GPUDevice) && ok;
+}
+
+bool OpenFilter::SetFetch(FetchMode mode)
+{
+	bool ok = erode->SetFetch(mode);
+	ok = dilate->SetFetch(mode) && ok;
+	if( ok ) Fetch = mode;
+	return ok;
+}
+
+bool OpenFilter::SetRadius(int radius)
+{
+	bool ok = erode->SetRadius(radius);
+	ok = dilate->SetRadius(radius) && ok;
+	if( ok ) iRadius = radius;
+	return ok;
+}
+
+bool OpenFilter::filterHost()
+{
+	if(!erode->filterHost()) return false;
+	GPUTransfer->SwapBuffers();
+	if(!dilate->filterHost()) return false;
+	return true;
+}
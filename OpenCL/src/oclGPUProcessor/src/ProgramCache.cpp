@@ -0,0 +1,183 @@
+/*!
+ * \file ProgramCache.cpp
+ * \brief Persistent cache of compiled programs.
+ */
+
+#include "ProgramCache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+string ProgramCache::CacheDirectory = getenv("GPUPROCESSOR_CACHE") ? getenv("GPUPROCESSOR_CACHE") : "./cache";
+
+void ProgramCache::SetDirectory(const char* directory)
+{
+	CacheDirectory = directory;
+}
+
+string ProgramCache::GetKey(cl_device_id device, const char* source, size_t length, const char* options)
+{
+	char deviceName[256] = "";
+	char driverVersion[256] = "";
+	clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
+	clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(driverVersion), driverVersion, NULL);
+
+	// 64-bit FNV-1a hash of all key parts, parts are separated by zero byte
+	unsigned long long hash = 14695981039346656037ULL;
+	const char* parts[4] = { source, deviceName, driverVersion, options ? options : "" };
+	size_t lengths[4] = { length, strlen(deviceName), strlen(driverVersion), options ? strlen(options) : 0 };
+	for( int i = 0 ; i < 4 ; ++i )
+	{
+		for( size_t j = 0 ; j <= lengths[i] ; ++j )
+		{
+			hash ^= (j < lengths[i]) ? (unsigned char)parts[i][j] : 0;
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	char key[32];
+	sprintf(key, "%016llx", hash);
+	return string(key);
+}
+
+unsigned char* ProgramCache::LoadBinary(const string& key, size_t* length)
+{
+	string path = CacheDirectory + "/" + key + ".bin";
+	FILE* file = fopen(path.c_str(), "rb");
+	if( file == NULL ) return NULL;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	unsigned char* binary = NULL;
+	if( size > 0 )
+	{
+		binary = new unsigned char[size];
+		if( fread(binary, 1, size, file) != (size_t)size )
+		{
+			delete [] binary;
+			binary = NULL;
+		}
+	}
+	fclose(file);
+
+	*length = (size_t)size;
+	return binary;
+}
+
+void ProgramCache::SaveBinary(const string& key, const char* binary, size_t length)
+{
+#ifdef _WIN32
+	_mkdir(CacheDirectory.c_str());
+#else
+	mkdir(CacheDirectory.c_str(), 0755);
+#endif
+
+	// Write to temporary file first, other process can read the entry at the same time.
+	// Name of the temporary file is unique per process and call, so concurrent writers don't share it.
+	static int serial = 0;
+	char suffix[64];
+	sprintf(suffix, ".%d.%d.tmp", (int)getpid(), serial++);
+	string path = CacheDirectory + "/" + key + ".bin";
+	string tmpPath = path + suffix;
+	FILE* file = fopen(tmpPath.c_str(), "wb");
+	if( file == NULL ) return;
+
+	bool ok = fwrite(binary, 1, length, file) == length;
+	fclose(file);
+
+	if( ok )
+	{
+#ifdef _WIN32
+		// rename() doesn't replace existing file on Windows
+		remove(path.c_str());
+#endif
+		if( rename(tmpPath.c_str(), path.c_str()) != 0 ) remove(tmpPath.c_str());
+	}
+	else
+	{
+		remove(tmpPath.c_str());
+	}
+}
+
+cl_program ProgramCache::BuildProgram(cl_context GPUContext, const char* source, size_t length, const char* options, cl_int* error)
+{
+	size_t szDevices = 0;
+	clGetContextInfo(GPUContext, CL_CONTEXT_DEVICES, 0, NULL, &szDevices);
+	cl_uint numDevices = (cl_uint)(szDevices / sizeof(cl_device_id));
+	cl_device_id* devices = new cl_device_id[numDevices];
+	clGetContextInfo(GPUContext, CL_CONTEXT_DEVICES, szDevices, devices, NULL);
+
+	vector<string> keys(numDevices);
+	vector<unsigned char*> binaries(numDevices, (unsigned char*)NULL);
+	vector<size_t> lengths(numDevices, 0);
+	bool cached = numDevices > 0;
+	for( cl_uint i = 0 ; i < numDevices ; ++i )
+	{
+		keys[i] = GetKey(devices[i], source, length, options);
+		binaries[i] = LoadBinary(keys[i], &lengths[i]);
+		if( binaries[i] == NULL ) cached = false;
+	}
+
+	cl_program program = NULL;
+	cl_int GPUError = CL_SUCCESS;
+
+	// Binaries of all devices are in the cache
+	if( cached )
+	{
+		vector<cl_int> status(numDevices);
+		program = clCreateProgramWithBinary(GPUContext, numDevices, devices, &lengths[0], (const unsigned char**)&binaries[0], &status[0], &GPUError);
+		if( GPUError == CL_SUCCESS )
+		{
+			GPUError = clBuildProgram(program, 0, NULL, options, NULL, NULL);
+		}
+		if( GPUError != CL_SUCCESS )
+		{
+			// Stale or corrupted entry, fall back to compilation
+			if( program ) clReleaseProgram(program);
+			program = NULL;
+		}
+	}
+
+	for( cl_uint i = 0 ; i < numDevices ; ++i )
+	{
+		delete [] binaries[i];
+	}
+
+	if( program == NULL )
+	{
+		program = clCreateProgramWithSource(GPUContext, 1, &source, &length, &GPUError);
+		if( GPUError == CL_SUCCESS )
+		{
+			GPUError = clBuildProgram(program, 0, NULL, options, NULL, NULL);
+		}
+
+		if( GPUError == CL_SUCCESS )
+		{
+			for( cl_uint i = 0 ; i < numDevices ; ++i )
+			{
+				char* binary = NULL;
+				size_t binaryLength = 0;
+				oclGetProgBinary(program, devices[i], &binary, &binaryLength);
+				if( binary != NULL )
+				{
+					SaveBinary(keys[i], binary, binaryLength);
+					free(binary);
+				}
+			}
+		}
+	}
+
+	delete [] devices;
+	if( error ) *error = GPUError;
+	return program;
+}
@@ -0,0 +1,81 @@
+/*!
+ * \file ProgramRegistry.cpp
+ * \brief Process-wide registry of built programs.
+ */
+
+#include "ProgramRegistry.h"
+#include <stdlib.h>
+
+map<string, ProgramRegistry::Entry> ProgramRegistry::Programs;
+
+map<string, string> ProgramRegistry::Sources;
+
+string ProgramRegistry::SupportSource = "/home/mateusz/Pulpit/GIT/gpuprocessor/OpenCL/src/oclGPUProcessor/src/OpenCL/GPUCode.cl";
+
+const string& ProgramRegistry::LoadSource(const string& file)
+{
+	map<string, string>::iterator it = Sources.find(file);
+	if( it != Sources.end() ) return it->second;
+
+	size_t szLength = 0;
+	char* source = oclLoadProgSource(file.c_str(), "// My comment\n", &szLength);
+	string& loaded = Sources[file];
+	if( source != NULL )
+	{
+		loaded.assign(source, szLength);
+		free(source);
+	}
+	else
+	{
+		cout << "Can't load " << file << endl;
+	}
+	return loaded;
+}
+
+cl_program ProgramRegistry::Acquire(cl_context GPUContext, const char* file, const char* options, cl_int* error)
+{
+	char contextKey[32];
+	sprintf(contextKey, "%p", (void*)GPUContext);
+	string key = string(contextKey) + "|" + SupportSource + "|" + file + "|" + (options ? options : "");
+
+	map<string, Entry>::iterator it = Programs.find(key);
+	if( it != Programs.end() )
+	{
+		it->second.references++;
+		if( error ) *error = CL_SUCCESS;
+		return it->second.program;
+	}
+
+	string sourceCL = LoadSource(SupportSource) + LoadSource(file);
+
+	cl_int GPUError;
+	cl_program program = ProgramCache::BuildProgram(GPUContext, sourceCL.c_str(), sourceCL.size(), options, &GPUError);
+	if( error ) *error = GPUError;
+	if( GPUError != CL_SUCCESS )
+	{
+		if( program ) clReleaseProgram(program);
+		return NULL;
+	}
+
+	Entry entry;
+	entry.program = program;
+	entry.references = 1;
+	Programs[key] = entry;
+	return program;
+}
+
+void ProgramRegistry::Release(cl_program program)
+{
+	for( map<string, Entry>::iterator it = Programs.begin() ; it != Programs.end() ; ++it )
+	{
+		if( it->second.program == program )
+		{
+			if( --it->second.references == 0 )
+			{
+				clReleaseProgram(program);
+				Programs.erase(it);
+			}
+			return;
+		}
+	}
+}
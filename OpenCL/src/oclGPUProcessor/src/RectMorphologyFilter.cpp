@@ -0,0 +1,169 @@
+/*!
+ * \file RectMorphologyFilter.cpp
+ * \brief Morphology with rectangular structuring element.
+ */
+
+#include "RectMorphologyFilter.h"
+#include "HostFilters.h"
+#include <string.h>
+
+RectMorphologyFilter::~RectMorphologyFilter(void)
+{
+	if(GPUColumnFilter)clReleaseKernel(GPUColumnFilter);
+}
+
+
+RectMorphologyFilter::RectMorphologyFilter(cl_context GPUContext ,GPUTransferManager* transfer, RectOperation op, int width, int height): MorphologyFilter("./OpenCL/RectMorphology.cl",GPUContext,transfer,"ckRectRows")
+{
+	operation = op;
+	elementWidth = width;
+	elementHeight = height;
+	GPUColumnFilter = NULL;
+
+	if( width < 1 || height < 1 ) cout << "Structuring element needs at least one pixel" << endl;
+
+	if( GPUProgram != NULL )
+	{
+		GPUColumnFilter = clCreateKernel(GPUProgram, "ckRectColumns", &GPUError);
+		CheckError(GPUError);
+	}
+}
+
+int RectMorphologyFilter::Passes(int* axis, int* isMax)
+{
+	// Erosion (0) and dilation (1) steps of the operation
+	int steps[2] = { 0, 0 };
+	int nSteps = 1;
+	if( operation == RECT_DILATE ) steps[0] = 1;
+	if( operation == RECT_OPEN ) { steps[1] = 1; nSteps = 2; }
+	if( operation == RECT_CLOSE ) { steps[0] = 1; nSteps = 2; }
+
+	int n = 0;
+	for( int i = 0 ; i < nSteps ; ++i )
+	{
+		if( elementWidth > 1 ) { axis[n] = 0; isMax[n++] = steps[i]; }
+		if( elementHeight > 1 ) { axis[n] = 1; isMax[n++] = steps[i]; }
+	}
+	return n;
+}
+
+int RectMorphologyFilter::Before(int axis, int isMax)
+{
+	int length = axis ? elementHeight : elementWidth;
+	return isMax ? length - 1 - length / 2 : length / 2;
+}
+
+cl_mem RectMorphologyFilter::TempBuffer()
+{
+	size_t szBytes = (size_t)GPUTransfer->ImagePitch * GPUTransfer->ImageHeight * GPUTransfer->BatchSize;
+	ScratchBuffer* temp = GPUTransfer->Scratch(iScratchOwner, 0, szBytes);
+	return temp ? temp->Buffer : NULL;
+}
+
+bool RectMorphologyFilter::EnqueuePass(cl_command_queue GPUCommandQueue, int axis, int isMax, cl_mem source, cl_mem dest)
+{
+	cl_kernel kernel = axis ? GPUColumnFilter : GPUFilter;
+	int iLength = axis ? elementHeight : elementWidth;
+	int iBefore = Before(axis, isMax);
+
+	GPUError = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void*)&source);
+	GPUError |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void*)&dest);
+	GPUError |= clSetKernelArg(kernel, 2, sizeof(cl_int), (void*)&iLength);
+	GPUError |= clSetKernelArg(kernel, 3, sizeof(cl_int), (void*)&iBefore);
+	GPUError |= clSetKernelArg(kernel, 4, sizeof(cl_int), (void*)&isMax);
+	GPUError |= clSetKernelArg(kernel, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+	GPUError |= clSetKernelArg(kernel, 6, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(kernel, 7, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(kernel, 8, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+	if(GPUError) return false;
+
+	// One work item per block of iLength outputs of a row or a column
+	cl_uint uiWorkDim = (GPUTransfer->BatchSize > 1) ? 3 : 2;
+	size_t GPUPassWorkSize[3];
+	GPUPassWorkSize[0] = axis ? GPUTransfer->ImageWidth : (GPUTransfer->ImageWidth + iLength - 1) / iLength;
+	GPUPassWorkSize[1] = axis ? (GPUTransfer->ImageHeight + iLength - 1) / iLength : GPUTransfer->ImageHeight;
+	GPUPassWorkSize[2] = GPUTransfer->BatchSize;
+
+	cl_event event;
+	GPUProfiler* profiler = GPUTransfer->Profiler;
+	if( clEnqueueNDRangeKernel( GPUCommandQueue, kernel, uiWorkDim, NULL, GPUPassWorkSize, NULL, 0, NULL, profiler ? &event : NULL) ) return false;
+	if( profiler ) profiler->Record(axis ? "ckRectColumns" : "ckRectRows", event);
+	return true;
+}
+
+bool RectMorphologyFilter::filter(cl_command_queue GPUCommandQueue)
+{
+	if( elementWidth < 1 || elementHeight < 1 || GPUColumnFilter == NULL ) return false;
+
+	int axis[4];
+	int isMax[4];
+	int n = Passes(axis, isMax);
+
+	// Element of one pixel
+	if( n == 0 )
+	{
+		size_t szBytes = (size_t)GPUTransfer->ImagePitch * GPUTransfer->ImageHeight * GPUTransfer->BatchSize;
+		GPUError = clEnqueueCopyBuffer(GPUCommandQueue, GPUTransfer->cmDevBuf, GPUTransfer->cmDevBufOut, 0, 0, szBytes, 0, NULL, NULL);
+		CheckError(GPUError);
+		return GPUError == CL_SUCCESS;
+	}
+
+	cl_mem cmDevBufTemp = NULL;
+	if( n > 1 && (cmDevBufTemp = TempBuffer()) == NULL ) return false;
+
+	// Last pass writes the output, earlier passes alternate so no pass reads its own output
+	cl_mem source = GPUTransfer->cmDevBuf;
+	for( int i = 0 ; i < n ; ++i )
+	{
+		cl_mem dest = ((n - 1 - i) % 2 == 0) ? GPUTransfer->cmDevBufOut : cmDevBufTemp;
+		if( !EnqueuePass(GPUCommandQueue, axis[i], isMax[i], source, dest) ) return false;
+		source = dest;
+	}
+	return true;
+}
+
+bool RectMorphologyFilter::filterHost()
+{
+	if( elementWidth < 1 || elementHeight < 1 ) return false;
+
+	int axis[4];
+	int isMax[4];
+	int n = Passes(axis, isMax);
+	int width = GPUTransfer->ImageWidth;
+	int height = GPUTransfer->ImageHeight;
+	int nChannels = GPUTransfer->nChannels;
+
+	if( n == 0 )
+	{
+		memcpy(GPUTransfer->HostBufOut, GPUTransfer->HostBuf, width * height * nChannels);
+		return true;
+	}
+
+	unsigned char* temp = (n > 1) ? new unsigned char[width * height * nChannels] : NULL;
+	const unsigned char* source = GPUTransfer->HostBuf;
+	for( int i = 0 ; i < n ; ++i )
+	{
+		unsigned char* dest = ((n - 1 - i) % 2 == 0) ? GPUTransfer->HostBufOut : temp;
+		int length = axis[i] ? elementHeight : elementWidth;
+		HostRectMorphology(source, dest, width, height, nChannels, length, Before(axis[i], isMax[i]), axis[i] == 1, isMax[i] == 1);
+		source = dest;
+	}
+	delete [] temp;
+	return true;
+}
+
+int RectMorphologyFilter::Radius()
+{
+	int steps = (operation == RECT_OPEN || operation == RECT_CLOSE) ? 2 : 1;
+	return steps * (max(elementWidth, elementHeight) / 2);
+}
+
+bool RectMorphologyFilter::PerChannel()
+{
+	return true;
+}
+
+bool RectMorphologyFilter::Autotune(cl_command_queue, cl_device_id)
+{
+	return true;
+}
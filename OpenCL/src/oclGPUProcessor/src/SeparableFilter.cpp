@@ -0,0 +1,128 @@
+/*!
+ * \file SeparableFilter.cpp
+ * \brief Separable convolution filter.
+ */
+
+#include "SeparableFilter.h"
+#include "HostFilters.h"
+#include <math.h>
+
+SeparableFilter::~SeparableFilter(void)
+{
+	if(GPUColumnFilter)clReleaseKernel(GPUColumnFilter);
+	if(cmDevBufRow)clReleaseMemObject(cmDevBufRow);
+	if(cmDevBufCol)clReleaseMemObject(cmDevBufCol);
+	delete [] rowCoeffs;
+	delete [] colCoeffs;
+}
+
+
+SeparableFilter::SeparableFilter(cl_context GPUContext ,GPUTransferManager* transfer, const float* row, int rowLength, const float* col, int colLength): LinearFilter("./OpenCL/SeparableFilter.cl",GPUContext,transfer,"ckSeparableRow")
+{
+	GPUColumnFilter = NULL;
+
+	rowRadius = LoadCoeffs(row, rowLength, &rowCoeffs, &cmDevBufRow, transfer);
+	colRadius = LoadCoeffs(col, colLength, &colCoeffs, &cmDevBufCol, transfer);
+	if( rowRadius < 0 || colRadius < 0 ) cout << "Separable filter needs odd number of coefficients" << endl;
+
+	if( GPUProgram != NULL )
+	{
+		GPUColumnFilter = clCreateKernel(GPUProgram, "ckSeparableColumn", &GPUError);
+		CheckError(GPUError);
+	}
+}
+
+int SeparableFilter::LoadCoeffs(const float* coeffs, int length, float** dest, cl_mem* buffer, GPUTransferManager* transfer)
+{
+	*dest = NULL;
+	*buffer = NULL;
+	if( coeffs == NULL || length < 1 || length % 2 == 0 ) return -1;
+
+	// Normalised like ckConv divides by sum of the mask, derivative vectors summing to 0 are kept
+	float sum = 0.0f;
+	for( int i = 0 ; i < length ; ++i ) sum += coeffs[i];
+	if( fabs(sum) < 1e-6f ) sum = 1.0f;
+
+	*dest = new float[length];
+	for( int i = 0 ; i < length ; ++i ) (*dest)[i] = coeffs[i] / sum;
+
+	// Host mode, filterHost() reads the coefficients directly
+	if( transfer->GPUContext == NULL ) return length / 2;
+
+	*buffer = clCreateBuffer(transfer->GPUContext, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, length * sizeof(cl_float), (void*)*dest, &GPUError);
+	CheckError(GPUError);
+	return length / 2;
+}
+
+cl_mem SeparableFilter::TempBuffer()
+{
+	size_t szBytes = (size_t)GPUTransfer->ImageWidth * GPUTransfer->ImageHeight * GPUTransfer->nChannels * GPUTransfer->BatchSize * sizeof(cl_float);
+	ScratchBuffer* temp = GPUTransfer->Scratch(iScratchOwner, 0, szBytes);
+	return temp ? temp->Buffer : NULL;
+}
+
+bool SeparableFilter::filter(cl_command_queue GPUCommandQueue)
+{
+	if( rowRadius < 0 || colRadius < 0 || GPUColumnFilter == NULL ) return false;
+
+	// Column tile keeps float4 per pixel, large radius with tall work-group may not fit
+	size_t szRowLocal = (iBlockDimX + 2 * rowRadius) * iBlockDimY * GPUTransfer->nChannels * sizeof(cl_uchar);
+	size_t szColLocal = iBlockDimX * (iBlockDimY + 2 * colRadius) * sizeof(cl_float4);
+	cl_ulong ulLocalMem = LocalMemSize();
+	if( (cl_ulong)szRowLocal > ulLocalMem || (cl_ulong)szColLocal > ulLocalMem ) return false;
+
+	cl_mem cmDevBufTemp = TempBuffer();
+	if( cmDevBufTemp == NULL ) return false;
+
+	GPUError = clSetKernelArg(GPUFilter, 0, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBuf);
+	GPUError |= clSetKernelArg(GPUFilter, 1, sizeof(cl_mem), (void*)&cmDevBufTemp);
+	GPUError |= clSetKernelArg(GPUFilter, 2, sizeof(cl_mem), (void*)&cmDevBufRow);
+	GPUError |= clSetKernelArg(GPUFilter, 3, szRowLocal, NULL);
+	GPUError |= clSetKernelArg(GPUFilter, 4, sizeof(cl_int), (void*)&rowRadius);
+	GPUError |= clSetKernelArg(GPUFilter, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+	GPUError |= clSetKernelArg(GPUFilter, 6, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUFilter, 7, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUFilter, 8, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+
+	GPUError |= clSetKernelArg(GPUColumnFilter, 0, sizeof(cl_mem), (void*)&cmDevBufTemp);
+	GPUError |= clSetKernelArg(GPUColumnFilter, 1, sizeof(cl_mem), (void*)&GPUTransfer->cmDevBufOut);
+	GPUError |= clSetKernelArg(GPUColumnFilter, 2, sizeof(cl_mem), (void*)&cmDevBufCol);
+	GPUError |= clSetKernelArg(GPUColumnFilter, 3, szColLocal, NULL);
+	GPUError |= clSetKernelArg(GPUColumnFilter, 4, sizeof(cl_int), (void*)&colRadius);
+	GPUError |= clSetKernelArg(GPUColumnFilter, 5, sizeof(cl_uint), (void*)&GPUTransfer->ImageWidth);
+	GPUError |= clSetKernelArg(GPUColumnFilter, 6, sizeof(cl_uint), (void*)&GPUTransfer->ImageHeight);
+	GPUError |= clSetKernelArg(GPUColumnFilter, 7, sizeof(cl_int), (void*)&GPUTransfer->nChannels);
+	GPUError |= clSetKernelArg(GPUColumnFilter, 8, sizeof(cl_int), (void*)&GPUTransfer->ImagePitch);
+	if(GPUError) return false;
+
+	if( !EnqueueKernel(GPUCommandQueue, GPUFilter, "ckSeparableRow") ) return false;
+	return EnqueueKernel(GPUCommandQueue, GPUColumnFilter, "ckSeparableColumn");
+}
+
+bool SeparableFilter::filterHost()
+{
+	if( rowRadius < 0 || colRadius < 0 ) return false;
+	HostSeparable(GPUTransfer->HostBuf, GPUTransfer->HostBufOut, GPUTransfer->ImageWidth, GPUTransfer->ImageHeight, GPUTransfer->nChannels, rowCoeffs, rowRadius, colCoeffs, colRadius);
+	return true;
+}
+
+int SeparableFilter::Radius()
+{
+	return max(max(rowRadius, colRadius), 0);
+}
+
+bool SeparableFilter::PerChannel()
+{
+	return true;
+}
+
+void SeparableFilter::Gaussian(float sigma, int radius, float* coeffs)
+{
+	float sum = 0.0f;
+	for( int i = -radius ; i <= radius ; ++i )
+	{
+		coeffs[i + radius] = expf(-(float)(i * i) / (2.0f * sigma * sigma));
+		sum += coeffs[i + radius];
+	}
+	for( int i = 0 ; i <= 2 * radius ; ++i ) coeffs[i] /= sum;
+}
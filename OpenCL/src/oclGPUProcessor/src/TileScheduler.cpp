@@ -0,0 +1,188 @@
+/*!
+ * \file TileScheduler.cpp
+ * \brief Work-stealing thread pool running host filters on tiles of the image.
+ */
+
+#include "TileScheduler.h"
+#include <algorithm>
+
+TileScheduler::TileScheduler(int threadCount)
+{
+	generation = 0;
+	pending = 0;
+	quit = false;
+	MutexInit(runLock);
+	MutexInit(stateLock);
+	CondInit(wake);
+	CondInit(done);
+
+	if( threadCount < 1 ) threadCount = 1;
+	for( int i = 0 ; i < threadCount ; ++i )
+	{
+		Worker* worker = new Worker();
+		worker->owner = this;
+		worker->index = i;
+		MutexInit(worker->lock);
+		workers.push_back(worker);
+	}
+	for( int i = 0 ; i < threadCount ; ++i )
+	{
+		threads.push_back(cutStartThread(WorkerThread, workers[i]));
+	}
+}
+
+TileScheduler::~TileScheduler()
+{
+	MutexLock(stateLock);
+	quit = true;
+	CondBroadcast(wake);
+	MutexUnlock(stateLock);
+	cutWaitForThreads(&threads[0], (int)threads.size());
+
+	for( size_t i = 0 ; i < workers.size() ; ++i )
+	{
+		MutexDestroy(workers[i]->lock);
+		delete workers[i];
+	}
+	CondDestroy(wake);
+	CondDestroy(done);
+	MutexDestroy(stateLock);
+	MutexDestroy(runLock);
+}
+
+TileScheduler* TileScheduler::Instance()
+{
+	// Threads are stopped at exit
+	static TileScheduler scheduler(HostThreadCount());
+	return &scheduler;
+}
+
+int TileScheduler::ThreadCount()
+{
+	return (int)workers.size();
+}
+
+void TileScheduler::TileSize(const HostJob* job, int* tileWidth, int* tileHeight)
+{
+	// Wide tiles keep rows contiguous, narrow images use whole rows
+	int rowBytes = max(job->nChannels, 1);
+	*tileWidth = min(job->Width, 512);
+	*tileHeight = max(1, HOST_TILE_BYTES / (*tileWidth * rowBytes));
+}
+
+void TileScheduler::Run(HostJob* job)
+{
+	if( job->Width <= 0 || job->Height <= 0 ) return;
+
+	int tileWidth, tileHeight;
+	TileSize(job, &tileWidth, &tileHeight);
+	int tilesX = (job->Width + tileWidth - 1) / tileWidth;
+	int tilesY = (job->Height + tileHeight - 1) / tileHeight;
+	int count = tilesX * tilesY;
+
+	// Small job, threads would cost more than they save
+	if( count == 1 || workers.size() == 1 )
+	{
+		job->Kernel(job, 0, 0, job->Width, job->Height);
+		return;
+	}
+
+	MutexLock(runLock);
+
+	// Each worker starts with a contiguous band of tiles, neighbouring tiles share apron rows in cache
+	int nWorkers = (int)workers.size();
+	for( int w = 0 ; w < nWorkers ; ++w )
+	{
+		int first = count * w / nWorkers;
+		int last = count * (w + 1) / nWorkers;
+		MutexLock(workers[w]->lock);
+		for( int t = first ; t < last ; ++t )
+		{
+			Tile tile;
+			tile.job = job;
+			tile.x0 = (t % tilesX) * tileWidth;
+			tile.y0 = (t / tilesX) * tileHeight;
+			tile.x1 = min(tile.x0 + tileWidth, job->Width);
+			tile.y1 = min(tile.y0 + tileHeight, job->Height);
+			// Owner pops from the back, so first tile of the band goes last
+			workers[w]->tiles.push_front(tile);
+		}
+		MutexUnlock(workers[w]->lock);
+	}
+
+	MutexLock(stateLock);
+	pending = count;
+	generation++;
+	CondBroadcast(wake);
+	while( pending > 0 ) CondWait(done, stateLock);
+	MutexUnlock(stateLock);
+
+	MutexUnlock(runLock);
+}
+
+bool TileScheduler::Pop(int index, Tile* tile)
+{
+	Worker* worker = workers[index];
+	bool found = false;
+	MutexLock(worker->lock);
+	if( !worker->tiles.empty() )
+	{
+		*tile = worker->tiles.back();
+		worker->tiles.pop_back();
+		found = true;
+	}
+	MutexUnlock(worker->lock);
+	return found;
+}
+
+bool TileScheduler::Steal(int index, Tile* tile)
+{
+	int nWorkers = (int)workers.size();
+	for( int k = 1 ; k < nWorkers ; ++k )
+	{
+		Worker* victim = workers[(index + k) % nWorkers];
+		bool found = false;
+		MutexLock(victim->lock);
+		if( !victim->tiles.empty() )
+		{
+			*tile = victim->tiles.front();
+			victim->tiles.pop_front();
+			found = true;
+		}
+		MutexUnlock(victim->lock);
+		if( found ) return true;
+	}
+	return false;
+}
+
+void TileScheduler::WorkerLoop(Worker* worker)
+{
+	unsigned int seen = 0;
+	while( true )
+	{
+		MutexLock(stateLock);
+		while( !quit && generation == seen ) CondWait(wake, stateLock);
+		bool stop = quit;
+		seen = generation;
+		MutexUnlock(stateLock);
+		if( stop ) return;
+
+		// Tiles carry their job, a late worker can't run them with a finished one
+		Tile tile;
+		while( Pop(worker->index, &tile) || Steal(worker->index, &tile) )
+		{
+			tile.job->Kernel(tile.job, tile.x0, tile.y0, tile.x1, tile.y1);
+
+			MutexLock(stateLock);
+			if( --pending == 0 ) CondSignal(done);
+			MutexUnlock(stateLock);
+		}
+	}
+}
+
+HOST_THREADPROC TileScheduler::WorkerThread(void* data)
+{
+	Worker* worker = (Worker*)data;
+	worker->owner->WorkerLoop(worker);
+	HOST_THREADEND;
+}
@@ -0,0 +1,208 @@
+/*!
+ * \file TransferHandle.cpp
+ * \brief Handle of non-blocking transfer.
+ */
+
+#include "TransferHandle.h"
+#include "GPUTransferManager.h"
+#include "HostSync.h"
+#include "multithreading.h"
+#include <deque>
+
+using namespace std;
+
+/*!
+ * Callback waiting for its transfer.
+ */
+struct PendingCallback
+{
+	cl_event Event;
+	IplImage* Image;
+	TransferCallback Callback;
+	void* UserData;
+	GPUTransferManager* Owner;
+	int Slot;
+	bool Owned;
+};
+
+/*!
+ * Call callback and drop its references.
+ */
+static void FinishCallback(PendingCallback* pending, bool success)
+{
+	pending->Callback(success ? pending->Image : NULL, pending->UserData);
+	if( pending->Event ) clReleaseEvent(pending->Event);
+	if( pending->Owner ) pending->Owner->ReleaseStaging(pending->Slot);
+	if( pending->Owned ) cvReleaseImage(&pending->Image);
+	delete pending;
+}
+
+#ifdef CL_VERSION_1_1
+
+static void CL_CALLBACK EventFinished(cl_event event, cl_int status, void* data)
+{
+	FinishCallback((PendingCallback*)data, status == CL_COMPLETE);
+}
+
+#endif
+
+/*!
+ * Thread calling callbacks in order of registration. Transfers of one in-order queue finish in that order too.
+ * Used for all callbacks with OpenCL 1.0 and for synchronous transfers.
+ */
+class CallbackDispatcher
+{
+	private:
+
+		deque<PendingCallback*> pending;
+		HostMutex lock;
+		HostCond wake;
+		bool quit;
+		bool started;
+		CUTThread thread;
+
+		static HOST_THREADPROC DispatcherThread(void* data)
+		{
+			((CallbackDispatcher*)data)->Loop();
+			HOST_THREADEND;
+		}
+
+		void Loop()
+		{
+			while( true )
+			{
+				MutexLock(lock);
+				while( !quit && pending.empty() ) CondWait(wake, lock);
+				if( pending.empty() )
+				{
+					MutexUnlock(lock);
+					return;
+				}
+				PendingCallback* item = pending.front();
+				pending.pop_front();
+				MutexUnlock(lock);
+
+				// Callback isn't called under the lock, it may start next transfer
+				bool success = (item->Event == NULL) || clWaitForEvents(1, &item->Event) == CL_SUCCESS;
+				FinishCallback(item, success);
+			}
+		}
+
+	public:
+
+		CallbackDispatcher()
+		{
+			quit = false;
+			started = false;
+			MutexInit(lock);
+			CondInit(wake);
+		}
+
+		// Callbacks still pending are called before exit
+		~CallbackDispatcher()
+		{
+			MutexLock(lock);
+			quit = true;
+			CondSignal(wake);
+			MutexUnlock(lock);
+			if( started ) cutEndThread(thread);
+			CondDestroy(wake);
+			MutexDestroy(lock);
+		}
+
+		void Push(PendingCallback* item)
+		{
+			MutexLock(lock);
+			if( !started )
+			{
+				thread = cutStartThread(DispatcherThread, this);
+				started = true;
+			}
+			pending.push_back(item);
+			CondSignal(wake);
+			MutexUnlock(lock);
+		}
+};
+
+static void Dispatch(PendingCallback* pending)
+{
+	static CallbackDispatcher dispatcher;
+	dispatcher.Push(pending);
+}
+
+TransferHandle::TransferHandle(cl_event event, IplImage* image, GPUTransferManager* owner, int slot, bool ownsImage)
+{
+	this->event = event;
+	this->image = image;
+	this->owner = owner;
+	this->slot = slot;
+	held = (owner != NULL);
+	owned = ownsImage && image != NULL;
+}
+
+TransferHandle::~TransferHandle()
+{
+	Release();
+	if( event ) clReleaseEvent(event);
+}
+
+void TransferHandle::Release()
+{
+	if( owned ) cvReleaseImage(&image);
+	owned = false;
+	if( !held ) return;
+	held = false;
+	image = NULL;
+	owner->ReleaseStaging(slot);
+}
+
+bool TransferHandle::IsComplete()
+{
+	if( event == NULL ) return true;
+
+	cl_int status = CL_QUEUED;
+	clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+	// Negative status is an error, transfer won't progress any more
+	return status <= CL_COMPLETE;
+}
+
+IplImage* TransferHandle::Wait()
+{
+	if( event == NULL ) return image;
+	if( clWaitForEvents(1, &event) != CL_SUCCESS ) return NULL;
+	return image;
+}
+
+cl_event TransferHandle::GetEvent()
+{
+	return event;
+}
+
+void TransferHandle::OnComplete(TransferCallback callback, void* userData)
+{
+	// Callback keeps its own references to the event and the staging buffer, handle may be released first
+	PendingCallback* pending = new PendingCallback();
+	pending->Event = event;
+	pending->Image = image;
+	pending->Callback = callback;
+	pending->UserData = userData;
+	pending->Owner = held ? owner : NULL;
+	pending->Slot = slot;
+	pending->Owned = owned;
+	if( owned ) pending->Image = cvCloneImage(image);
+	if( event ) clRetainEvent(event);
+	if( pending->Owner ) owner->HoldStaging(slot);
+
+	// Synchronous transfer is already finished, callback still runs on the dispatcher thread
+	if( event == NULL )
+	{
+		Dispatch(pending);
+		return;
+	}
+
+#ifdef CL_VERSION_1_1
+	if( clSetEventCallback(event, CL_COMPLETE, EventFinished, pending) != CL_SUCCESS ) Dispatch(pending);
+#else
+	Dispatch(pending);
+#endif
+}
@@ -0,0 +1,85 @@
+/*!
+ * \file WorkGroupTuner.cpp
+ * \brief Storing tuned work-group sizes.
+ */
+
+#include "WorkGroupTuner.h"
+#include <stdlib.h>
+#include <string.h>
+
+string WorkGroupTuner::TuningFile = getenv("GPUPROCESSOR_TUNING") ? getenv("GPUPROCESSOR_TUNING") : "./tuning.txt";
+
+map<string, pair<int,int> > WorkGroupTuner::Entries;
+
+bool WorkGroupTuner::Loaded = false;
+
+void WorkGroupTuner::SetFile(const char* file)
+{
+	TuningFile = file;
+	Entries.clear();
+	Loaded = false;
+}
+
+string WorkGroupTuner::GetKey(cl_device_id device, const string& kernel)
+{
+	char deviceName[256] = "";
+	char driverVersion[256] = "";
+	clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceName), deviceName, NULL);
+	clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(driverVersion), driverVersion, NULL);
+	return string(deviceName) + "\t" + driverVersion + "\t" + kernel;
+}
+
+void WorkGroupTuner::Load()
+{
+	Loaded = true;
+	FILE* file = fopen(TuningFile.c_str(), "r");
+	if( file == NULL ) return;
+
+	char line[1024];
+	while( fgets(line, sizeof(line), file) != NULL )
+	{
+		// Size is after the last tab, key is everything before it
+		char* sizeField = strrchr(line, '\t');
+		int x, y;
+		if( sizeField == NULL || sscanf(sizeField + 1, "%d %d", &x, &y) != 2 ) continue;
+		*sizeField = '\0';
+		Entries[line] = make_pair(x, y);
+	}
+	fclose(file);
+}
+
+void WorkGroupTuner::Save()
+{
+	string tmpPath = TuningFile + ".tmp";
+	FILE* file = fopen(tmpPath.c_str(), "w");
+	if( file == NULL ) return;
+
+	for( map<string, pair<int,int> >::iterator it = Entries.begin() ; it != Entries.end() ; ++it )
+	{
+		fprintf(file, "%s\t%d %d\n", it->first.c_str(), it->second.first, it->second.second);
+	}
+	fclose(file);
+
+	remove(TuningFile.c_str());
+	rename(tmpPath.c_str(), TuningFile.c_str());
+}
+
+bool WorkGroupTuner::Lookup(cl_device_id device, const string& kernel, int* iBlockDimX, int* iBlockDimY)
+{
+	if( !Loaded ) Load();
+
+	map<string, pair<int,int> >::iterator it = Entries.find(GetKey(device, kernel));
+	if( it == Entries.end() ) return false;
+
+	*iBlockDimX = it->second.first;
+	*iBlockDimY = it->second.second;
+	return true;
+}
+
+void WorkGroupTuner::Store(cl_device_id device, const string& kernel, int iBlockDimX, int iBlockDimY)
+{
+	if( !Loaded ) Load();
+
+	Entries[GetKey(device, kernel)] = make_pair(iBlockDimX, iBlockDimY);
+	Save();
+}
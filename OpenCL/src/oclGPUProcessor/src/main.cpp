@@ -27,10 +27,452 @@
 #include "LaplaceFilter.h"
 #include "CornerDetectionFilter.h"
 #include "BinarizationFilter.h"
+#include "SeparableFilter.h"
+#include "FFTConvolutionFilter.h"
+#include "RectMorphologyFilter.h"
+#include "TileScheduler.h"
 
 
 using namespace std;
 
+// Average wall time of uploads in each mode, kernels are not run
+static void BenchmarkUploads(GPUTransferManager* transfer, IplImage* image, int runs)
+{
+	if( transfer->HostMode ) return;
+
+	const char* names[3] = { "pageable", "pinned", "mapped" };
+	UploadMode modes[3] = { UPLOAD_PAGEABLE, UPLOAD_PINNED, UPLOAD_MAPPED };
+	UploadMode saved = transfer->Upload;
+	double bytes = (double)image->width * image->height * image->nChannels;
+
+	// Source in ordinary pageable memory, not in one of staging buffers
+	IplImage* source = cvCloneImage(image);
+
+	printf("%-10s %10s %10s\n", "upload", "ms", "MB/s");
+	for( int m = 0 ; m < 3 ; ++m )
+	{
+		transfer->Upload = modes[m];
+
+		// Warm-up
+		transfer->SendImage(source);
+		clFinish(transfer->GPUCommandQueue);
+
+		shrDeltaT(0);
+		for( int r = 0 ; r < runs ; ++r )
+		{
+			transfer->SendImage(source);
+		}
+		clFinish(transfer->GPUCommandQueue);
+		double seconds = shrDeltaT(0);
+
+		printf("%-10s %10.3f %10.1f\n", names[m], seconds * 1000.0 / runs, bytes * runs / seconds * 1.0e-6);
+	}
+
+	transfer->Upload = saved;
+	cvReleaseImage(&source);
+
+	// Events of the runs aren't printed
+	if( transfer->Profiler ) transfer->Profiler->Reset();
+}
+
+// Average device time of filter with neighbourhoods from local memory and from image sampler
+static void BenchmarkFetch(GPUTransferManager* transfer, ContextFilter* filter, IplImage* image, int runs)
+{
+	if( transfer->HostMode ) return;
+
+	const char* names[2] = { "local", "image" };
+	FetchMode modes[2] = { FETCH_LOCAL, FETCH_IMAGE };
+	FetchMode saved = filter->Fetch;
+	double pixels = (double)image->width * image->height;
+
+	transfer->SendImage(image);
+	clFinish(transfer->GPUCommandQueue);
+
+	printf("%-10s %10s %10s\n", "fetch", "ms", "MPix/s");
+	for( int m = 0 ; m < 2 ; ++m )
+	{
+		if( !filter->SetFetch(modes[m]) ) continue;
+
+		// Warm-up, buffers aren't swapped so every run filters the same input
+		filter->filter(transfer->GPUCommandQueue);
+		clFinish(transfer->GPUCommandQueue);
+
+		shrDeltaT(0);
+		for( int r = 0 ; r < runs ; ++r )
+		{
+			filter->filter(transfer->GPUCommandQueue);
+		}
+		clFinish(transfer->GPUCommandQueue);
+		double seconds = shrDeltaT(0);
+
+		printf("%-10s %10.3f %10.1f\n", names[m], seconds * 1000.0 / runs, pixels * runs / seconds * 1.0e-6);
+	}
+
+	filter->SetFetch(saved);
+	if( transfer->Profiler ) transfer->Profiler->Reset();
+}
+
+// Average time of upload, filter and download of 3-channel image in interleaved, packed RGBA and planar layout
+static void BenchmarkLayout(GPUTransferManager* transfer, Filter* filter, IplImage* image, int runs)
+{
+	if( transfer->HostMode || image->nChannels != 3 ) return;
+
+	const char* names[3] = { "bgr", "rgba", "planar" };
+	ChannelLayout layouts[3] = { LAYOUT_INTERLEAVED, LAYOUT_RGBA, LAYOUT_PLANAR };
+	ChannelLayout saved = transfer->Layout;
+	double pixels = (double)image->width * image->height;
+	IplImage* source = cvCloneImage(image);
+
+	printf("%-10s %10s %10s\n", "layout", "ms", "MPix/s");
+	for( int m = 0 ; m < 3 ; ++m )
+	{
+		transfer->Layout = layouts[m];
+
+		// Warm-up, builds layout kernels. BeginReceiveImage() doesn't repoint source image to download buffers
+		transfer->SendImage(source);
+		filter->filter(transfer->GPUCommandQueue);
+		delete transfer->BeginReceiveImage();
+		clFinish(transfer->GPUCommandQueue);
+
+		shrDeltaT(0);
+		for( int r = 0 ; r < runs ; ++r )
+		{
+			transfer->SendImage(source);
+			filter->filter(transfer->GPUCommandQueue);
+			delete transfer->BeginReceiveImage();
+		}
+		clFinish(transfer->GPUCommandQueue);
+		double seconds = shrDeltaT(0);
+
+		printf("%-10s %10.3f %10.1f\n", names[m], seconds * 1000.0 / runs, pixels * runs / seconds * 1.0e-6);
+	}
+
+	transfer->Layout = saved;
+	cvReleaseImage(&source);
+	if( transfer->Profiler ) transfer->Profiler->Reset();
+}
+
+// Largest difference of channel values of two images of the same size, pixels closer than margin to the edge are skipped
+static int MaxDifference(IplImage* a, IplImage* b, int margin)
+{
+	int rowBytes = a->width * a->nChannels;
+	int diff = 0;
+	for( int y = margin ; y < a->height - margin ; ++y )
+	{
+		const unsigned char* pa = (const unsigned char*)a->imageData + y * a->widthStep;
+		const unsigned char* pb = (const unsigned char*)b->imageData + y * b->widthStep;
+		for( int x = margin * a->nChannels ; x < rowBytes - margin * a->nChannels ; ++x )
+		{
+			diff = max(diff, abs((int)pa[x] - (int)pb[x]));
+		}
+	}
+	return diff;
+}
+
+// Print whether result of a path matches its reference, missing image means the path failed
+static void ReportCheck(const char* name, IplImage* result, IplImage* reference, int margin, int tolerance)
+{
+	if( result == NULL || reference == NULL )
+	{
+		printf("%-10s %10s\n", name, "error");
+		return;
+	}
+	int diff = MaxDifference(result, reference, margin);
+	printf("%-10s %10s %10d\n", name, diff <= tolerance ? "ok" : "FAIL", diff);
+}
+
+// Image processed by the whole chain in one piece, reference of strip, tile and batch modes. Caller releases it
+static IplImage* ProcessWhole(GPUImageProcessor* GPU, IplImage* image)
+{
+	if( !GPU->Transfer->SendImage(image) ) return NULL;
+	GPU->Process();
+	IplImage* received = GPU->Transfer->ReceiveImage();
+	return received ? cvCloneImage(received) : NULL;
+}
+
+// Strips processed on all devices and stitched together against the whole image, halo rows must hide the seams
+static void CheckStrips(GPUImageProcessor* GPU, IplImage* image)
+{
+	IplImage* reference = ProcessWhole(GPU, image);
+	IplImage* result = cvCreateImage(cvGetSize(image), image->depth, image->nChannels);
+	GPU->ProcessStrips(image, result);
+
+	ReportCheck("strips", result, reference, 0, 0);
+	cvReleaseImage(&result);
+	if( reference ) cvReleaseImage(&reference);
+}
+
+// Tiles of given number of rows against the whole image, small tiles give many seams and reuse both tile slots
+static void CheckTiles(GPUImageProcessor* GPU, IplImage* image, int rows)
+{
+	IplImage* reference = ProcessWhole(GPU, image);
+	IplImage* result = cvCreateImage(cvGetSize(image), image->depth, image->nChannels);
+	size_t maxTileBytes = GPU->Transfer->RowPitch(image->width) * rows;
+
+	ReportCheck("tiled", GPU->ProcessTiled(image, result, maxTileBytes) ? result : NULL, reference, 0, 0);
+	cvReleaseImage(&result);
+	if( reference ) cvReleaseImage(&reference);
+}
+
+// Batch of the image and its mirrors against each image processed alone, wrong offsets mix pixels of neighbouring images
+static void CheckBatch(GPUImageProcessor* GPU, IplImage* image)
+{
+	IplImage* input[3];
+	IplImage* output[3];
+	for( int k = 0 ; k < 3 ; ++k )
+	{
+		input[k] = cvCloneImage(image);
+		output[k] = cvCreateImage(cvGetSize(image), image->depth, image->nChannels);
+	}
+	cvFlip(image, input[1], 0);
+	cvFlip(image, input[2], 1);
+
+	bool done = GPU->ProcessBatch(input, output, 3);
+	for( int k = 0 ; k < 3 ; ++k )
+	{
+		IplImage* reference = ProcessWhole(GPU, input[k]);
+		char name[16];
+		sprintf(name, "batch %d", k);
+		ReportCheck(name, done ? output[k] : NULL, reference, 0, 0);
+		if( reference ) cvReleaseImage(&reference);
+		cvReleaseImage(&input[k]);
+		cvReleaseImage(&output[k]);
+	}
+}
+
+// Host job of the scheduler check, sum of 3x3 window modulo 256, pixels outside of the image are zero
+static void CheckSumKernel(const HostJob* job, int x0, int y0, int x1, int y1)
+{
+	int nc = job->nChannels;
+	for( int y = y0 ; y < y1 ; ++y )
+	{
+		for( int x = x0 ; x < x1 ; ++x )
+		{
+			for( int c = 0 ; c < nc ; ++c )
+			{
+				int sum = 0;
+				for( int dy = max(y - 1, 0) ; dy <= min(y + 1, job->Height - 1) ; ++dy )
+				{
+					for( int dx = max(x - 1, 0) ; dx <= min(x + 1, job->Width - 1) ; ++dx )
+					{
+						sum += job->Source[(dy * job->Width + dx) * nc + c];
+					}
+				}
+				job->Dest[(y * job->Width + x) * nc + c] = (unsigned char)sum;
+			}
+		}
+	}
+}
+
+// Image of the same size with rows without padding, host filters take dense images. Pixels are copied if copy is set
+static IplImage* CreateDense(IplImage* image, bool copy)
+{
+	int rowBytes = image->width * image->nChannels;
+	IplImage* dense = cvCreateImageHeader(cvGetSize(image), image->depth, image->nChannels);
+	cvSetData(dense, malloc((size_t)rowBytes * image->height), rowBytes);
+	for( int y = 0 ; copy && y < image->height ; ++y )
+	{
+		memcpy(dense->imageData + y * rowBytes, image->imageData + y * image->widthStep, rowBytes);
+	}
+	return dense;
+}
+
+// Release image created by CreateDense()
+static void ReleaseDense(IplImage** dense)
+{
+	free((*dense)->imageData);
+	cvReleaseImageHeader(dense);
+}
+
+// Tiles spread over worker threads of the host backend against one serial pass, missed or overlapping tiles show up
+static void CheckScheduler(IplImage* image)
+{
+	int rowBytes = image->width * image->nChannels;
+	IplImage* source = CreateDense(image, true);
+	IplImage* tiled = CreateDense(image, false);
+	IplImage* serial = CreateDense(image, false);
+
+	HostJob job = HostJob();
+	job.Source = (unsigned char*)source->imageData;
+	job.Width = image->width;
+	job.Height = image->height;
+	job.nChannels = image->nChannels;
+	job.Kernel = CheckSumKernel;
+
+	// Outputs are filled with different bytes, so pixels no tile writes differ
+	memset(tiled->imageData, 0x55, (size_t)rowBytes * image->height);
+	job.Dest = (unsigned char*)tiled->imageData;
+	TileScheduler::Instance()->Run(&job);
+
+	memset(serial->imageData, 0xAA, (size_t)rowBytes * image->height);
+	job.Dest = (unsigned char*)serial->imageData;
+	job.Kernel(&job, 0, 0, job.Width, job.Height);
+
+	ReportCheck("scheduler", tiled, serial, 0, 0);
+	ReleaseDense(&source);
+	ReleaseDense(&tiled);
+	ReleaseDense(&serial);
+}
+
+// Image processed by one filter like Process() runs a filter of the chain. Caller releases it
+static IplImage* RunFilter(GPUTransferManager* transfer, Filter* filter, IplImage* image)
+{
+	if( !transfer->SendImage(image) ) return NULL;
+	filter->SetTransfer(transfer);
+	if( !filter->PerChannel() ) transfer->Interleave();
+	bool done = transfer->HostMode ? filter->filterHost() : filter->filter(transfer->GPUCommandQueue);
+	if( !done ) return NULL;
+	transfer->SwapBuffers();
+	IplImage* received = transfer->ReceiveImage();
+	return received ? cvCloneImage(received) : NULL;
+}
+
+// Row and column passes of 15-tap Gaussian against direct convolution with 15x15 product of the taps.
+// Separable passes repeat edge pixels and direct convolution reads zeros, so pixels closer than radius to the edge are skipped
+static void CheckSeparable(GPUImageProcessor* GPU, IplImage* image)
+{
+	const int radius = 7;
+	const int side = 2 * radius + 1;
+	float taps[side];
+	float mask[side * side];
+	SeparableFilter::Gaussian(2.5f, radius, taps);
+	for( int y = 0 ; y < side ; ++y )
+	{
+		for( int x = 0 ; x < side ; ++x ) mask[y * side + x] = taps[y] * taps[x];
+	}
+
+	SeparableFilter separable(GPU->GPUContext, GPU->Transfer, taps, side, taps, side);
+	FFTConvolutionFilter direct(GPU->GPUContext, GPU->Transfer, mask, side, side);
+	direct.Method = CONV_DIRECT;
+
+	// Row pass keeps float sums, direct sum is rounded once too, rounding may differ by one
+	IplImage* result = RunFilter(GPU->Transfer, &separable, image);
+	IplImage* reference = RunFilter(GPU->Transfer, &direct, image);
+	ReportCheck("separable", result, reference, radius, 1);
+	if( result ) cvReleaseImage(&result);
+	if( reference ) cvReleaseImage(&reference);
+}
+
+// Product of spectra against direct convolution with 17x17 disc, mask that isn't separable.
+// Both paths read zeros outside of the image, float error of the transforms may change rounding by one
+static void CheckFFT(GPUImageProcessor* GPU, IplImage* image)
+{
+	const int radius = 8;
+	const int side = 2 * radius + 1;
+	float mask[side * side];
+	for( int y = -radius ; y <= radius ; ++y )
+	{
+		for( int x = -radius ; x <= radius ; ++x ) mask[(y + radius) * side + x + radius] = (x * x + y * y <= radius * radius) ? 1.0f : 0.0f;
+	}
+
+	FFTConvolutionFilter convolution(GPU->GPUContext, GPU->Transfer, mask, side, side);
+	convolution.Method = CONV_FFT;
+	IplImage* result = RunFilter(GPU->Transfer, &convolution, image);
+	convolution.Method = CONV_DIRECT;
+	IplImage* reference = RunFilter(GPU->Transfer, &convolution, image);
+
+	ReportCheck("fft", result, reference, 0, 1);
+	if( result ) cvReleaseImage(&result);
+	if( reference ) cvReleaseImage(&reference);
+}
+
+// Running sums of box mean of radius 7 against direct convolution with 15x15 mask of ones.
+// Both read zeros outside of the image, box mean truncates the quotient and direct sum is rounded, so they may differ by one
+static void CheckBoxMean(GPUImageProcessor* GPU, IplImage* image)
+{
+	const int radius = 7;
+	const int side = 2 * radius + 1;
+	float mask[side * side];
+	for( int i = 0 ; i < side * side ; ++i ) mask[i] = 1.0f;
+
+	MeanFilter mean(GPU->GPUContext, GPU->Transfer, radius);
+	FFTConvolutionFilter direct(GPU->GPUContext, GPU->Transfer, mask, side, side);
+	direct.Method = CONV_DIRECT;
+
+	IplImage* result = RunFilter(GPU->Transfer, &mean, image);
+	IplImage* reference = RunFilter(GPU->Transfer, &direct, image);
+	ReportCheck("box mean", result, reference, 0, 1);
+	if( result ) cvReleaseImage(&result);
+	if( reference ) cvReleaseImage(&reference);
+}
+
+// Median that always runs direct stencil kernel ckMedianR, reference of sliding histogram median
+class StencilMedianFilter : public MedianFilter
+{
+public:
+	StencilMedianFilter(cl_context GPUContext ,GPUTransferManager* transfer): MedianFilter(GPUContext,transfer) {}
+	bool filter(cl_command_queue GPUCommandQueue) { return filterStencil(GPUCommandQueue); }
+};
+
+// Sorting networks of radius 1 and 2 and sliding histogram against exact host median, sliding histogram also against direct
+// bisection of ckMedianR. All medians are exact and read zeros outside of the image
+static void CheckMedian(GPUImageProcessor* GPU, IplImage* image)
+{
+	IplImage* source = CreateDense(image, true);
+	IplImage* exact = CreateDense(image, false);
+	for( int radius = 1 ; radius <= MEDIAN_HISTOGRAM_RADIUS ; ++radius )
+	{
+		MedianFilter median(GPU->GPUContext, GPU->Transfer);
+		median.SetRadius(radius);
+		IplImage* result = RunFilter(GPU->Transfer, &median, image);
+		HostMedian((unsigned char*)source->imageData, (unsigned char*)exact->imageData, image->width, image->height, image->nChannels, radius);
+
+		char name[16];
+		sprintf(name, "median %d", radius);
+		ReportCheck(name, result, exact, 0, 0);
+		if( result ) cvReleaseImage(&result);
+	}
+	ReleaseDense(&source);
+	ReleaseDense(&exact);
+
+	MedianFilter histogram(GPU->GPUContext, GPU->Transfer);
+	StencilMedianFilter direct(GPU->GPUContext, GPU->Transfer);
+	histogram.SetRadius(MEDIAN_HISTOGRAM_RADIUS);
+	direct.SetRadius(MEDIAN_HISTOGRAM_RADIUS);
+
+	IplImage* result = RunFilter(GPU->Transfer, &histogram, image);
+	IplImage* reference = RunFilter(GPU->Transfer, &direct, image);
+	ReportCheck("median R", result, reference, 0, 0);
+	if( result ) cvReleaseImage(&result);
+	if( reference ) cvReleaseImage(&reference);
+}
+
+// Van Herk/Gil-Werman passes with 7x7 element against direct minimum and maximum of radius 3 (ckMinR, ckMaxR), opening against
+// minimum followed by maximum. Passes treat pixels outside of the image as neutral and direct kernels read zeros, so pixels
+// closer to the edge than the distance read are skipped
+static void CheckRectMorphology(GPUImageProcessor* GPU, IplImage* image)
+{
+	const int radius = 3;
+	const int side = 2 * radius + 1;
+	RectMorphologyFilter erode(GPU->GPUContext, GPU->Transfer, RECT_ERODE, side, side);
+	RectMorphologyFilter dilate(GPU->GPUContext, GPU->Transfer, RECT_DILATE, side, side);
+	RectMorphologyFilter open(GPU->GPUContext, GPU->Transfer, RECT_OPEN, side, side);
+	MinFilter minimum(GPU->GPUContext, GPU->Transfer);
+	MaxFilter maximum(GPU->GPUContext, GPU->Transfer);
+	minimum.SetRadius(radius);
+	maximum.SetRadius(radius);
+
+	IplImage* minImage = RunFilter(GPU->Transfer, &minimum, image);
+	IplImage* maxImage = RunFilter(GPU->Transfer, &maximum, image);
+	IplImage* openImage = minImage ? RunFilter(GPU->Transfer, &maximum, minImage) : NULL;
+
+	IplImage* result = RunFilter(GPU->Transfer, &erode, image);
+	ReportCheck("erode", result, minImage, radius, 0);
+	if( result ) cvReleaseImage(&result);
+
+	result = RunFilter(GPU->Transfer, &dilate, image);
+	ReportCheck("dilate", result, maxImage, radius, 0);
+	if( result ) cvReleaseImage(&result);
+
+	result = RunFilter(GPU->Transfer, &open, image);
+	ReportCheck("open", result, openImage, 2 * radius, 0);
+	if( result ) cvReleaseImage(&result);
+
+	if( minImage ) cvReleaseImage(&minImage);
+	if( maxImage ) cvReleaseImage(&maxImage);
+	if( openImage ) cvReleaseImage(&openImage);
+}
+
 
 
 
@@ -126,6 +568,15 @@ int main(int argc, const char** argv)
 
  //   
  //   
+	// --profile records device time of each filter and transfer
+	bool profiling = shrCheckCmdLineFlag(argc, argv, "profile") == shrTRUE;
+
+	// --bench compares upload paths, neighbourhood fetches and channel layouts on the processed frame
+	bool benchmarks = shrCheckCmdLineFlag(argc, argv, "bench") == shrTRUE;
+
+	// --check compares results of alternative processing paths with their references on the processed frame
+	bool checks = shrCheckCmdLineFlag(argc, argv, "check") == shrTRUE;
+
 	double avg = 0;
 	int i = 0;
 	for(i = 0; i < 1; i++ )
@@ -140,7 +591,7 @@ int main(int argc, const char** argv)
 		IplImage *newImage = cvCreateImage( cvSize(img->width * 0.25 * j ,img->height* 0.25 * j), img->depth, img->nChannels );
 
 		cvResize(img, newImage);
-		GPUImageProcessor* GPU = new GPUImageProcessor(newImage->width,newImage->height,newImage->nChannels);
+		GPUImageProcessor* GPU = new GPUImageProcessor(newImage->width,newImage->height,newImage->nChannels,CL_DEVICE_TYPE_GPU,0,-1,profiling);
 
 		int lut[256];
 		for(int i = 0 ; i < 256 ; ++i )
@@ -203,11 +654,69 @@ int main(int argc, const char** argv)
 		cout << "rozmiar: " << endl;
 		cout << newImage->width <<"x"<< newImage->height << endl;
 		cout << "-------------------------\n\n" << endl;
+
+		// Received image points to a staging buffer, downloads of the benchmarks below overwrite it
+		IplImage* result = cvCloneImage(newImage);
+
+		// Device time of each filter and transfer
+		if( GPU->Profiler )
+		{
+			GPU->Profiler->Print();
+			GPU->Profiler->Reset();
+		}
+
+		if( benchmarks )
+		{
+			// Pageable, pinned and mapped uploads of the same frame
+			BenchmarkUploads(GPU->Transfer, newImage, 100);
+
+			// Median with manual apron against median through texture cache
+			MedianFilter median(GPU->GPUContext, GPU->Transfer);
+			BenchmarkFetch(GPU->Transfer, &median, newImage, 100);
+
+			// Median with BGR pixels against pixels expanded to BGRA and split to planes on the device
+			BenchmarkLayout(GPU->Transfer, &median, newImage, 100);
+		}
+
+		if( checks )
+		{
+			printf("%-10s %10s %10s\n", "check", "result", "max diff");
+
+			// Whole image against strips of all devices
+			CheckStrips(GPU, result);
+
+			// Whole image against tiles of 64 rows including halo
+			CheckTiles(GPU, result, 64);
+
+			// Three images in one batch against each one alone
+			CheckBatch(GPU, result);
+
+			// Host tiles on all worker threads against one thread
+			CheckScheduler(result);
+
+			// Separable Gaussian against direct convolution
+			CheckSeparable(GPU, result);
+
+			// Convolution through FFT against direct convolution
+			CheckFFT(GPU, result);
+
+			// Box mean against direct mean
+			CheckBoxMean(GPU, result);
+
+			// Sorting network and histogram medians against exact and direct median
+			CheckMedian(GPU, result);
+
+			// Rectangle morphology against direct minimum and maximum
+			CheckRectMorphology(GPU, result);
+
+			if( GPU->Profiler ) GPU->Profiler->Reset();
+		}
 		
-		cout << (int)newImage->imageData[0] << endl;
+		cout << (int)result->imageData[0] << endl;
 		cvNamedWindow("sobel", CV_WINDOW_AUTOSIZE); 
-		cvShowImage("sobel", newImage );
+		cvShowImage("sobel", result );
 		cvWaitKey(0);
+		cvReleaseImage(&result);
 		//delete GPU;
 		//cvCvtColor(img, image4, CV_HSV2BGR);
 	}